@@ -0,0 +1,143 @@
+#include "AdmissionController.h"
+#include <QDateTime>
+#include <algorithm>
+
+// Side pool that answers shed connections, and how many it may hold before httplib closes them.
+// 应答被拒连接的辅助线程池，以及其最多容纳的连接数（超过后由 httplib 直接关闭）。
+static const size_t SHED_WORKERS = 4;
+static const size_t SHED_QUEUE_MAX = 256;
+
+// How the connection on this worker thread was admitted ; 当前工作线程上的连接的准入方式
+enum class Arrival
+{
+    None,   ///< Not from our queue ; 不是来自本队列
+    Queued, ///< First request, waited in the queue since t_acceptedMs ; 首个请求，自 t_acceptedMs 起排队
+    Served, ///< Later keep-alive request on an admitted connection ; 已准入连接上的后续 keep-alive 请求
+    Shed    ///< Handed to the side pool because the queue was full ; 因队列已满交给辅助线程池
+};
+static thread_local Arrival t_arrival = Arrival::None;
+static thread_local qint64 t_acceptedMs = 0;
+static thread_local qint64 t_requestMs = 0;
+
+class AdmissionController::Queue : public httplib::TaskQueue
+{
+public:
+    Queue(AdmissionController &owner, size_t workers)
+        : m_owner(owner), m_pool(workers), m_shed(SHED_WORKERS, SHED_QUEUE_MAX)
+    {
+    }
+
+    bool enqueue(std::function<void()> fn) override
+    {
+        AdmissionController &owner = m_owner;
+        if (owner.m_queued.load() >= owner.m_maxQueued.load())
+        {
+            return m_shed.enqueue([fn]()
+                                  {
+                t_arrival = Arrival::Shed;
+                fn();
+                t_arrival = Arrival::None; });
+        }
+
+        owner.m_queued++;
+        const qint64 acceptedMs = QDateTime::currentMSecsSinceEpoch();
+        const bool queued = m_pool.enqueue([&owner, fn, acceptedMs]()
+                                           {
+            owner.m_queued--;
+            owner.m_active++;
+            t_arrival = Arrival::Queued;
+            t_acceptedMs = acceptedMs;
+            fn();
+            t_arrival = Arrival::None;
+            owner.m_active--; });
+        if (!queued)
+            owner.m_queued--;
+        return queued;
+    }
+
+    void shutdown() override
+    {
+        m_pool.shutdown();
+        m_shed.shutdown();
+    }
+
+private:
+    AdmissionController &m_owner;
+    httplib::ThreadPool m_pool;
+    httplib::ThreadPool m_shed;
+};
+
+void AdmissionController::configure(int workers, int maxQueued, int maxQueueMs)
+{
+    m_workers = std::max(1, workers);
+    m_maxQueued = std::max(1, maxQueued);
+    m_maxQueueMs = std::max(100, maxQueueMs);
+}
+
+httplib::TaskQueue *AdmissionController::createQueue()
+{
+    return new Queue(*this, size_t(m_workers.load()));
+}
+
+AdmissionController::Decision AdmissionController::check()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    t_requestMs = now;
+    switch (t_arrival)
+    {
+    case Arrival::Queued:
+    {
+        // Later requests on the same connection don't wait in the queue ; 同一连接上的后续请求不经过队列
+        t_arrival = Arrival::Served;
+        t_requestMs = t_acceptedMs;
+        if (now - t_acceptedMs > m_maxQueueMs.load())
+        {
+            m_rejectedStale++;
+            return Decision::RejectStale;
+        }
+        break;
+    }
+    case Arrival::Shed:
+        // Every request on a shed connection, including kept-alive ones: the side pool never
+        // runs a handler, whatever the queue looks like by now.
+        // 被拒连接上的每个请求（包括 keep-alive 的后续请求）都被拒绝：无论此时队列如何，辅助线程池都不运行处理函数。
+        m_rejectedFull++;
+        return Decision::RejectFull;
+    case Arrival::None:
+    case Arrival::Served:
+        break;
+    }
+    m_admitted++;
+    return Decision::Admit;
+}
+
+qint64 AdmissionController::arrivalMs() const
+{
+    return t_requestMs > 0 ? t_requestMs : QDateTime::currentMSecsSinceEpoch();
+}
+
+int AdmissionController::retryAfterSeconds() const
+{
+    // Anything older is dropped, so the queue has turned over by then ; 更早的请求会被丢弃，届时队列已经轮换一遍
+    return std::max(1, (m_maxQueueMs.load() + 999) / 1000);
+}
+
+AdmissionController::Stats AdmissionController::stats() const
+{
+    Stats stats;
+    stats.queued = m_queued.load();
+    stats.active = m_active.load();
+    stats.workers = m_workers.load();
+    stats.maxQueued = m_maxQueued.load();
+    stats.admitted = m_admitted.load();
+    stats.rejectedFull = m_rejectedFull.load();
+    stats.rejectedStale = m_rejectedStale.load();
+    return stats;
+}
+
+void AdmissionController::resetStats()
+{
+    m_admitted = 0;
+    m_rejectedFull = 0;
+    m_rejectedStale = 0;
+}
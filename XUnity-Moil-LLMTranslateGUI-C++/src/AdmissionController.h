@@ -0,0 +1,105 @@
+#pragma once
+#include "httplib.h"
+#include <QtGlobal>
+#include <atomic>
+
+/**
+ * Bounded admission in front of the HTTP worker pool.
+ * HTTP 工作线程池前的有界准入控制。
+ *
+ * httplib's ThreadPool queues connections without limit once every worker is busy, so a flood
+ * from XUnity turned into minutes of hidden latency. The task queue made by createQueue()
+ * counts queued connections and stamps when each was accepted:
+ * - while the queue is full, new connections go to a small side pool that only answers
+ *   503 + Retry-After (with "Connection: close"), so the rejection is immediate instead of
+ *   waiting behind the queue;
+ * - a connection that waited longer than the queue time limit is answered 503 + Retry-After
+ *   as soon as a worker picks it up, instead of being translated for a client that has
+ *   probably given up.
+ * httplib 的 ThreadPool 在所有工作线程忙碌时会无限排队连接，XUnity 的洪峰因此变成数分钟的隐性延迟。
+ * createQueue() 创建的任务队列统计排队的连接数，并记录每个连接被接受的时间：
+ * - 队列已满时，新连接交给一个只负责应答 503 + Retry-After（附 "Connection: close"）的小线程池，
+ *   拒绝会立即返回，而不必排在队列之后；
+ * - 等待超过队列时限的连接在被工作线程取出时立即应答 503 + Retry-After，
+ *   而不是为一个很可能已经放弃的客户端翻译。
+ *
+ * check() is called first for every request (pre-routing handler).
+ * 每个请求首先调用 check()（预路由处理函数）。
+ *
+ * Thread‑safe.
+ * 线程安全。
+ */
+class AdmissionController
+{
+public:
+    enum class Decision
+    {
+        Admit,
+        RejectFull,  ///< Queue full when the connection arrived; close the connection ; 连接到达时队列已满；应关闭连接
+        RejectStale  ///< Waited longer than the queue time limit ; 等待超过队列时限
+    };
+
+    struct Stats
+    {
+        int queued = 0;           ///< Connections waiting for a worker ; 等待工作线程的连接数
+        int active = 0;           ///< Connections being served ; 正在处理的连接数
+        int workers = 0;
+        int maxQueued = 0;
+        quint64 admitted = 0;
+        quint64 rejectedFull = 0;
+        quint64 rejectedStale = 0;
+    };
+
+    /**
+     * Set the pool size and the queue bounds; takes effect for the next createQueue().
+     * 设置线程池大小与队列上限；在下一次 createQueue() 时生效。
+     *
+     * @param workers    Worker threads ; 工作线程数
+     * @param maxQueued  Connections that may wait for a worker ; 可以等待工作线程的连接数
+     * @param maxQueueMs Longest a connection may wait ; 连接最长等待时间
+     */
+    void configure(int workers, int maxQueued, int maxQueueMs);
+
+    /**
+     * Task queue for httplib::Server::new_task_queue. Owned by the server.
+     * 用于 httplib::Server::new_task_queue 的任务队列，由服务器持有。
+     */
+    httplib::TaskQueue *createQueue();
+
+    /**
+     * Admission decision for the request on the calling worker thread.
+     * 对调用方工作线程上的请求作出准入决定。
+     */
+    Decision check();
+
+    /**
+     * When the request checked last on the calling worker thread arrived: the first request
+     * of a connection counts from when the connection was accepted, not from when a worker
+     * picked it up.
+     * 调用方工作线程上最近一次检查的请求的到达时间：连接上的首个请求从连接被接受时算起，
+     * 而不是从工作线程取出它时算起。
+     */
+    qint64 arrivalMs() const;
+
+    /**
+     * Seconds a rejected client should wait before trying again.
+     * 被拒绝的客户端应等待多少秒后重试。
+     */
+    int retryAfterSeconds() const;
+
+    Stats stats() const;
+    void resetStats();
+
+private:
+    class Queue;
+
+    std::atomic<int> m_workers{64};
+    std::atomic<int> m_maxQueued{256};
+    std::atomic<int> m_maxQueueMs{10000};
+
+    std::atomic<int> m_queued{0};
+    std::atomic<int> m_active{0};
+    std::atomic<quint64> m_admitted{0};
+    std::atomic<quint64> m_rejectedFull{0};
+    std::atomic<quint64> m_rejectedStale{0};
+};
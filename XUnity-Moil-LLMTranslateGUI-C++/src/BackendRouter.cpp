@@ -0,0 +1,256 @@
+#include "BackendRouter.h"
+#include <QDateTime>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <cmath>
+
+// Weight of the newest result in the error rate and latency averages ; 最新结果在错误率与延迟均值中的权重
+static const double HEALTH_ALPHA = 0.2;
+// Error rate that takes a backend out of rotation, once enough replies are known.
+// 已知响应足够多时，使上游移出轮换的错误率。
+static const double DEGRADED_ERROR_RATE = 0.5;
+static const int DEGRADED_MIN_SAMPLES = 5;
+static const qint64 DEGRADED_DOWN_MS = 30000;
+// Error rate a backend restarts with after its down period, so it has to prove itself.
+// 停用期结束后上游的初始错误率，使其需要重新证明自己。
+static const double RECOVERY_ERROR_RATE = 0.25;
+// Latency assumed before the first reply, and the floor used when scoring.
+// 收到首个响应之前假定的延迟，以及评分时使用的下限。
+static const double DEFAULT_LATENCY_MS = 1000.0;
+static const double MIN_LATENCY_MS = 50.0;
+
+void BackendRouter::configure(const QList<BackendConfig> &backends, int defaultRpm, int defaultTpm)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Backend> updated;
+    for (const BackendConfig &config : backends)
+    {
+        Backend backend;
+        for (Backend &old : m_backends)
+        {
+            if (old.keys && old.config.api_address == config.api_address && old.config.model_name == config.model_name &&
+                old.config.api_key == config.api_key)
+            {
+                backend = std::move(old);
+                break;
+            }
+        }
+        if (!backend.keys)
+        {
+            backend.id = ++m_lastId;
+            backend.keys = std::make_unique<KeyRateLimiter>();
+        }
+        backend.config = config;
+        backend.keys->configure(KeyRateLimiter::parseKeys(config.api_key, defaultRpm, defaultTpm));
+        updated.push_back(std::move(backend));
+    }
+    m_backends.swap(updated);
+}
+
+bool BackendRouter::isEmpty()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (Backend &backend : m_backends)
+    {
+        if (!backend.keys->isEmpty())
+            return false;
+    }
+    return true;
+}
+
+bool BackendRouter::acquire(int estimatedTokens, BackendRoute &route, qint64 &waitMs, const BackendRoute &avoid)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    struct Candidate
+    {
+        size_t index;
+        int tier;     ///< 0 healthy, 1 standby, 2 degraded, 3 avoided ; 0 健康，1 备用，2 已降级，3 需避开
+        double order; ///< Weighted random draw, smaller first ; 加权随机抽样值，越小越先
+    };
+    std::vector<Candidate> candidates;
+    for (size_t i = 0; i < m_backends.size(); ++i)
+    {
+        Backend &backend = m_backends[i];
+        if (backend.downUntilMs > 0 && now >= backend.downUntilMs)
+        {
+            backend.downUntilMs = 0;
+            backend.errorRate = std::max(backend.errorRate * 0.5, RECOVERY_ERROR_RATE);
+            backend.recovering = true;
+        }
+
+        int tier = (backend.downUntilMs > 0) ? 2 : (backend.config.weight > 0 ? 0 : 1);
+        if (backend.id == avoid.backendId)
+            tier = 3;
+        const double latency = backend.samples > 0 ? std::max(backend.avgLatencyMs, MIN_LATENCY_MS) : DEFAULT_LATENCY_MS;
+        const double score = std::max(backend.config.weight, 1) / (latency * (1.0 + 4.0 * backend.errorRate));
+        // Sorting by -ln(u) / score draws backends in proportion to their score (Efraimidis–Spirakis).
+        // 按 -ln(u) / score 排序，即按评分比例抽取上游（Efraimidis–Spirakis）。
+        const double u = QRandomGenerator::global()->generateDouble();
+        candidates.push_back({i, tier, -std::log(1.0 - u) / score});
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b)
+              { return a.tier != b.tier ? a.tier < b.tier : a.order < b.order; });
+
+    qint64 shortest = 0;
+    for (const Candidate &candidate : candidates)
+    {
+        Backend &backend = m_backends[candidate.index];
+        qint64 wait = 0;
+        const QString key = backend.keys->acquire(estimatedTokens, wait, candidate.tier == 3 ? avoid.apiKey : QString());
+        if (!key.isEmpty())
+        {
+            route.backendId = backend.id;
+            route.address = backend.config.api_address;
+            route.model = backend.config.model_name;
+            route.apiKey = key;
+            waitMs = 0;
+            return true;
+        }
+        if (wait > 0 && (shortest == 0 || wait < shortest))
+            shortest = wait;
+    }
+    waitMs = shortest;
+    return false;
+}
+
+/**
+ * The backend a route was taken from, or nullptr if it has since been removed. Looked up by
+ * id: indexes shift when the list is reconfigured, and two entries may share address and model.
+ * 路由所属的上游；该上游已被移除时返回 nullptr。按身份标识查找：重新配置列表后序号会变化，
+ * 且两个条目可能地址与模型都相同。
+ */
+BackendRouter::Backend *BackendRouter::findLocked(const BackendRoute &route)
+{
+    for (Backend &backend : m_backends)
+    {
+        if (backend.id == route.backendId)
+            return &backend;
+    }
+    return nullptr;
+}
+
+void BackendRouter::settle(const BackendRoute &route, int estimatedTokens, int actualTokens)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (Backend *backend = findLocked(route))
+        backend->keys->settle(route.apiKey, estimatedTokens, actualTokens);
+}
+
+void BackendRouter::recordLatency(const BackendRoute &route, int tokens, qint64 latencyMs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (Backend *backend = findLocked(route))
+        backend->latency.record(tokens, latencyMs);
+}
+
+bool BackendRouter::predictLatency(const BackendRoute &route, int tokens, qint64 &predictedMs, qint64 &spreadMs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Backend *backend = findLocked(route);
+    return backend && backend->latency.predict(tokens, predictedMs, spreadMs);
+}
+
+BackendRouter::Verdict BackendRouter::report(const BackendRoute &route, KeyOutcome outcome, qint64 latencyMs, qint64 retryAfterMs)
+{
+    Verdict verdict;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Backend *backend = findLocked(route);
+    if (!backend)
+        return verdict;
+
+    verdict.key = backend->keys->report(route.apiKey, outcome, latencyMs, retryAfterMs);
+
+    bool failed = false;
+    switch (outcome)
+    {
+    case KeyOutcome::Success:
+        break;
+    case KeyOutcome::ServerError:
+    case KeyOutcome::Timeout:
+    case KeyOutcome::NetworkError:
+        failed = true;
+        break;
+    case KeyOutcome::AuthError:
+    case KeyOutcome::RateLimited:
+    case KeyOutcome::Cancelled:
+        return verdict; // Key problem or our own abort ; 密钥问题或本地中止
+    }
+
+    backend->requests++;
+    backend->samples++;
+    backend->errorRate = HEALTH_ALPHA * (failed ? 1.0 : 0.0) + (1.0 - HEALTH_ALPHA) * backend->errorRate;
+    verdict.errorRate = backend->errorRate;
+    if (!failed)
+    {
+        backend->avgLatencyMs = (backend->samples == 1) ? double(latencyMs)
+                                                        : HEALTH_ALPHA * latencyMs + (1.0 - HEALTH_ALPHA) * backend->avgLatencyMs;
+        verdict.recovered = backend->recovering;
+        backend->recovering = false;
+        return verdict;
+    }
+
+    backend->failures++;
+    // With a single backend there is nothing to fail over to ; 只有一个上游时无处可切换
+    const bool unhealthy = backend->recovering ||
+                           (backend->samples >= DEGRADED_MIN_SAMPLES && backend->errorRate >= DEGRADED_ERROR_RATE);
+    if (unhealthy && backend->downUntilMs == 0 && m_backends.size() > 1)
+    {
+        backend->downUntilMs = QDateTime::currentMSecsSinceEpoch() + DEGRADED_DOWN_MS;
+        backend->recovering = false;
+        backend->failovers++;
+        verdict.degraded = true;
+        verdict.downForMs = DEGRADED_DOWN_MS;
+    }
+    return verdict;
+}
+
+int BackendRouter::count()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return int(m_backends.size());
+}
+
+QList<BackendRouter::BackendStats> BackendRouter::stats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QList<BackendStats> result;
+    for (const Backend &backend : m_backends)
+    {
+        BackendStats stats;
+        stats.address = backend.config.api_address;
+        stats.model = backend.config.model_name;
+        stats.weight = backend.config.weight;
+        stats.requests = backend.requests;
+        stats.failures = backend.failures;
+        stats.failovers = backend.failovers;
+        stats.errorRate = backend.errorRate;
+        stats.avgLatencyMs = qint64(backend.avgLatencyMs);
+        stats.downForMs = (backend.downUntilMs > now) ? backend.downUntilMs - now : 0;
+        result.append(stats);
+    }
+    return result;
+}
+
+QList<KeyRateLimiter::KeyStats> BackendRouter::keyStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    QList<KeyRateLimiter::KeyStats> result;
+    for (Backend &backend : m_backends)
+        result.append(backend.keys->stats());
+    return result;
+}
+
+QStringList BackendRouter::addresses()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    QStringList result;
+    for (const Backend &backend : m_backends)
+    {
+        if (!result.contains(backend.config.api_address))
+            result << backend.config.api_address;
+    }
+    return result;
+}
@@ -0,0 +1,160 @@
+#pragma once
+#include "ConfigManager.h"
+#include "KeyRateLimiter.h"
+#include "LatencyModel.h"
+#include <QString>
+#include <QList>
+#include <QStringList>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Where one upstream request goes: backend, model and key.
+ * 一次上游请求的去向：上游、模型与密钥。
+ */
+struct BackendRoute
+{
+    quint64 backendId = 0; ///< Identity of the backend, kept across reconfiguration; 0 = none ; 上游身份标识，重新配置后保持不变；0 表示无
+    QString address;
+    QString model;
+    QString apiKey;
+};
+
+/**
+ * Routing across several OpenAI‑compatible backends, each with its own key set.
+ * 在多个兼容 OpenAI 的上游之间路由，每个上游有各自的密钥组。
+ *
+ * Each backend keeps an average latency and error rate (exponentially weighted) of its
+ * replies. Requests are spread over the healthy backends in proportion to
+ * weight / (latency × (1 + 4 × error rate)), so a slow or failing backend quickly loses
+ * traffic. A backend with half of its recent requests failing (5xx, timeouts, network
+ * errors) is taken out of rotation for a while and then tried again. Backends with weight 0
+ * are standbys, used only when the weighted ones have no key available; degraded backends
+ * are still used as a last resort when nothing else is left.
+ * 每个上游记录其响应的平均延迟与错误率（指数加权）。请求按 weight / (延迟 × (1 + 4 × 错误率))
+ * 的比例分配到健康的上游，因此缓慢或出错的上游会迅速失去流量。近期一半请求失败（5xx、超时、
+ * 网络错误）的上游会暂时移出轮换，之后再重新尝试。权重为 0 的上游是备用上游，只在有权重的
+ * 上游都没有可用密钥时使用；其他上游都不可用时，仍会把已降级的上游作为最后手段。
+ *
+ * 401/403/429 are the key's business and are left to the backend's KeyRateLimiter.
+ * 401/403/429 属于密钥的问题，由该上游的 KeyRateLimiter 处理。
+ *
+ * Thread‑safe.
+ * 线程安全。
+ */
+class BackendRouter
+{
+public:
+    struct BackendStats
+    {
+        QString address;
+        QString model;
+        int weight = 1;
+        quint64 requests = 0;
+        quint64 failures = 0;   ///< 5xx, timeouts, network errors ; 5xx、超时、网络错误
+        quint64 failovers = 0;  ///< Times taken out of rotation ; 被移出轮换的次数
+        double errorRate = 0;   ///< Recent, exponentially weighted ; 近期错误率（指数加权）
+        qint64 avgLatencyMs = 0;
+        qint64 downForMs = 0;   ///< Time until a degraded backend is tried again ; 已降级上游距离重新尝试的时间
+    };
+
+    /**
+     * What a reported result did to the backend and its key.
+     * 上报的结果对上游及其密钥产生的影响。
+     */
+    struct Verdict
+    {
+        KeyRateLimiter::Verdict key;
+        bool degraded = false;  ///< The backend has just been taken out of rotation ; 上游刚被移出轮换
+        bool recovered = false; ///< A degraded backend answered again ; 已降级的上游重新应答
+        qint64 downForMs = 0;
+        double errorRate = 0;
+    };
+
+    /**
+     * Replace the backend list. Backends with the same address, model and keys keep their state
+     * (and identity); each old backend is taken over at most once, so duplicates stay apart.
+     * 替换上游列表。地址、模型与密钥都相同的上游沿用其状态（及身份）；每个旧上游最多被沿用一次，
+     * 因此重复的上游仍彼此独立。
+     *
+     * @param backends   Backends in priority order ; 按优先级排列的上游
+     * @param defaultRpm Limit for keys without "rpm=" ; 未写 "rpm=" 的密钥的限额
+     * @param defaultTpm Limit for keys without "tpm=" ; 未写 "tpm=" 的密钥的限额
+     */
+    void configure(const QList<BackendConfig> &backends, int defaultRpm, int defaultTpm);
+
+    /**
+     * True if no backend has a key.
+     * 没有任何上游配置了密钥时返回 true。
+     */
+    bool isEmpty();
+
+    /**
+     * Pick a backend and one of its keys for a request.
+     * 为一次请求选择上游及其一个密钥。
+     *
+     * @param estimatedTokens Charged to the key's token bucket ; 计入密钥 token 桶的预估值
+     * @param route           Receives backend, model and key ; 写入上游、模型与密钥
+     * @param waitMs          Receives the time until a key frees up when none is available ; 无可用密钥时写入需等待的时间
+     * @param avoid           Route to stay away from (e.g. the one a hedged request is already on); its backend is tried last, without its key ; 需要避开的路由（例如被对冲请求已在使用的路由）；其上游最后尝试，且不使用其密钥
+     * @return false if no backend has a key available ; 没有任何上游有可用密钥时返回 false
+     */
+    bool acquire(int estimatedTokens, BackendRoute &route, qint64 &waitMs, const BackendRoute &avoid = BackendRoute());
+
+    /**
+     * Correct the key's token bucket once the real usage is known.
+     * 得知实际用量后修正密钥的 token 桶。
+     */
+    void settle(const BackendRoute &route, int estimatedTokens, int actualTokens);
+
+    /**
+     * Record how a request ended. Every successful acquire() must be followed by one report.
+     * 记录请求的结束方式。每次成功的 acquire() 之后都必须上报一次。
+     */
+    Verdict report(const BackendRoute &route, KeyOutcome outcome, qint64 latencyMs, qint64 retryAfterMs = 0);
+
+    /**
+     * Feed a completed request into the backend's latency model.
+     * 将一次完成的请求加入该上游的延迟模型。
+     *
+     * @param tokens Expected output tokens of the request ; 请求的预期输出 token 数
+     */
+    void recordLatency(const BackendRoute &route, int tokens, qint64 latencyMs);
+
+    /**
+     * Predicted duration of a request on a backend (see LatencyModel).
+     * 预测请求在某个上游上的耗时（见 LatencyModel）。
+     *
+     * @return false while the backend's model has too few requests ; 该上游的模型已知请求过少时返回 false
+     */
+    bool predictLatency(const BackendRoute &route, int tokens, qint64 &predictedMs, qint64 &spreadMs);
+
+    int count();
+    QList<BackendStats> stats();
+    QList<KeyRateLimiter::KeyStats> keyStats();
+    QStringList addresses();
+
+private:
+    struct Backend
+    {
+        quint64 id = 0; ///< See BackendRoute::backendId ; 见 BackendRoute::backendId
+        BackendConfig config;
+        std::unique_ptr<KeyRateLimiter> keys;
+        LatencyModel latency; ///< Per backend, hence per model ; 按上游（即按模型）区分
+        double errorRate = 0;
+        double avgLatencyMs = 0;
+        int samples = 0;
+        qint64 downUntilMs = 0;
+        bool recovering = false; ///< Back from a down period, not answered yet ; 刚结束停用期，尚未应答
+        quint64 requests = 0;
+        quint64 failures = 0;
+        quint64 failovers = 0;
+    };
+
+    Backend *findLocked(const BackendRoute &route);
+
+    std::mutex m_mutex;
+    std::vector<Backend> m_backends;
+    quint64 m_lastId = 0;
+};
@@ -1,4 +1,5 @@
 #include "ConfigManager.h"
+#include <algorithm>
 
 /**
  * Load configuration from an INI file.
@@ -46,9 +47,63 @@ AppConfig ConfigManager::loadConfig(const QString &filename)
     config.enable_debug_mode = settings.value("Settings/enable_debug_mode", false).toBool();
     config.enable_batch = settings.value("Settings/enable_batch", false).toBool(); // Default off ; 默认关闭
 
+    loadAdvancedConfig(config, filename);
     return config;
 }
 
+/**
+ * Read the [Advanced] settings into an existing config.
+ * 将 [Advanced] 设置读入已有配置。
+ *
+ * @param config Config to update ; 需要更新的配置
+ * @param filename Path to the INI file ; INI文件路径
+ */
+void ConfigManager::loadAdvancedConfig(AppConfig &config, const QString &filename)
+{
+    QSettings settings(filename, QSettings::IniFormat);
+    config.enable_template_cache = settings.value("Advanced/enable_template_cache", config.enable_template_cache).toBool();
+    config.cache_budget_mb = std::max(1, settings.value("Advanced/cache_budget_mb", config.cache_budget_mb).toInt());
+    config.glossary_retranslate = settings.value("Advanced/glossary_retranslate", config.glossary_retranslate).toBool();
+    config.enable_streaming = settings.value("Advanced/enable_streaming", config.enable_streaming).toBool();
+    config.stream_max_chars = std::max(256, settings.value("Advanced/stream_max_chars", config.stream_max_chars).toInt());
+    config.micro_batch_window_ms = std::max(0, settings.value("Advanced/micro_batch_window_ms", config.micro_batch_window_ms).toInt());
+    config.micro_batch_max_items = std::max(1, settings.value("Advanced/micro_batch_max_items", config.micro_batch_max_items).toInt());
+    config.key_rpm = std::max(0, settings.value("Advanced/key_rpm", config.key_rpm).toInt());
+    config.key_tpm = std::max(0, settings.value("Advanced/key_tpm", config.key_tpm).toInt());
+    config.retry_budget_percent = std::max(0, settings.value("Advanced/retry_budget_percent", config.retry_budget_percent).toInt());
+    config.enable_hedging = settings.value("Advanced/enable_hedging", config.enable_hedging).toBool();
+    config.hedge_percentile = std::clamp(settings.value("Advanced/hedge_percentile", config.hedge_percentile).toInt(), 50, 99);
+    config.hedge_budget_percent = std::max(0, settings.value("Advanced/hedge_budget_percent", config.hedge_budget_percent).toInt());
+    config.primary_weight = std::max(0, settings.value("Advanced/primary_weight", config.primary_weight).toInt());
+    config.timeout_floor_ms = std::max(1000, settings.value("Advanced/timeout_floor_ms", config.timeout_floor_ms).toInt());
+    config.timeout_ceiling_ms = std::max(config.timeout_floor_ms, settings.value("Advanced/timeout_ceiling_ms", config.timeout_ceiling_ms).toInt());
+    config.max_queued_requests = std::max(1, settings.value("Advanced/max_queued_requests", config.max_queued_requests).toInt());
+    config.max_queue_ms = std::max(100, settings.value("Advanced/max_queue_ms", config.max_queue_ms).toInt());
+    config.upstream_concurrency = std::max(0, settings.value("Advanced/upstream_concurrency", config.upstream_concurrency).toInt());
+    config.scheduler_lifo = settings.value("Advanced/scheduler_lifo", config.scheduler_lifo).toBool();
+    // QSettings splits unquoted commas into a list ; QSettings 会把未加引号的逗号拆成列表
+    config.client_weights = settings.value("Advanced/client_weights", config.client_weights).toStringList().join(';');
+    config.client_timeout_ms = std::max(0, settings.value("Advanced/client_timeout_ms", config.client_timeout_ms).toInt());
+
+    // Extra backends are edited in the INI file only ; 额外的上游只在 INI 文件中编辑
+    config.extra_backends.clear();
+    const int backendCount = settings.beginReadArray("Backends");
+    for (int i = 0; i < backendCount; ++i)
+    {
+        settings.setArrayIndex(i);
+        BackendConfig backend;
+        backend.api_address = settings.value("api_address").toString().trimmed();
+        backend.api_key = settings.value("api_key").toString();
+        backend.model_name = settings.value("model_name", config.model_name).toString();
+        backend.weight = std::max(0, settings.value("weight", backend.weight).toInt());
+        if (backend.api_address.endsWith('/'))
+            backend.api_address.chop(1);
+        if (!backend.api_address.isEmpty())
+            config.extra_backends.append(backend);
+    }
+    settings.endArray();
+}
+
 /**
  * Save configuration to an INI file.
  * 将配置保存到INI文件。
@@ -106,6 +161,53 @@ void ConfigManager::saveConfig(const AppConfig &config, const QString &filename)
     // Debug and batch flags ; 调试和批处理标志
     settings.setValue("Settings/enable_debug_mode", config.enable_debug_mode);
     settings.setValue("Settings/enable_batch", config.enable_batch);
+
+    // Advanced settings are edited by hand; only write the defaults so they can be found.
+    // 高级设置需手动编辑；此处仅写入默认值，方便用户找到。
+    if (!settings.contains("Advanced/enable_template_cache"))
+        settings.setValue("Advanced/enable_template_cache", config.enable_template_cache);
+    if (!settings.contains("Advanced/cache_budget_mb"))
+        settings.setValue("Advanced/cache_budget_mb", config.cache_budget_mb);
+    if (!settings.contains("Advanced/glossary_retranslate"))
+        settings.setValue("Advanced/glossary_retranslate", config.glossary_retranslate);
+    if (!settings.contains("Advanced/enable_streaming"))
+        settings.setValue("Advanced/enable_streaming", config.enable_streaming);
+    if (!settings.contains("Advanced/stream_max_chars"))
+        settings.setValue("Advanced/stream_max_chars", config.stream_max_chars);
+    if (!settings.contains("Advanced/micro_batch_window_ms"))
+        settings.setValue("Advanced/micro_batch_window_ms", config.micro_batch_window_ms);
+    if (!settings.contains("Advanced/micro_batch_max_items"))
+        settings.setValue("Advanced/micro_batch_max_items", config.micro_batch_max_items);
+    if (!settings.contains("Advanced/key_rpm"))
+        settings.setValue("Advanced/key_rpm", config.key_rpm);
+    if (!settings.contains("Advanced/key_tpm"))
+        settings.setValue("Advanced/key_tpm", config.key_tpm);
+    if (!settings.contains("Advanced/retry_budget_percent"))
+        settings.setValue("Advanced/retry_budget_percent", config.retry_budget_percent);
+    if (!settings.contains("Advanced/enable_hedging"))
+        settings.setValue("Advanced/enable_hedging", config.enable_hedging);
+    if (!settings.contains("Advanced/hedge_percentile"))
+        settings.setValue("Advanced/hedge_percentile", config.hedge_percentile);
+    if (!settings.contains("Advanced/hedge_budget_percent"))
+        settings.setValue("Advanced/hedge_budget_percent", config.hedge_budget_percent);
+    if (!settings.contains("Advanced/primary_weight"))
+        settings.setValue("Advanced/primary_weight", config.primary_weight);
+    if (!settings.contains("Advanced/timeout_floor_ms"))
+        settings.setValue("Advanced/timeout_floor_ms", config.timeout_floor_ms);
+    if (!settings.contains("Advanced/timeout_ceiling_ms"))
+        settings.setValue("Advanced/timeout_ceiling_ms", config.timeout_ceiling_ms);
+    if (!settings.contains("Advanced/max_queued_requests"))
+        settings.setValue("Advanced/max_queued_requests", config.max_queued_requests);
+    if (!settings.contains("Advanced/max_queue_ms"))
+        settings.setValue("Advanced/max_queue_ms", config.max_queue_ms);
+    if (!settings.contains("Advanced/upstream_concurrency"))
+        settings.setValue("Advanced/upstream_concurrency", config.upstream_concurrency);
+    if (!settings.contains("Advanced/scheduler_lifo"))
+        settings.setValue("Advanced/scheduler_lifo", config.scheduler_lifo);
+    if (!settings.contains("Advanced/client_weights"))
+        settings.setValue("Advanced/client_weights", config.client_weights);
+    if (!settings.contains("Advanced/client_timeout_ms"))
+        settings.setValue("Advanced/client_timeout_ms", config.client_timeout_ms);
     
     settings.sync();
 }
\ No newline at end of file
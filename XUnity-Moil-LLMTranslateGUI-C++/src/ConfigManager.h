@@ -2,6 +2,19 @@
 #include <QString>
 #include <QSettings>
 #include <QStringList>
+#include <QList>
+
+/**
+ * One OpenAI‑compatible upstream (address, key set, model) and its routing weight.
+ * 一个兼容 OpenAI 的上游（地址、密钥组、模型）及其路由权重。
+ */
+struct BackendConfig
+{
+    QString api_address;
+    QString api_key;    ///< Comma‑separated, same syntax as AppConfig::api_key ; 以逗号分隔，语法与 AppConfig::api_key 相同
+    QString model_name;
+    int weight = 1;     ///< Share of traffic; 0 = standby, used only when the others are degraded ; 流量份额；0 表示备用，仅在其他上游降级时使用
+};
 
 /**
  * Application configuration structure.
@@ -91,6 +104,59 @@ struct AppConfig
     /** Flag indicating whether the config originated from modern mode (used for saving UI settings). */
     bool is_from_modern = false;
 
+    // Advanced settings (INI only, section [Advanced], no UI)
+    // 高级设置（仅 INI 文件 [Advanced] 段，无界面）
+    /** Cache translations of number/tag templates ("HP [N_0]/[N_1]") and fill the values back locally.
+     *  Off by default: one template serves every value, which is wrong for languages whose wording
+     *  depends on the number. */
+    bool enable_template_cache = false;
+    /** Memory budget of the in‑memory translation cache in MB (the on‑disk store is not limited). */
+    int cache_budget_mb = 64;
+    /** Re‑translate cache entries invalidated by a glossary change in the background (costs tokens). */
+    bool glossary_retranslate = false;
+    /** Request streamed (SSE) replies and stop reading as soon as the translation is complete. */
+    bool enable_streaming = false;
+    /** Streamed replies (reasoning included) longer than this many characters are aborted as runaway. */
+    int stream_max_chars = 16000;
+    /** Collect concurrent single‑line Custom requests for this many ms and send them as one call (0 = off). */
+    int micro_batch_window_ms = 30;
+    /** A micro‑batch is sent as soon as it holds this many requests. */
+    int micro_batch_max_items = 16;
+    /** Requests per minute allowed per API key unless the key says "#rpm=" (0 = unlimited). */
+    int key_rpm = 0;
+    /** Tokens per minute allowed per API key unless the key says "#tpm=" (0 = unlimited). */
+    int key_tpm = 0;
+    /** Retries may add at most this share (in %) of first attempts to upstream load. */
+    int retry_budget_percent = 20;
+    /** Send a duplicate request when an attempt is slower than the recent hedge_percentile latency. */
+    bool enable_hedging = false;
+    /** Latency percentile (50‑99) after which an attempt is hedged. */
+    int hedge_percentile = 95;
+    /** Hedged requests may add at most this share (in %) to upstream load. */
+    int hedge_budget_percent = 5;
+    /** Routing weight of the backend configured in the UI (0 = standby). */
+    int primary_weight = 1;
+    /** Bounds of the per-request upstream timeout, which follows observed latency in between. */
+    int timeout_floor_ms = 5000;
+    int timeout_ceiling_ms = 90000;
+    /** Connections that may wait for an HTTP worker, and for how long, before getting 503. */
+    int max_queued_requests = 256;
+    int max_queue_ms = 10000;
+    /** Retry series sent upstream at once (0 = no limit); the rest wait in priority order. */
+    int upstream_concurrency = 16;
+    /** Serve the most urgent class newest-first instead of by deadline. */
+    bool scheduler_lifo = false;
+    /** Upstream share of each client IP, e.g. "192.168.1.10=3; 127.0.0.1=1" (unlisted clients weigh 1). */
+    QString client_weights;
+    /** How long clients wait for an answer (0 = unknown); an X-Client-Timeout-Ms header overrides it. */
+    int client_timeout_ms = 0;
+    /**
+     * Additional backends from the [Backends] array of the INI file
+     * (Backends\1\api_address, api_key, model_name, weight). Translations from a backend
+     * whose model differs from model_name are served but not cached.
+     */
+    QList<BackendConfig> extra_backends;
+
     /**
      * Constructor initializes the system prompt with a comprehensive set of rules.
      * 构造函数初始化系统提示，包含一套全面的规则。
@@ -134,4 +200,17 @@ public:
      * @param filename Path to the INI file (default: "config.ini")
      */
     static void saveConfig(const AppConfig &config, const QString &filename = "config.ini");
+
+    /**
+     * Read the [Advanced] settings, which have no UI, into an existing config.
+     * 将无界面的 [Advanced] 设置读入已有配置。
+     *
+     * The windows build their config from the widgets; they call this so values edited in
+     * the INI file still reach the server.
+     * 窗口根据控件构建配置；调用此函数可让 INI 中手动修改的值传递给服务器。
+     *
+     * @param config Config to update
+     * @param filename Path to the INI file (default: "config.ini")
+     */
+    static void loadAdvancedConfig(AppConfig &config, const QString &filename = "config.ini");
 };
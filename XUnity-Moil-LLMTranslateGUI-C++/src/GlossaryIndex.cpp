@@ -0,0 +1,196 @@
+#include "GlossaryIndex.h"
+#include "TranslationCache.h"
+
+// Same separator as TranslationCache scoped keys ; 与 TranslationCache 作用域键使用相同分隔符
+QString GlossaryIndex::entryKey(const QString &scope, const QString &source)
+{
+    return scope + QChar(0x1F) + source;
+}
+
+void GlossaryIndex::indexEntry(QHash<QString, QSet<QString>> &postings, QHash<QString, QSet<QString>> &entryTerms,
+                               const QString &key, const QString &loweredSource)
+{
+    for (auto it = postings.begin(); it != postings.end(); ++it)
+    {
+        if (loweredSource.contains(it.key()))
+        {
+            it.value().insert(key);
+            entryTerms[key].insert(it.key());
+        }
+    }
+}
+
+void GlossaryIndex::unindexEntry(QHash<QString, QSet<QString>> &postings, QHash<QString, QSet<QString>> &entryTerms,
+                                 const QString &key)
+{
+    auto found = entryTerms.find(key);
+    if (found == entryTerms.end())
+        return;
+    for (const QString &term : found.value())
+        postings[term].remove(key);
+    entryTerms.erase(found);
+}
+
+// The pending list is only needed while some walk may still replay it ; 仅在仍有遍历可能重放时才需要保留待处理列表
+void GlossaryIndex::endWalkLocked()
+{
+    if (--m_walks == 0)
+        m_pending.clear();
+}
+
+int GlossaryIndex::rebuild(const QStringList &terms, const std::function<bool()> &shouldStop)
+{
+    QStringList lowered;
+    for (const QString &term : terms)
+        lowered << term.toLower();
+
+    int firstPending = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        firstPending = m_pending.size();
+        m_walks++;
+    }
+
+    // Build outside the lock, then swap in ; 在锁外构建，然后替换
+    QHash<QString, QSet<QString>> postings;
+    QHash<QString, QSet<QString>> entryTerms;
+    for (const QString &term : lowered)
+        postings.insert(term, QSet<QString>());
+
+    bool stopped = false;
+    TranslationCache::instance().forEachEntry([&](const QString &scope, const QString &source, const QString &)
+                                              {
+        if (shouldStop && shouldStop())
+        {
+            stopped = true;
+            return false;
+        }
+        indexEntry(postings, entryTerms, entryKey(scope, source), source.toLower());
+        return true; });
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (stopped)
+    {
+        endWalkLocked();
+        return 0;
+    }
+
+    // Entries cached or dropped during the walk ; 遍历期间缓存或删除的条目
+    for (int i = firstPending; i < m_pending.size(); ++i)
+    {
+        const PendingChange &change = m_pending[i];
+        unindexEntry(postings, entryTerms, change.key);
+        if (change.added)
+            indexEntry(postings, entryTerms, change.key, change.loweredSource);
+    }
+    endWalkLocked();
+
+    int pairs = 0;
+    for (const QSet<QString> &terms : entryTerms)
+        pairs += terms.size();
+    m_postings.swap(postings);
+    m_entryTerms.swap(entryTerms);
+    m_built = true;
+    return pairs;
+}
+
+void GlossaryIndex::addEntry(const QString &scope, const QString &source)
+{
+    const QString key = entryKey(scope, source);
+    const QString text = source.toLower();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_walks > 0)
+        m_pending.append(PendingChange{true, key, text});
+    if (m_built)
+        indexEntry(m_postings, m_entryTerms, key, text);
+}
+
+void GlossaryIndex::removeEntry(const QString &scope, const QString &source)
+{
+    const QString key = entryKey(scope, source);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_walks > 0)
+        m_pending.append(PendingChange{false, key, QString()});
+    unindexEntry(m_postings, m_entryTerms, key);
+}
+
+QList<GlossaryIndex::Entry> GlossaryIndex::entriesFor(const QString &term, const std::function<bool()> &shouldStop)
+{
+    const QString lowered = term.toLower();
+    QList<Entry> entries;
+    QSet<QString> keys;
+    bool indexed = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto found = m_postings.constFind(lowered);
+        if (found != m_postings.constEnd())
+        {
+            keys = found.value();
+            indexed = true;
+        }
+    }
+
+    if (!indexed)
+    {
+        // New term: one walk over the memory, then it is indexed like the others.
+        // 新术语：遍历一次记忆，之后与其他术语一样被索引。
+        int firstPending = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            firstPending = m_pending.size();
+            m_walks++;
+        }
+        bool stopped = false;
+        TranslationCache::instance().forEachEntry([&](const QString &scope, const QString &source, const QString &)
+                                                  {
+            if (shouldStop && shouldStop())
+            {
+                stopped = true;
+                return false;
+            }
+            if (source.contains(lowered, Qt::CaseInsensitive))
+                keys.insert(entryKey(scope, source));
+            return true; });
+
+        // Entries cached or dropped during the walk ; 遍历期间缓存或删除的条目
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (int i = firstPending; !stopped && i < m_pending.size(); ++i)
+        {
+            const PendingChange &change = m_pending[i];
+            if (change.added && change.loweredSource.contains(lowered))
+                keys.insert(change.key);
+            else if (!change.added)
+                keys.remove(change.key);
+        }
+        endWalkLocked();
+        if (stopped)
+            return entries;
+        if (m_built)
+        {
+            m_postings.insert(lowered, keys);
+            for (const QString &key : keys)
+                m_entryTerms[key].insert(lowered);
+        }
+    }
+
+    for (const QString &key : keys)
+    {
+        int sep = key.indexOf(QChar(0x1F));
+        entries.append({key.left(sep), key.mid(sep + 1)});
+    }
+    return entries;
+}
+
+bool GlossaryIndex::isBuilt()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_built;
+}
+
+void GlossaryIndex::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_postings.clear();
+    m_entryTerms.clear();
+    m_built = false;
+}
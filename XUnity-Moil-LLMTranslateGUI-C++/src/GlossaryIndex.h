@@ -0,0 +1,86 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QMap>
+#include <QPair>
+#include <QList>
+#include <mutex>
+#include <functional>
+
+/**
+ * Inverted index from glossary term to the cached translations whose source contains it.
+ * 从术语到原文包含该术语的缓存译文的倒排索引。
+ *
+ * When a term is learned or edited, only these entries can be stale, so the server
+ * invalidates them instead of starting from a cold cache. Terms are matched the same
+ * way as GlossaryManager::getContextPrompt (case‑insensitive substring).
+ * 当学到或修改一个术语时，只有这些条目可能过时，因此服务器只使其失效，而不是让整个缓存
+ * 变冷。术语匹配方式与 GlossaryManager::getContextPrompt 相同（不区分大小写的子串）。
+ *
+ * Entries are identified by (scope, source) as in TranslationCache. Thread‑safe. Walks over
+ * the memory run outside the lock; entries added or removed meanwhile are recorded and
+ * replayed onto the walk's result before it is used, so none of them is lost.
+ * 条目与 TranslationCache 一样以（作用域，原文）标识。线程安全。遍历记忆在锁外进行；
+ * 遍历期间新增或删除的条目会被记录，并在使用遍历结果前重放，因此不会丢失。
+ */
+class GlossaryIndex
+{
+public:
+    using Entry = QPair<QString, QString>; ///< (scope, source) ; （作用域，原文）
+
+    /**
+     * Rebuild the index for a term list by walking the whole translation memory.
+     * 遍历整个翻译记忆，为术语列表重建索引。
+     *
+     * @param terms      Glossary terms (originals) ; 术语原文
+     * @param shouldStop Polled between entries ; 逐条轮询，用于提前终止
+     * @return Number of indexed (term, entry) pairs ; 建立索引的（术语，条目）对数
+     */
+    int rebuild(const QStringList &terms, const std::function<bool()> &shouldStop);
+
+    /**
+     * Index a freshly cached entry against the known terms (no‑op before the first rebuild).
+     * 针对已知术语为新缓存的条目建立索引（首次重建前不做任何事）。
+     */
+    void addEntry(const QString &scope, const QString &source);
+
+    /**
+     * Drop an entry from every posting list.
+     * 从所有倒排列表中删除条目。
+     */
+    void removeEntry(const QString &scope, const QString &source);
+
+    /**
+     * Entries whose source contains the term. A term that is not indexed yet (just learned)
+     * is looked up by walking the translation memory once and is indexed from then on.
+     * 原文包含该术语的条目。尚未建立索引的术语（刚学到的）会遍历一次翻译记忆，此后即被索引。
+     */
+    QList<Entry> entriesFor(const QString &term, const std::function<bool()> &shouldStop);
+
+    bool isBuilt();
+    void clear();
+
+private:
+    struct PendingChange
+    {
+        bool added; ///< Added (true) or removed (false) ; 新增（true）或删除（false）
+        QString key;
+        QString loweredSource;
+    };
+
+    static QString entryKey(const QString &scope, const QString &source);
+    static void indexEntry(QHash<QString, QSet<QString>> &postings, QHash<QString, QSet<QString>> &entryTerms,
+                           const QString &key, const QString &loweredSource);
+    static void unindexEntry(QHash<QString, QSet<QString>> &postings, QHash<QString, QSet<QString>> &entryTerms,
+                             const QString &key);
+    void endWalkLocked();
+
+    std::mutex m_mutex;
+    QHash<QString, QSet<QString>> m_postings; ///< Lower‑case term → entry keys ; 小写术语 → 条目键
+    QHash<QString, QSet<QString>> m_entryTerms; ///< Entry key → lower‑case terms ; 条目键 → 小写术语
+    bool m_built = false;
+    int m_walks = 0;                   ///< Walks over the memory in progress ; 进行中的记忆遍历数
+    QList<PendingChange> m_pending;    ///< Changes made while a walk runs ; 遍历期间发生的变更
+};
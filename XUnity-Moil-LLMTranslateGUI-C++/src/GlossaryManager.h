@@ -6,6 +6,18 @@
 #include <QTextStream>
 #include <QFileInfo>
 #include <QDebug>
+#include <QCryptographicHash>
+#include <QList>
+#include <functional>
+
+/**
+ * One changed glossary term. An empty value means the term was removed.
+ * 一条变更的术语。值为空表示该术语被删除。
+ */
+struct GlossaryChange {
+    QString term;  // Original text ; 原文
+    QString value; // New translation, empty if removed ; 新译文，删除时为空
+};
 
 /**
  * Glossary manager class, responsible for loading, querying, and updating translation terms.
@@ -42,9 +54,76 @@ public:
      * @param path Path to the glossary file (e.g., "glossary.txt") ; 术语表文件路径（例如 "glossary.txt"）
      */
     void setFilePath(const QString& path) {
-        QWriteLocker locker(&m_lock);          // Write lock for exclusive modification ; 写锁，用于独占修改
-        m_filePath = path;
-        loadTerms();
+        QList<GlossaryChange> changes;
+        ChangeListener listener;
+        {
+            QWriteLocker locker(&m_lock);      // Write lock for exclusive modification ; 写锁，用于独占修改
+            const bool reload = !m_filePath.isEmpty() && m_filePath == path;
+            QMap<QString, QString> previous = m_terms;
+            m_filePath = path;
+            loadTerms();
+            // Only a reload of the same file is an edit; another path is another game ; 只有重新加载同一文件才算编辑，换路径即换游戏
+            if (reload)
+                changes = diffTerms(previous, m_terms);
+            listener = m_listener;
+        }
+        // Notify outside the lock so the listener may query the glossary ; 在锁外通知，监听者可以查询术语表
+        if (listener && !changes.isEmpty())
+            listener(changes);
+    }
+
+    /**
+     * Callback for term changes (edits on reload and terms learned by addNewTerm).
+     * 术语变更回调（重新加载时的编辑以及 addNewTerm 学到的术语）。
+     */
+    using ChangeListener = std::function<void(const QList<GlossaryChange>&)>;
+    void setChangeListener(const ChangeListener& listener) {
+        QWriteLocker locker(&m_lock);
+        m_listener = listener;
+    }
+
+    /**
+     * Snapshot of all terms.
+     * 所有术语的快照。
+     */
+    QMap<QString, QString> terms() const {
+        QReadLocker locker(&m_lock);
+        return m_terms;
+    }
+
+    /**
+     * Terms that were added, changed or removed between two snapshots.
+     * 两个快照之间新增、修改或删除的术语。
+     */
+    static QList<GlossaryChange> diffTerms(const QMap<QString, QString>& before, const QMap<QString, QString>& after) {
+        QList<GlossaryChange> changes;
+        for (auto it = after.cbegin(); it != after.cend(); ++it) {
+            auto old = before.constFind(it.key());
+            if (old == before.cend() || old.value() != it.value())
+                changes.append({it.key(), it.value()});
+        }
+        for (auto it = before.cbegin(); it != before.cend(); ++it) {
+            if (!after.contains(it.key()))
+                changes.append({it.key(), QString()});
+        }
+        return changes;
+    }
+
+    /**
+     * Revision of the glossary as loaded from the file (content digest, empty if no terms).
+     * 从文件加载的术语表版本（内容摘要，无术语时为空）。
+     *
+     * Derived from the content rather than a running counter, so it is stable across restarts
+     * and only changes when the glossary file itself was edited; used to skip diffing an
+     * unchanged glossary at startup.
+     * 由内容计算而非递增计数，因此在重启后保持稳定，只有术语表文件本身被修改时才会变化；
+     * 启动时据此跳过对未变化术语表的比对。
+     *
+     * @return First 8 hex characters of the MD5 over the sorted terms ; 排序后术语 MD5 的前 8 个十六进制字符
+     */
+    QString revision() const {
+        QReadLocker locker(&m_lock);
+        return m_revision;
     }
 
     /**
@@ -99,22 +178,28 @@ public:
      * @param value Translated text (target language) ; 译文（目标语言）
      */
     void addNewTerm(const QString& key, const QString& value) {
-        QWriteLocker locker(&m_lock);            // Write lock for modification ; 写锁，用于修改
-
-        // Basic validation to maintain data integrity ; 基本验证以保持数据完整性
-        // Length checks: key at least 2 characters, value at least 1 character ; 长度检查：键至少2个字符，值至少1个字符
-        if (key.length() < 2 || value.length() < 1) return;
-        // Prevent duplicate entries ; 防止重复条目
-        if (m_terms.contains(key)) return;
-        // Avoid breaking the file format (no equals sign in key/value) ; 避免破坏文件格式（键/值中不能有等号）
-        if (key.contains("=") || value.contains("=")) return;
-        // Avoid newlines that would corrupt the line‑based storage ; 避免换行符破坏基于行的存储
-        if (key.contains("\n") || value.contains("\n")) return;
-
-        // Update the in‑memory map ; 更新内存映射
-        m_terms.insert(key, value);
-        // Persist the new term by appending to the file ; 通过追加到文件来持久化新术语
-        appendToFile(key, value);
+        ChangeListener listener;
+        {
+            QWriteLocker locker(&m_lock);        // Write lock for modification ; 写锁，用于修改
+
+            // Basic validation to maintain data integrity ; 基本验证以保持数据完整性
+            // Length checks: key at least 2 characters, value at least 1 character ; 长度检查：键至少2个字符，值至少1个字符
+            if (key.length() < 2 || value.length() < 1) return;
+            // Prevent duplicate entries ; 防止重复条目
+            if (m_terms.contains(key)) return;
+            // Avoid breaking the file format (no equals sign in key/value) ; 避免破坏文件格式（键/值中不能有等号）
+            if (key.contains("=") || value.contains("=")) return;
+            // Avoid newlines that would corrupt the line‑based storage ; 避免换行符破坏基于行的存储
+            if (key.contains("\n") || value.contains("\n")) return;
+
+            // Update the in‑memory map ; 更新内存映射
+            m_terms.insert(key, value);
+            // Persist the new term by appending to the file ; 通过追加到文件来持久化新术语
+            appendToFile(key, value);
+            listener = m_listener;
+        }
+        if (listener)
+            listener({{key, value}});
     }
 
 private:
@@ -134,6 +219,7 @@ private:
      */
     void loadTerms() {
         m_terms.clear();
+        m_revision.clear();
         if (m_filePath.isEmpty()) return;
 
         QFile file(m_filePath);
@@ -154,6 +240,14 @@ private:
                 }
             }
         }
+
+        // QMap iterates in key order, so the digest does not depend on line order ; QMap 按键排序迭代，摘要与行序无关
+        if (!m_terms.isEmpty()) {
+            QCryptographicHash hash(QCryptographicHash::Md5);
+            for (auto it = m_terms.cbegin(); it != m_terms.cend(); ++it)
+                hash.addData((it.key() + "=" + it.value() + "\n").toUtf8());
+            m_revision = hash.result().toHex().left(8);
+        }
     }
 
     /**
@@ -179,6 +273,8 @@ private:
 
     QString m_filePath;                     // Path to the glossary file ; 术语表文件路径
     QMap<QString, QString> m_terms;          // In‑memory map of terms (original → translation) ; 内存术语映射（原文 → 译文）
+    QString m_revision;                      // Content digest at load time ; 加载时的内容摘要
+    ChangeListener m_listener;               // Term change callback ; 术语变更回调
 
     /**
      * Read‑write lock to protect concurrent access to m_terms and file operations.
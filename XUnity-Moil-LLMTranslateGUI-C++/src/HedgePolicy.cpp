@@ -0,0 +1,75 @@
+#include "HedgePolicy.h"
+#include <algorithm>
+
+// Latencies kept, and how many are needed before hedging starts.
+// 保留的延迟样本数，以及开始对冲前所需的样本数。
+static const size_t LATENCY_WINDOW = 256;
+static const size_t MIN_SAMPLES = 20;
+// Never hedge sooner than this; a fast upstream gains nothing from duplicates.
+// 对冲不早于此时间；上游很快时重复请求没有收益。
+static const qint64 MIN_TRIGGER_MS = 500;
+static const double BUDGET_MAX = 5.0;
+
+void HedgePolicy::configure(int percentile, int budgetPercent)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_percentile = std::clamp(percentile, 50, 99);
+    m_percent = std::max(0, budgetPercent);
+}
+
+void HedgePolicy::recordLatency(qint64 ms)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_latencies.size() < LATENCY_WINDOW)
+    {
+        m_latencies.push_back(ms);
+        return;
+    }
+    m_latencies[m_next] = ms;
+    m_next = (m_next + 1) % LATENCY_WINDOW;
+}
+
+qint64 HedgePolicy::triggerMs()
+{
+    std::vector<qint64> samples;
+    int percentile = 95;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_latencies.size() < MIN_SAMPLES)
+            return -1;
+        samples = m_latencies;
+        percentile = m_percentile;
+    }
+    const size_t rank = std::min(samples.size() - 1, samples.size() * size_t(percentile) / 100);
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return std::max(samples[rank], MIN_TRIGGER_MS);
+}
+
+void HedgePolicy::recordAttempt()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_balance = std::min(BUDGET_MAX, m_balance + m_percent / 100.0);
+}
+
+bool HedgePolicy::tryHedge()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_balance < 1.0)
+        return false;
+    m_balance -= 1.0;
+    m_hedges++;
+    return true;
+}
+
+void HedgePolicy::refund()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_balance = std::min(BUDGET_MAX, m_balance + 1.0);
+    m_hedges--;
+}
+
+void HedgePolicy::resetStats()
+{
+    m_hedges = 0;
+    m_wins = 0;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <QtGlobal>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+/**
+ * When to send a hedged (duplicate) upstream request, and how many.
+ * 何时发送对冲（重复）上游请求，以及可以发送多少。
+ *
+ * Recent upstream latencies are kept in a small window; an attempt still running after their
+ * p90/p95 gets a second, identical request and the first valid answer wins. Hedges are paid
+ * from a budget that each attempt refills by budget_percent/100, so they add at most about
+ * budget_percent to upstream load.
+ * 在一个小窗口中保存最近的上游延迟；超过其 p90/p95 仍未返回的尝试会再发送一次相同请求，
+ * 先返回的有效答案胜出。对冲从预算中支付，每次尝试向预算存入 budget_percent/100，
+ * 因此对冲最多只会给上游增加约 budget_percent 的负载。
+ *
+ * Thread‑safe.
+ * 线程安全。
+ */
+class HedgePolicy
+{
+public:
+    /**
+     * Set the latency percentile that triggers a hedge and the extra load allowed.
+     * 设置触发对冲的延迟分位数与允许的额外负载。
+     */
+    void configure(int percentile, int budgetPercent);
+
+    /**
+     * Record the latency of an upstream request that succeeded.
+     * 记录一次成功的上游请求的延迟。
+     */
+    void recordLatency(qint64 ms);
+
+    /**
+     * Delay after which an attempt is hedged.
+     * 尝试在多长时间后进行对冲。
+     *
+     * @return Delay in ms, or -1 while too few latencies are known ; 延迟毫秒数；已知延迟过少时返回 -1
+     */
+    qint64 triggerMs();
+
+    /**
+     * A new attempt was sent (deposits into the budget).
+     * 发送了一次新的尝试（向预算存入额度）。
+     */
+    void recordAttempt();
+
+    /**
+     * Take one hedge from the budget.
+     * 从预算中取出一次对冲。
+     */
+    bool tryHedge();
+
+    /**
+     * Return a hedge that could not be sent.
+     * 归还一次未能发送的对冲。
+     */
+    void refund();
+
+    /**
+     * The hedge answered first.
+     * 对冲请求先返回了有效答案。
+     */
+    void recordWin() { m_wins++; }
+
+    quint64 hedges() const { return m_hedges; }
+    quint64 wins() const { return m_wins; }
+    void resetStats();
+
+private:
+    std::mutex m_mutex;
+    std::vector<qint64> m_latencies; ///< Ring of recent latencies ; 最近延迟的环形缓冲
+    size_t m_next = 0;
+    int m_percentile = 95;
+    double m_percent = 5;
+    double m_balance = 0; ///< Hedges available ; 可用的对冲次数
+
+    std::atomic<quint64> m_hedges{0};
+    std::atomic<quint64> m_wins{0};
+};
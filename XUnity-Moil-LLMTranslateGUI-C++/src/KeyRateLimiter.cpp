@@ -0,0 +1,309 @@
+#include "KeyRateLimiter.h"
+#include <QDateTime>
+#include <QStringList>
+#include <algorithm>
+#include <cmath>
+
+// Failures in a row (5xx, timeout) that open a key's circuit ; 打开熔断器所需的连续失败次数（5xx、超时）
+static const int CIRCUIT_FAILURE_THRESHOLD = 3;
+static const qint64 CIRCUIT_OPEN_MS = 30000;      ///< First cooldown ; 首次冷却时间
+static const qint64 CIRCUIT_AUTH_OPEN_MS = 300000; ///< Cooldown after 401/403 ; 401/403 后的冷却时间
+static const qint64 CIRCUIT_MAX_OPEN_MS = 600000;
+// Wait hint while another request probes a half-open key ; 其他请求正在探测半开密钥时的等待提示
+static const qint64 CIRCUIT_PROBE_WAIT_MS = 1000;
+// Weight of the newest result in the success rate and latency averages ; 最新结果在成功率与延迟均值中的权重
+static const double HEALTH_ALPHA = 0.1;
+
+QList<KeySpec> KeyRateLimiter::parseKeys(const QString &field, int defaultRpm, int defaultTpm)
+{
+    QList<KeySpec> keys;
+    for (const QString &entry : field.split(',', Qt::SkipEmptyParts))
+    {
+        KeySpec spec;
+        spec.key = stripLimits(entry);
+        if (spec.key.isEmpty())
+            continue;
+        spec.rpm = std::max(0, defaultRpm);
+        spec.tpm = std::max(0, defaultTpm);
+
+        const QString options = entry.section('#', 1);
+        for (const QString &option : options.split(';', Qt::SkipEmptyParts))
+        {
+            const QString name = option.section('=', 0, 0).trimmed().toLower();
+            const int value = std::max(0, option.section('=', 1).trimmed().toInt());
+            if (name == "rpm")
+                spec.rpm = value;
+            else if (name == "tpm")
+                spec.tpm = value;
+        }
+        keys.append(spec);
+    }
+    return keys;
+}
+
+QString KeyRateLimiter::stripLimits(const QString &entry)
+{
+    return entry.section('#', 0, 0).trimmed();
+}
+
+QString KeyRateLimiter::maskKey(const QString &key)
+{
+    return (key.length() > 8) ? ("..." + key.right(8)) : key;
+}
+
+void KeyRateLimiter::configure(const QList<KeySpec> &keys)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    std::vector<Bucket> buckets;
+    for (const KeySpec &spec : keys)
+    {
+        Bucket *old = findLocked(spec.key);
+        Bucket bucket = old ? *old : Bucket();
+        if (!old)
+            bucket.lastRefillMs = now;
+        // A new key or a changed limit starts with a full bucket ; 新密钥或限额变更后令牌桶初始为满
+        if (!old || old->spec.rpm != spec.rpm)
+            bucket.requestTokens = spec.rpm;
+        if (!old || old->spec.tpm != spec.tpm)
+            bucket.tokenTokens = spec.tpm;
+        bucket.spec = spec;
+        buckets.push_back(bucket);
+    }
+    m_buckets.swap(buckets);
+    m_cursor = 0;
+}
+
+bool KeyRateLimiter::isEmpty()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_buckets.empty();
+}
+
+void KeyRateLimiter::refill(Bucket &bucket, qint64 now)
+{
+    const double elapsed = double(std::max<qint64>(now - bucket.lastRefillMs, 0));
+    bucket.lastRefillMs = now;
+    if (bucket.spec.rpm > 0)
+        bucket.requestTokens = std::min<double>(bucket.spec.rpm, bucket.requestTokens + elapsed * bucket.spec.rpm / 60000.0);
+    if (bucket.spec.tpm > 0)
+        bucket.tokenTokens = std::min<double>(bucket.spec.tpm, bucket.tokenTokens + elapsed * bucket.spec.tpm / 60000.0);
+}
+
+/**
+ * Time until a bucket can serve a request of this size (0 if it can now).
+ * 令牌桶可以服务该大小的请求前需要等待的时间（现在即可则为 0）。
+ */
+qint64 KeyRateLimiter::waitFor(const Bucket &bucket, int estimatedTokens, qint64 now)
+{
+    double wait = double(std::max<qint64>(bucket.blockedUntilMs - now, 0));
+    if (bucket.circuit == KeyCircuit::Open)
+        wait = std::max(wait, double(bucket.openUntilMs - now));
+    else if (bucket.circuit == KeyCircuit::HalfOpen && bucket.probeInFlight)
+        wait = std::max(wait, double(CIRCUIT_PROBE_WAIT_MS));
+    if (bucket.spec.rpm > 0 && bucket.requestTokens < 1.0)
+        wait = std::max(wait, (1.0 - bucket.requestTokens) * 60000.0 / bucket.spec.rpm);
+    if (bucket.spec.tpm > 0)
+    {
+        // A request larger than the whole bucket only needs a full bucket.
+        // 大于整个桶的请求只需等到桶满。
+        const double needed = std::min<double>(estimatedTokens, bucket.spec.tpm);
+        if (bucket.tokenTokens < needed)
+            wait = std::max(wait, (needed - bucket.tokenTokens) * 60000.0 / bucket.spec.tpm);
+    }
+    return qint64(std::ceil(wait));
+}
+
+QString KeyRateLimiter::acquire(int estimatedTokens, qint64 &waitMs, const QString &exclude)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    waitMs = 0;
+    if (m_buckets.empty())
+        return QString();
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const size_t count = m_buckets.size();
+    int best = -1;
+    double bestHeadroom = -1.0;
+    qint64 shortestWait = -1;
+    for (size_t n = 0; n < count; ++n)
+    {
+        const size_t i = (m_cursor + n) % count;
+        Bucket &bucket = m_buckets[i];
+        refill(bucket, now);
+        if (!exclude.isEmpty() && bucket.spec.key == exclude)
+            continue;
+
+        const qint64 wait = waitFor(bucket, estimatedTokens, now);
+        if (wait > 0)
+        {
+            shortestWait = (shortestWait < 0) ? wait : std::min(shortestWait, wait);
+            continue;
+        }
+        if (bucket.circuit != KeyCircuit::Closed)
+        {
+            // Cooldown over: this request is the probe ; 冷却结束：本次请求即为探测
+            best = int(i);
+            break;
+        }
+        // Headroom is the smaller of the two buckets' remaining share, weighted by health.
+        // 余量取两个桶剩余比例中较小的一个，并按健康度加权。
+        double headroom = 1.0;
+        if (bucket.spec.rpm > 0)
+            headroom = std::min(headroom, bucket.requestTokens / bucket.spec.rpm);
+        if (bucket.spec.tpm > 0)
+            headroom = std::min(headroom, bucket.tokenTokens / bucket.spec.tpm);
+        headroom *= bucket.successRate;
+        if (headroom > bestHeadroom)
+        {
+            best = int(i);
+            bestHeadroom = headroom;
+        }
+    }
+
+    if (best < 0)
+    {
+        waitMs = std::max<qint64>(shortestWait, 1);
+        return QString();
+    }
+
+    Bucket &chosen = m_buckets[size_t(best)];
+    if (chosen.circuit != KeyCircuit::Closed)
+    {
+        chosen.circuit = KeyCircuit::HalfOpen;
+        chosen.probeInFlight = true;
+    }
+    if (chosen.spec.rpm > 0)
+        chosen.requestTokens -= 1.0;
+    if (chosen.spec.tpm > 0)
+        chosen.tokenTokens -= std::min<double>(estimatedTokens, chosen.spec.tpm);
+    chosen.requests++;
+    m_cursor = (size_t(best) + 1) % count;
+    return chosen.spec.key;
+}
+
+KeyRateLimiter::Bucket *KeyRateLimiter::findLocked(const QString &key)
+{
+    for (Bucket &bucket : m_buckets)
+    {
+        if (bucket.spec.key == key)
+            return &bucket;
+    }
+    return nullptr;
+}
+
+void KeyRateLimiter::settle(const QString &key, int estimatedTokens, int actualTokens)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Bucket *bucket = findLocked(key);
+    if (!bucket || bucket->spec.tpm <= 0)
+        return;
+    const double charged = std::min<double>(estimatedTokens, bucket->spec.tpm);
+    // The bucket may go negative after a large reply; it then refills before the next request.
+    // 大的回复可能使桶变为负值；之后需先回填才能发出下一个请求。
+    bucket->tokenTokens = std::max<double>(bucket->tokenTokens + charged - actualTokens, -double(bucket->spec.tpm));
+}
+
+void KeyRateLimiter::openCircuit(Bucket &bucket, qint64 cooldownMs, qint64 now, Verdict &verdict)
+{
+    bucket.circuit = KeyCircuit::Open;
+    bucket.openForMs = std::min(cooldownMs, CIRCUIT_MAX_OPEN_MS);
+    bucket.openUntilMs = now + bucket.openForMs;
+    bucket.consecutiveFailures = 0;
+    verdict.circuitOpened = true;
+    verdict.openForMs = bucket.openForMs;
+}
+
+KeyRateLimiter::Verdict KeyRateLimiter::report(const QString &key, KeyOutcome outcome, qint64 latencyMs, qint64 retryAfterMs)
+{
+    Verdict verdict;
+    // Without Retry-After, rest the key briefly ; 没有 Retry-After 时让密钥短暂休息
+    if (outcome == KeyOutcome::RateLimited)
+        verdict.pauseMs = (retryAfterMs > 0) ? retryAfterMs : 2000;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Bucket *bucket = findLocked(key);
+    if (!bucket)
+        return verdict;
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const bool probing = (bucket->circuit == KeyCircuit::HalfOpen);
+    bucket->probeInFlight = false;
+
+    switch (outcome)
+    {
+    case KeyOutcome::Cancelled:
+        return verdict;
+    case KeyOutcome::NetworkError:
+        bucket->networkErrors++;
+        return verdict;
+    case KeyOutcome::Success:
+    case KeyOutcome::RateLimited:
+        // A 429 still proves the key is accepted ; 429 仍说明密钥本身可用
+        if (outcome == KeyOutcome::Success)
+        {
+            bucket->successes++;
+            bucket->successRate += HEALTH_ALPHA * (1.0 - bucket->successRate);
+            bucket->avgLatencyMs = (bucket->avgLatencyMs <= 0) ? double(latencyMs)
+                                                                : bucket->avgLatencyMs + HEALTH_ALPHA * (latencyMs - bucket->avgLatencyMs);
+        }
+        else
+        {
+            bucket->throttled++;
+            bucket->requestTokens = 0;
+            bucket->blockedUntilMs = std::max(bucket->blockedUntilMs, now + verdict.pauseMs);
+        }
+        bucket->consecutiveFailures = 0;
+        if (bucket->circuit != KeyCircuit::Closed)
+        {
+            bucket->circuit = KeyCircuit::Closed;
+            bucket->openForMs = 0;
+            verdict.circuitClosed = true;
+        }
+        return verdict;
+    case KeyOutcome::AuthError:
+        bucket->authErrors++;
+        break;
+    case KeyOutcome::ServerError:
+        bucket->serverErrors++;
+        break;
+    case KeyOutcome::Timeout:
+        bucket->timeouts++;
+        break;
+    }
+
+    bucket->successRate -= HEALTH_ALPHA * bucket->successRate;
+    bucket->consecutiveFailures++;
+    if (probing)
+        openCircuit(*bucket, std::max(bucket->openForMs * 2, outcome == KeyOutcome::AuthError ? CIRCUIT_AUTH_OPEN_MS : CIRCUIT_OPEN_MS), now, verdict);
+    else if (outcome == KeyOutcome::AuthError)
+        openCircuit(*bucket, CIRCUIT_AUTH_OPEN_MS, now, verdict);
+    else if (bucket->circuit == KeyCircuit::Closed && bucket->consecutiveFailures >= CIRCUIT_FAILURE_THRESHOLD)
+        openCircuit(*bucket, CIRCUIT_OPEN_MS, now, verdict);
+    return verdict;
+}
+
+QList<KeyRateLimiter::KeyStats> KeyRateLimiter::stats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QList<KeyStats> list;
+    for (const Bucket &bucket : m_buckets)
+    {
+        KeyStats s;
+        s.key = bucket.spec.key;
+        s.requests = bucket.requests;
+        s.successes = bucket.successes;
+        s.authErrors = bucket.authErrors;
+        s.throttled = bucket.throttled;
+        s.serverErrors = bucket.serverErrors;
+        s.timeouts = bucket.timeouts;
+        s.networkErrors = bucket.networkErrors;
+        s.successRate = bucket.successRate;
+        s.avgLatencyMs = qint64(bucket.avgLatencyMs);
+        s.circuit = bucket.circuit;
+        if (bucket.circuit == KeyCircuit::Open)
+            s.reopenInMs = std::max<qint64>(bucket.openUntilMs - now, 0);
+        list.append(s);
+    }
+    return list;
+}
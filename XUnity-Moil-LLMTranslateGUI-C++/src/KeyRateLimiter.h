@@ -0,0 +1,191 @@
+#pragma once
+#include <QString>
+#include <QList>
+#include <mutex>
+#include <vector>
+
+/**
+ * One API key with its provider limits (0 = unlimited).
+ * 一个 API 密钥及其服务商限额（0 表示不限）。
+ */
+struct KeySpec
+{
+    QString key;
+    int rpm = 0; ///< Requests per minute ; 每分钟请求数
+    int tpm = 0; ///< Tokens per minute ; 每分钟 token 数
+};
+
+/**
+ * How an upstream request sent with a key ended.
+ * 使用某个密钥发送的上游请求的结束方式。
+ */
+enum class KeyOutcome
+{
+    Success,      ///< The provider answered ; 服务商已应答
+    AuthError,    ///< 401 / 403: revoked, exhausted or wrong key ; 密钥被吊销、额度耗尽或错误
+    RateLimited,  ///< 429
+    ServerError,  ///< 5xx
+    Timeout,
+    NetworkError, ///< No HTTP response; not the key's fault ; 无 HTTP 响应，与密钥无关
+    Cancelled     ///< Aborted by us (stop, early cancel) ; 被本地中止（停止服务、提前取消）
+};
+
+/**
+ * Circuit breaker state of a key.
+ * 密钥的熔断状态。
+ */
+enum class KeyCircuit
+{
+    Closed,   ///< In normal use ; 正常使用
+    Open,     ///< Skipped until the cooldown ends ; 冷却结束前不使用
+    HalfOpen  ///< One probe request decides ; 由一次探测请求决定
+};
+
+/**
+ * Per‑key token buckets for requests/min and tokens/min, plus per‑key health and a circuit breaker.
+ * 按密钥的每分钟请求数与每分钟 token 数令牌桶，以及按密钥的健康度与熔断器。
+ *
+ * Keys are written as "sk-a#rpm=60;tpm=90000, sk-b" in the API key field; keys without
+ * limits use the [Advanced] defaults. acquire() picks the key with the most headroom instead
+ * of blind round‑robin, and reports how long to wait when every key is saturated. A 429 from
+ * the provider empties the key's request bucket and blocks it for Retry‑After.
+ * 在 API 密钥栏中写作 "sk-a#rpm=60;tpm=90000, sk-b"；未写限额的密钥使用 [Advanced] 中的默认值。
+ * acquire() 选择余量最多的密钥，而不是盲目轮询；所有密钥都已饱和时返回需要等待的时间。
+ * 服务商返回 429 时，清空该密钥的请求桶并按 Retry‑After 暂停使用。
+ *
+ * A 401/403 opens a key's circuit at once; repeated 5xx or timeouts open it after a few
+ * failures in a row. An open key is skipped until its cooldown ends, then a single real
+ * request probes it: success closes the circuit, failure reopens it with a doubled cooldown.
+ * Headroom is weighted by the key's recent success rate.
+ * 401/403 会立即打开密钥的熔断器；连续多次 5xx 或超时后也会打开。打开的密钥在冷却结束前被跳过，
+ * 之后由一次真实请求进行探测：成功则关闭熔断器，失败则以加倍的冷却时间重新打开。
+ * 余量按密钥近期的成功率加权。
+ *
+ * Thread‑safe.
+ * 线程安全。
+ */
+class KeyRateLimiter
+{
+public:
+    struct KeyStats
+    {
+        QString key;
+        quint64 requests = 0;
+        quint64 successes = 0;
+        quint64 authErrors = 0;   ///< 401 / 403
+        quint64 throttled = 0;    ///< 429 responses ; 429 响应数
+        quint64 serverErrors = 0; ///< 5xx
+        quint64 timeouts = 0;
+        quint64 networkErrors = 0;
+        double successRate = 1.0; ///< Recent, exponentially weighted ; 近期成功率（指数加权）
+        qint64 avgLatencyMs = 0;  ///< Recent, exponentially weighted ; 近期平均延迟（指数加权）
+        KeyCircuit circuit = KeyCircuit::Closed;
+        qint64 reopenInMs = 0;    ///< Time until an open circuit is probed ; 打开的熔断器距离探测的时间
+    };
+
+    /**
+     * What a reported result did to the key.
+     * 上报的结果对密钥产生的影响。
+     */
+    struct Verdict
+    {
+        qint64 pauseMs = 0;         ///< 429 pause applied ; 因 429 而暂停的时长
+        bool circuitOpened = false; ///< The circuit has just opened ; 熔断器刚刚打开
+        bool circuitClosed = false; ///< A probe succeeded and closed it ; 探测成功，熔断器已关闭
+        qint64 openForMs = 0;       ///< Cooldown of the opened circuit ; 打开后的冷却时间
+    };
+
+    /**
+     * Parse the comma‑separated API key field.
+     * 解析以逗号分隔的 API 密钥栏。
+     *
+     * @param field      Text of the API key field ; API 密钥栏文本
+     * @param defaultRpm Limit for keys without "rpm=" ; 未写 "rpm=" 的密钥的限额
+     * @param defaultTpm Limit for keys without "tpm=" ; 未写 "tpm=" 的密钥的限额
+     */
+    static QList<KeySpec> parseKeys(const QString &field, int defaultRpm, int defaultTpm);
+
+    /**
+     * The bare key of one entry, without its "#rpm=..;tpm=.." suffix.
+     * 一个条目中的纯密钥，去掉 "#rpm=..;tpm=.." 后缀。
+     */
+    static QString stripLimits(const QString &entry);
+
+    /**
+     * Last eight characters of a key for logs.
+     * 用于日志的密钥后八位。
+     */
+    static QString maskKey(const QString &key);
+
+    /**
+     * Replace the key list. Keys that stay keep their buckets, health and counters.
+     * 替换密钥列表。保留下来的密钥沿用其令牌桶、健康度与计数。
+     */
+    void configure(const QList<KeySpec> &keys);
+
+    bool isEmpty();
+
+    /**
+     * Take one request and the estimated tokens from the key with the most headroom.
+     * A key whose cooldown has ended is given the request as its half‑open probe.
+     * 从余量最多的密钥中取出一次请求与预估的 token 数。冷却已结束的密钥会以该请求作为半开探测。
+     *
+     * @param estimatedTokens Prompt + expected completion tokens ; 提示词加预期输出的 token 数
+     * @param waitMs          Receives the time until a key frees up when none is available ; 无可用密钥时写入需等待的时间
+     * @param exclude         Key not to use (e.g. the one a hedged request is already on) ; 不使用的密钥（例如被对冲请求已在使用的密钥）
+     * @return The key, or an empty string if every key is saturated or open ; 密钥；全部饱和或熔断时返回空字符串
+     */
+    QString acquire(int estimatedTokens, qint64 &waitMs, const QString &exclude = QString());
+
+    /**
+     * Correct a key's token bucket once the real usage is known.
+     * 得知实际用量后修正密钥的 token 桶。
+     */
+    void settle(const QString &key, int estimatedTokens, int actualTokens);
+
+    /**
+     * Record how a request sent with a key ended. Every acquire() must be followed by one report.
+     * 记录使用某个密钥的请求的结束方式。每次 acquire() 之后都必须上报一次。
+     *
+     * @param latencyMs    Request duration ; 请求耗时
+     * @param retryAfterMs Provider's Retry‑After for a 429, 0 if none ; 429 时服务商给出的 Retry‑After，无则为 0
+     */
+    Verdict report(const QString &key, KeyOutcome outcome, qint64 latencyMs, qint64 retryAfterMs = 0);
+
+    QList<KeyStats> stats();
+
+private:
+    struct Bucket
+    {
+        KeySpec spec;
+        double requestTokens = 0;
+        double tokenTokens = 0;
+        qint64 lastRefillMs = 0;
+        qint64 blockedUntilMs = 0;
+
+        KeyCircuit circuit = KeyCircuit::Closed;
+        qint64 openUntilMs = 0;
+        qint64 openForMs = 0;       ///< Last cooldown, doubled on a failed probe ; 上次冷却时间，探测失败时加倍
+        bool probeInFlight = false;
+        int consecutiveFailures = 0;
+        double successRate = 1.0;
+        double avgLatencyMs = 0;
+
+        quint64 requests = 0;
+        quint64 successes = 0;
+        quint64 authErrors = 0;
+        quint64 throttled = 0;
+        quint64 serverErrors = 0;
+        quint64 timeouts = 0;
+        quint64 networkErrors = 0;
+    };
+
+    static void refill(Bucket &bucket, qint64 now);
+    static qint64 waitFor(const Bucket &bucket, int estimatedTokens, qint64 now);
+    static void openCircuit(Bucket &bucket, qint64 cooldownMs, qint64 now, Verdict &verdict);
+    Bucket *findLocked(const QString &key);
+
+    std::mutex m_mutex;
+    std::vector<Bucket> m_buckets;
+    size_t m_cursor = 0; ///< Round‑robin start for ties ; 余量相同时的轮询起点
+};
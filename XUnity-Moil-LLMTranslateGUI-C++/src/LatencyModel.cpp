@@ -0,0 +1,46 @@
+#include "LatencyModel.h"
+#include <algorithm>
+#include <cmath>
+
+// Weight kept by older samples per new one (about the last 30 requests count) ; 每个新样本加入时旧样本保留的权重（约统计最近 30 次请求）
+static const double DECAY = 0.97;
+static const int MIN_SAMPLES = 10;
+
+void LatencyModel::record(int tokens, qint64 latencyMs)
+{
+    const double x = std::max(tokens, 1);
+    const double y = double(latencyMs);
+
+    qint64 predictedMs = 0;
+    qint64 spreadMs = 0;
+    if (predict(tokens, predictedMs, spreadMs))
+        m_absError = DECAY * m_absError + (1.0 - DECAY) * std::abs(y - predictedMs);
+    else
+        m_absError = std::max(m_absError, 0.25 * y); // Rough spread until the fit settles ; 拟合稳定前的粗略离散度
+
+    m_weight = DECAY * m_weight + 1.0;
+    m_sumX = DECAY * m_sumX + x;
+    m_sumY = DECAY * m_sumY + y;
+    m_sumXX = DECAY * m_sumXX + x * x;
+    m_sumXY = DECAY * m_sumXY + x * y;
+    m_samples++;
+}
+
+bool LatencyModel::predict(int tokens, qint64 &predictedMs, qint64 &spreadMs) const
+{
+    if (m_samples < MIN_SAMPLES)
+        return false;
+
+    const double meanX = m_sumX / m_weight;
+    const double meanY = m_sumY / m_weight;
+    const double varX = m_sumXX / m_weight - meanX * meanX;
+    // Requests of one size only: the slope is unknown, use the mean ; 只有一种长度的请求时斜率未知，使用均值
+    double slope = 0;
+    if (varX > 1.0)
+        slope = std::max(0.0, (m_sumXY / m_weight - meanX * meanY) / varX);
+    const double overhead = std::max(0.0, meanY - slope * meanX);
+
+    predictedMs = qint64(overhead + slope * std::max(tokens, 1));
+    spreadMs = qint64(m_absError);
+    return true;
+}
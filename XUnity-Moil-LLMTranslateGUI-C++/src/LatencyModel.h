@@ -0,0 +1,51 @@
+#pragma once
+#include <QtGlobal>
+
+/**
+ * Running estimate of upstream latency as a function of the expected output length.
+ * 按预期输出长度估计上游延迟的滚动模型。
+ *
+ * Latency is fitted as overhead + msPerToken × tokens by exponentially weighted least squares,
+ * so both the fixed cost of a request (queueing, prompt processing) and the generation speed
+ * follow the backend as it speeds up or slows down. The mean absolute error of recent
+ * predictions gives the spread used to size timeouts.
+ * 用指数加权最小二乘法将延迟拟合为 固定开销 + 每 token 毫秒数 × token 数，使请求的固定成本
+ * （排队、处理提示词）与生成速度都能跟随上游的快慢变化。近期预测的平均绝对误差作为离散度，
+ * 用于确定超时时间。
+ *
+ * Not thread‑safe; the owner locks.
+ * 非线程安全，由持有者加锁。
+ */
+class LatencyModel
+{
+public:
+    /**
+     * Add the latency of a request that completed.
+     * 加入一次完成的请求的延迟。
+     *
+     * @param tokens    Expected output tokens of the request ; 请求的预期输出 token 数
+     * @param latencyMs Request duration ; 请求耗时
+     */
+    void record(int tokens, qint64 latencyMs);
+
+    /**
+     * Predicted duration of a request.
+     * 预测一次请求的耗时。
+     *
+     * @param tokens      Expected output tokens ; 预期输出 token 数
+     * @param predictedMs Receives the predicted duration ; 写入预测耗时
+     * @param spreadMs    Receives the typical prediction error ; 写入典型预测误差
+     * @return false while too few requests are known ; 已知请求过少时返回 false
+     */
+    bool predict(int tokens, qint64 &predictedMs, qint64 &spreadMs) const;
+
+private:
+    // Exponentially weighted sums for the least-squares fit ; 最小二乘拟合的指数加权累加量
+    double m_weight = 0;
+    double m_sumX = 0;
+    double m_sumY = 0;
+    double m_sumXX = 0;
+    double m_sumXY = 0;
+    double m_absError = 0; ///< Mean absolute prediction error ; 平均绝对预测误差
+    int m_samples = 0;
+};
@@ -9,6 +9,7 @@
 #include "MainWindow.h"
 #include "json.hpp"
 #include "LogManager.h"
+#include "QuarantineManager.h"
 #include <QDialog>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -35,6 +36,7 @@
 
 #include <QSyntaxHighlighter>
 #include <QRegularExpression>
+#include <QTimer>
 
 // ==========================================
 // Glossary syntax highlighter (real‑time rendering of "original=translation")
@@ -180,10 +182,20 @@ const char *STR_CHK_GLOSSARY[] = {"Self-Evolve", "启用自进化"};
 const char *STR_CLEAR_LOG[] = {"Clear Log", "清空日志"};
 const char *STR_REMOVE_PATH[] = {"Remove Current Path", "移除当前路径"};
 const char *STR_CLEAR_HISTORY[] = {"Clear All History", "清空历史记录"};
+const char *STR_SHOW_QUARANTINE[] = {"Show Quarantined Texts (%1)", "查看隔离文本 (%1)"};
+const char *STR_RELEASE_QUARANTINE[] = {"Release Quarantined Texts", "解除全部隔离"};
+const char *LOG_QUARANTINE_HEAD[] = {"🚫 === Quarantined Texts (%1) ===", "🚫 === 隔离文本 (%1) ==="};
+const char *LOG_QUARANTINE_ITEM[] = {"  [%1 failures, %2 s left] ", "  [失败 %1 次，剩余 %2 秒] "};
+const char *LOG_QUARANTINE_EMPTY[] = {"🚫 No quarantined texts", "🚫 当前没有隔离文本"};
+const char *LOG_QUARANTINE_RELEASED[] = {"🚫 Quarantine released", "🚫 已解除全部隔离"};
+const char *STR_CACHE_STATS[] = {"Show Cache Statistics", "查看缓存统计"};
 
 // Token statistics text / Token统计文本
 const char *STR_TOKENS[] = {"Tokens:", "消耗:"};
 const char *TIP_TOKENS[] = {"Total Usage (Prompt + Completion)", "本次运行总消耗 (输入+输出)"};
+const char *STR_QUEUE[] = {"Queue:", "排队:"};
+const char *TIP_QUEUE[] = {"HTTP queue: %1 / %2 waiting, %3 / %4 workers busy, %5 rejected with 503",
+                           "HTTP 队列：%1 / %2 等待中，%3 / %4 个线程忙碌，%5 个请求以 503 拒绝"};
 
 // Context clearing related text / 上下文清除相关文本
 const char *STR_CLEAR_CTX[] = {"Clr", "清空"};
@@ -312,6 +324,12 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
     connect(server, &TranslationServer::workStarted, this, &MainWindow::onServerWorkStarted);
     connect(server, &TranslationServer::workFinished, this, &MainWindow::onServerWorkFinished);
 
+    // Poll the admission queue so backpressure shows next to the token count.
+    // 轮询准入队列，使背压情况显示在 token 计数旁。
+    QTimer *admissionTimer = new QTimer(this);
+    connect(admissionTimer, &QTimer::timeout, this, &MainWindow::refreshAdmissionStats);
+    admissionTimer->start(1000);
+
     // 5. Load configuration / 加载配置
     loadConfigToUi();
 
@@ -1204,6 +1222,30 @@ void MainWindow::onLogContextMenu(const QPoint &pos)
     connect(clearAction, &QAction::triggered, []()
             { LogManager::instance().clear(); });
 
+    menu->addSeparator();
+    QAction *statsAction = menu->addAction(STR_CACHE_STATS[m_currentLang]);
+    connect(statsAction, &QAction::triggered, [this]()
+            { server->logCacheStats(); });
+
+    // Texts that kept failing translation, listed in the log for manual review.
+    // 反复翻译失败的文本，输出到日志以便人工检查。
+    int lang = m_currentLang;
+    QAction *showQuarantine = menu->addAction(QString(STR_SHOW_QUARANTINE[lang]).arg(QuarantineManager::instance().activeCount()));
+    connect(showQuarantine, &QAction::triggered, [lang]()
+            {
+        QList<QuarantineEntry> entries = QuarantineManager::instance().entries();
+        if (entries.isEmpty()) { LOG(LOG_QUARANTINE_EMPTY[lang]); return; }
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        LOG(QString(LOG_QUARANTINE_HEAD[lang]).arg(entries.size()));
+        for (const QuarantineEntry &e : entries)
+            LOG(QString(LOG_QUARANTINE_ITEM[lang]).arg(e.failures).arg(qMax<qint64>(0, (e.untilMs - now + 999) / 1000)) + e.text); });
+
+    QAction *releaseQuarantine = menu->addAction(STR_RELEASE_QUARANTINE[lang]);
+    connect(releaseQuarantine, &QAction::triggered, [lang]()
+            {
+        QuarantineManager::instance().releaseAll();
+        LOG(LOG_QUARANTINE_RELEASED[lang]); });
+
     menu->exec(logArea->mapToGlobal(pos));
     delete menu;
 }
@@ -1249,6 +1291,8 @@ AppConfig MainWindow::getUiConfig()
     cfg.lock_system_prompt = chkLockSysPrompt->isChecked();
     cfg.lock_glossary = chkLockGlossary->isChecked();
 
+    ConfigManager::loadAdvancedConfig(cfg);
+
     return cfg;
 }
 
@@ -1630,7 +1674,7 @@ void MainWindow::onFetchModels()
     QNetworkRequest req(url + "/models");
     req.setTransferTimeout(10000);
 
-    QString key = apiKeyEdit->text().split(',')[0].trimmed();
+    QString key = KeyRateLimiter::stripLimits(apiKeyEdit->text().split(',')[0]);
     req.setRawHeader("Authorization", ("Bearer " + key).toUtf8());
 
     QNetworkReply *reply = mgr->get(req);
@@ -1692,7 +1736,7 @@ void MainWindow::onTestConfig()
 
     for (int i = 0; i < total; ++i)
     {
-        QString key = keys[i].trimmed();
+        QString key = KeyRateLimiter::stripLimits(keys[i]);
         QString keyMasked = (key.length() > 8) ? ("..." + key.right(8)) : key;
 
         QNetworkAccessManager *mgr = new QNetworkAccessManager(this);
@@ -1709,7 +1753,7 @@ void MainWindow::onTestConfig()
 
         QNetworkReply *reply = mgr->post(req, QByteArray::fromStdString(j.dump()));
 
-        connect(reply, &QNetworkReply::finished, [this, reply, mgr, keyMasked, i, finishedCount, successCount, total]()
+        connect(reply, &QNetworkReply::finished, [this, reply, mgr, key, keyMasked, i, finishedCount, successCount, total]()
                 {
             (*finishedCount)++;
             bool isOk = (reply->error() == QNetworkReply::NoError);
@@ -1724,6 +1768,10 @@ void MainWindow::onTestConfig()
             
             server->injectLog(QString("%1 Key-%2 (%3): %4")
                             .arg(icon).arg(i + 1).arg(keyMasked).arg(status));
+            // Live state of the key in the running server ; 运行中服务器里该密钥的实时状态
+            QString health = server->describeKeyHealth(key, m_currentLang);
+            if (!health.isEmpty())
+                server->injectLog("   ↳ " + health);
 
             if (*finishedCount == total) {
                 if(testLoadingOverlay) testLoadingOverlay->stop();
@@ -1753,7 +1801,12 @@ void MainWindow::updateTokenDisplay(long long total, long long prompt, long long
     lblTokens->setProperty("prompt", prompt);
     lblTokens->setProperty("completion", completion);
 
-    lblTokens->setText(QString("%1 %2").arg(STR_TOKENS[m_currentLang]).arg(total));
+    const int queued = lblTokens->property("queued").toInt();
+    const qulonglong rejected = lblTokens->property("rejected").toULongLong();
+    QString text = QString("%1 %2").arg(STR_TOKENS[m_currentLang]).arg(total);
+    if (queued > 0 || rejected > 0)
+        text += QString("  |  %1 %2").arg(STR_QUEUE[m_currentLang]).arg(queued) + (rejected > 0 ? QString(" (503×%1)").arg(rejected) : QString());
+    lblTokens->setText(text);
 
     QString strPrompt = (m_currentLang == 1) ? "输入 (Prompt):" : "Input (Prompt):";
     QString strCompletion = (m_currentLang == 1) ? "输出 (Completion):" : "Output (Completion):";
@@ -1764,6 +1817,13 @@ void MainWindow::updateTokenDisplay(long long total, long long prompt, long long
                           .arg(prompt)
                           .arg(strCompletion)
                           .arg(completion);
+    if (server && server->isRunning())
+        fullTip += "<br><br>" + QString(TIP_QUEUE[m_currentLang])
+                                    .arg(queued)
+                                    .arg(lblTokens->property("maxQueued").toInt())
+                                    .arg(lblTokens->property("active").toInt())
+                                    .arg(lblTokens->property("workers").toInt())
+                                    .arg(rejected);
 
     lblTokens->setToolTip(fullTip);
 
@@ -1775,6 +1835,31 @@ void MainWindow::updateTokenDisplay(long long total, long long prompt, long long
     }
 }
 
+/**
+ * Refresh the admission queue figures shown with the token count.
+ * 刷新与 token 计数一同显示的准入队列数据。
+ */
+void MainWindow::refreshAdmissionStats()
+{
+    if (!server || !lblTokens)
+        return;
+    const AdmissionController::Stats stats = server->admissionStats();
+    const qulonglong rejected = stats.rejectedFull + stats.rejectedStale;
+    if (lblTokens->property("queued").toInt() == stats.queued &&
+        lblTokens->property("active").toInt() == stats.active &&
+        lblTokens->property("rejected").toULongLong() == rejected)
+        return;
+
+    lblTokens->setProperty("queued", stats.queued);
+    lblTokens->setProperty("active", stats.active);
+    lblTokens->setProperty("workers", stats.workers);
+    lblTokens->setProperty("maxQueued", stats.maxQueued);
+    lblTokens->setProperty("rejected", rejected);
+    updateTokenDisplay(lblTokens->property("total").toLongLong(),
+                       lblTokens->property("prompt").toLongLong(),
+                       lblTokens->property("completion").toLongLong());
+}
+
 void MainWindow::onClearContext()
 {
     server->clearAllContexts();
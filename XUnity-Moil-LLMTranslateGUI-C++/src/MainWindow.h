@@ -72,6 +72,7 @@ private slots:
     // Status update slots
     // 状态更新槽函数
     void updateTokenDisplay(long long total, long long prompt, long long completion);
+    void refreshAdmissionStats();
     void onClearContext();
     void onLogMessage(QString msg);
     
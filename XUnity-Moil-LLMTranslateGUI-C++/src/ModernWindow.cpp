@@ -34,6 +34,7 @@
 #include "ConfigManager.h"
 #include "json.hpp"
 #include "LogManager.h"
+#include "QuarantineManager.h"
 #include <functional>              // Required for std::function / 必须用于std::function
 #include <QLabel>                  // Used for screenshot overlay / 用于截图覆盖层
 #include <QPixmap>                 // Used for screen capture / 用于捕获屏幕
@@ -93,11 +94,20 @@ extern const char *STR_START[];
 extern const char *STR_RELOAD[];
 extern const char *STR_STOP[];
 extern const char *STR_TOKENS[];
+extern const char *STR_QUEUE[];
+extern const char *TIP_QUEUE[];
 extern const char *STR_FETCH[];
 extern const char *STR_TEST[];
 extern const char *STR_CLEAR_LOG[];
 extern const char *STR_REMOVE_PATH[];
 extern const char *STR_CLEAR_HISTORY[];
+extern const char *STR_SHOW_QUARANTINE[];
+extern const char *STR_RELEASE_QUARANTINE[];
+extern const char *LOG_QUARANTINE_HEAD[];
+extern const char *LOG_QUARANTINE_ITEM[];
+extern const char *LOG_QUARANTINE_EMPTY[];
+extern const char *LOG_QUARANTINE_RELEASED[];
+extern const char *STR_CACHE_STATS[];
 extern const char *TIP_TOKENS[];
 extern const char *TIP_PORT[];
 extern const char *TIP_THREAD[];
@@ -195,6 +205,12 @@ ModernWindow::ModernWindow(TranslationServer *server, QWidget *parent)
                 { updatePowerButtonState(true); });
         connect(m_server, &TranslationServer::serverStopped, this, [this]()
                 { updatePowerButtonState(false); });
+
+        // Poll the admission queue so backpressure shows next to the token count.
+        // 轮询准入队列，使背压情况显示在 token 计数旁。
+        QTimer *admissionTimer = new QTimer(this);
+        connect(admissionTimer, &QTimer::timeout, this, &ModernWindow::refreshAdmissionStats);
+        admissionTimer->start(1000);
     }
 
     // Apply the initial style based on theme and rounded flag.
@@ -807,7 +823,12 @@ void ModernWindow::updateToken(long long total, long long p, long long c)
     lblTokens->setProperty("current_p", p);
     lblTokens->setProperty("current_c", c);
 
-    lblTokens->setText(QString("%1 %2").arg(STR_TOKENS[m_lang]).arg(total));
+    const int queued = lblTokens->property("queued").toInt();
+    const qulonglong rejected = lblTokens->property("rejected").toULongLong();
+    QString text = QString("%1 %2").arg(STR_TOKENS[m_lang]).arg(total);
+    if (queued > 0 || rejected > 0)
+        text += QString("  |  %1 %2").arg(STR_QUEUE[m_lang]).arg(queued) + (rejected > 0 ? QString(" (503×%1)").arg(rejected) : QString());
+    lblTokens->setText(text);
 
     QString pL = (m_lang == 1) ? "输入总计 (Total Prompt):" : "Total Input:";
     QString cL = (m_lang == 1) ? "输出总计 (Total Completion):" : "Total Output:";
@@ -818,9 +839,41 @@ void ModernWindow::updateToken(long long total, long long p, long long c)
                           .arg(p)
                           .arg(cL)
                           .arg(c);
+    if (m_server && m_server->isRunning())
+        fullTip += "<br><br>" + QString(TIP_QUEUE[m_lang])
+                                    .arg(queued)
+                                    .arg(lblTokens->property("maxQueued").toInt())
+                                    .arg(lblTokens->property("active").toInt())
+                                    .arg(lblTokens->property("workers").toInt())
+                                    .arg(rejected);
     lblTokens->setToolTip(fullTip);
 }
 
+/**
+ * Refresh the admission queue figures shown with the token count.
+ * 刷新与 token 计数一同显示的准入队列数据。
+ */
+void ModernWindow::refreshAdmissionStats()
+{
+    if (!m_server || !lblTokens)
+        return;
+    const AdmissionController::Stats stats = m_server->admissionStats();
+    const qulonglong rejected = stats.rejectedFull + stats.rejectedStale;
+    if (lblTokens->property("queued").toInt() == stats.queued &&
+        lblTokens->property("active").toInt() == stats.active &&
+        lblTokens->property("rejected").toULongLong() == rejected)
+        return;
+
+    lblTokens->setProperty("queued", stats.queued);
+    lblTokens->setProperty("active", stats.active);
+    lblTokens->setProperty("workers", stats.workers);
+    lblTokens->setProperty("maxQueued", stats.maxQueued);
+    lblTokens->setProperty("rejected", rejected);
+    updateToken(lblTokens->property("current_total").toLongLong(),
+                lblTokens->property("current_p").toLongLong(),
+                lblTokens->property("current_c").toLongLong());
+}
+
 /**
  * Fetch the list of models from the API (triggered by the Fetch button).
  * 从API获取模型列表（由获取按钮触发）。
@@ -879,7 +932,7 @@ void ModernWindow::onFetchModels()
     QNetworkAccessManager *mgr = new QNetworkAccessManager(this);
     QNetworkRequest req;
     req.setUrl(QUrl(urlBase + "/models"));
-    QString key = apiKeyEdit->text().split(',')[0].trimmed();
+    QString key = KeyRateLimiter::stripLimits(apiKeyEdit->text().split(',')[0]);
     req.setRawHeader("Authorization", ("Bearer " + key).toUtf8());
     req.setTransferTimeout(10000);
 
@@ -978,7 +1031,7 @@ void ModernWindow::onTestConfig()
 
     for (int i = 0; i < ttl; ++i)
     {
-        QString key = keys[i].trimmed();
+        QString key = KeyRateLimiter::stripLimits(keys[i]);
         QString msk = (key.length() > 8) ? ("..." + key.right(8)) : key;
         QNetworkAccessManager *mgr = new QNetworkAccessManager(this);
         QNetworkRequest req;
@@ -994,7 +1047,7 @@ void ModernWindow::onTestConfig()
 
         QNetworkReply *rep = mgr->post(req, QByteArray::fromStdString(j.dump()));
 
-        connect(rep, &QNetworkReply::finished, [this, rep, mgr, msk, i, fnd, scs, ttl, spinTimer]()
+        connect(rep, &QNetworkReply::finished, [this, rep, mgr, key, msk, i, fnd, scs, ttl, spinTimer]()
                 {
             (*fnd)++; if(rep->error() == QNetworkReply::NoError) (*scs)++;
             int cd = rep->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(); 
@@ -1003,6 +1056,10 @@ void ModernWindow::onTestConfig()
             QString icn = (rep->error() == QNetworkReply::NoError) ? "✅" : "❌";
             QString st = (rep->error() == QNetworkReply::NoError) ? (m_lang == 1 ? "通过" : "PASS") : getFriendlyErrorMessage(cd, m_lang);
             m_server->injectLog(QString("%1 Key-%2 (%3): %4").arg(icn).arg(i+1).arg(msk).arg(st));
+            // Live state of the key in the running server ; 运行中服务器里该密钥的实时状态
+            QString health = m_server->describeKeyHealth(key, m_lang);
+            if (!health.isEmpty())
+                m_server->injectLog("   ↳ " + health);
             
             if(*fnd == ttl) {
                 // Stop spinning and restore button.
@@ -1206,6 +1263,8 @@ AppConfig ModernWindow::getUiConfig()
     cfg.is_from_modern = true;
     cfg.enable_batch = chkBatch->isChecked();
 
+    ConfigManager::loadAdvancedConfig(cfg);
+
     return cfg;
 }
 
@@ -1645,6 +1704,30 @@ void ModernWindow::onLogContextMenu(const QPoint &pos)
                                                 // 调用全局清空。
             });
 
+    m->addSeparator();
+    QAction *st = m->addAction(STR_CACHE_STATS[m_lang]);
+    connect(st, &QAction::triggered, [this]()
+            { if (m_server) m_server->logCacheStats(); });
+
+    // Texts that kept failing translation, listed in the log for manual review.
+    // 反复翻译失败的文本，输出到日志以便人工检查。
+    int lang = m_lang;
+    QAction *sq = m->addAction(QString(STR_SHOW_QUARANTINE[lang]).arg(QuarantineManager::instance().activeCount()));
+    connect(sq, &QAction::triggered, [lang]()
+            {
+        QList<QuarantineEntry> entries = QuarantineManager::instance().entries();
+        if (entries.isEmpty()) { LOG(LOG_QUARANTINE_EMPTY[lang]); return; }
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        LOG(QString(LOG_QUARANTINE_HEAD[lang]).arg(entries.size()));
+        for (const QuarantineEntry &e : entries)
+            LOG(QString(LOG_QUARANTINE_ITEM[lang]).arg(e.failures).arg(qMax<qint64>(0, (e.untilMs - now + 999) / 1000)) + e.text); });
+
+    QAction *rq = m->addAction(STR_RELEASE_QUARANTINE[lang]);
+    connect(rq, &QAction::triggered, [lang]()
+            {
+        QuarantineManager::instance().releaseAll();
+        LOG(LOG_QUARANTINE_RELEASED[lang]); });
+
     m->exec(logArea->mapToGlobal(pos));
     delete m;
 }
@@ -112,6 +112,7 @@ private slots:
     void onOpacityChange(int val);       ///< Handle opacity slider change / 处理透明度滑块变化
     void updateLog(QString msg);         ///< Append a message to the log area / 将消息追加到日志区域
     void updateToken(long long total, long long p, long long c); ///< Update token display / 更新令牌显示
+    void refreshAdmissionStats();          ///< Poll the server's admission queue / 轮询服务器准入队列
     void onClearContext();                ///< Clear all context memory / 清除所有上下文记忆
     void onOpenAutoTranslations();        ///< Open _AutoGeneratedTranslations.txt / 打开自动翻译文件
     void onEditGlossaryClicked();         ///< Open the glossary drawer / 打开术语表抽屉
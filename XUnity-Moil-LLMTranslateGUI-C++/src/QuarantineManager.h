@@ -0,0 +1,167 @@
+#pragma once
+
+#include <QString>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QDateTime>
+#include <algorithm>
+
+/**
+ * One quarantined (or recently failing) text.
+ * 一条被隔离（或近期失败）的文本。
+ */
+struct QuarantineEntry
+{
+    QString text;            ///< Source text as sent by XUnity ; XUnity 发送的原文
+    int failures = 0;        ///< Consecutive failed translations ; 连续失败次数
+    qint64 lastFailureMs = 0; ///< Time of the last failure (epoch ms) ; 最近一次失败时间（毫秒）
+    qint64 untilMs = 0;       ///< Quarantine end (epoch ms) ; 隔离结束时间（毫秒）
+};
+
+/**
+ * QuarantineManager - negative cache for texts that repeatedly fail translation (singleton).
+ * 隔离管理器 - 反复翻译失败文本的负缓存（单例模式）。
+ *
+ * When a text exhausts all retries because the model refused it or returned an invalid
+ * result, it is quarantined: further requests for it fail immediately instead of tying up
+ * a worker for five more attempts. Each new failure doubles the quarantine time (30 s up to
+ * 1 h); a successful translation forgets the text. The GUI lists the entries for review.
+ * 当一条文本因模型拒绝或返回无效结果而耗尽所有重试时，它会被隔离：之后对它的请求会立即失败，
+ * 不再占用工作线程重试五次。每次新的失败会让隔离时间翻倍（30 秒至 1 小时）；翻译成功后遗忘该文本。
+ * GUI 会列出这些条目以便人工检查。
+ */
+class QuarantineManager
+{
+public:
+    static QuarantineManager &instance()
+    {
+        static QuarantineManager _instance;
+        return _instance;
+    }
+
+    /**
+     * Check whether a key is currently quarantined.
+     * 检查某个键当前是否处于隔离状态。
+     *
+     * @param key         Cache/flight key of the text ; 文本的缓存/合并键
+     * @param remainingMs Receives the remaining quarantine time ; 写入剩余隔离时间
+     */
+    bool isQuarantined(const QString &key, qint64 &remainingMs)
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_entries.constFind(key);
+        if (it == m_entries.constEnd())
+            return false;
+        remainingMs = it->untilMs - QDateTime::currentMSecsSinceEpoch();
+        return remainingMs > 0;
+    }
+
+    /**
+     * Number of consecutive failures recorded for a key (0 if unknown).
+     * 某个键记录的连续失败次数（未知时为 0）。
+     */
+    int failureCount(const QString &key)
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_entries.constFind(key);
+        return it == m_entries.constEnd() ? 0 : it->failures;
+    }
+
+    /**
+     * Record a failed translation and (re)start its quarantine with exponential growth.
+     * 记录一次翻译失败，并以指数增长方式（重新）开始隔离。
+     *
+     * @return Quarantine duration in ms ; 隔离时长（毫秒）
+     */
+    qint64 recordFailure(const QString &key, const QString &text)
+    {
+        QMutexLocker locker(&m_mutex);
+        purgeLocked();
+
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        QuarantineEntry &e = m_entries[key];
+        e.text = text;
+        e.failures++;
+        e.lastFailureMs = now;
+
+        qint64 duration = BASE_QUARANTINE_MS << std::min(e.failures - 1, 7);
+        duration = std::min(duration, MAX_QUARANTINE_MS);
+        e.untilMs = now + duration;
+        return duration;
+    }
+
+    /**
+     * Forget a text after it was translated successfully.
+     * 文本翻译成功后将其遗忘。
+     */
+    void recordSuccess(const QString &key)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_entries.remove(key);
+    }
+
+    /**
+     * Snapshot of all entries, most recent failure first.
+     * 所有条目的快照，最近失败的排在最前。
+     */
+    QList<QuarantineEntry> entries()
+    {
+        QMutexLocker locker(&m_mutex);
+        QList<QuarantineEntry> list = m_entries.values();
+        std::sort(list.begin(), list.end(), [](const QuarantineEntry &a, const QuarantineEntry &b)
+                  { return a.lastFailureMs > b.lastFailureMs; });
+        return list;
+    }
+
+    /**
+     * Number of texts whose quarantine is still running.
+     * 仍处于隔离期的文本数量。
+     */
+    int activeCount()
+    {
+        QMutexLocker locker(&m_mutex);
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        return int(std::count_if(m_entries.cbegin(), m_entries.cend(), [now](const QuarantineEntry &e)
+                                 { return e.untilMs > now; }));
+    }
+
+    /**
+     * Release every text (manual review done, or prompts changed).
+     * 释放所有文本（人工检查完毕或提示词已修改）。
+     */
+    void releaseAll()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_entries.clear();
+    }
+
+private:
+    QuarantineManager() {}
+    QuarantineManager(const QuarantineManager &) = delete;
+    QuarantineManager &operator=(const QuarantineManager &) = delete;
+
+    /**
+     * Drop entries whose last failure is older than a day, so the map cannot grow forever.
+     * 删除最近失败超过一天的条目，避免映射无限增长。
+     */
+    void purgeLocked()
+    {
+        const qint64 cutoff = QDateTime::currentMSecsSinceEpoch() - FORGET_AFTER_MS;
+        for (auto it = m_entries.begin(); it != m_entries.end();)
+        {
+            if (it->lastFailureMs < cutoff && it->untilMs < cutoff)
+                it = m_entries.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    static constexpr qint64 BASE_QUARANTINE_MS = 30 * 1000;     // First quarantine: 30 s ; 首次隔离 30 秒
+    static constexpr qint64 MAX_QUARANTINE_MS = 60 * 60 * 1000; // Upper bound: 1 h ; 上限 1 小时
+    static constexpr qint64 FORGET_AFTER_MS = 24 * 60 * 60 * 1000;
+
+    QHash<QString, QuarantineEntry> m_entries; ///< key → entry ; 键 → 条目
+    QMutex m_mutex;
+};
@@ -0,0 +1,45 @@
+#include "RequestLifetime.h"
+#include <QDateTime>
+
+RequestLifetime::RequestLifetime(qint64 arrivalMs, qint64 deadlineMs, std::function<bool()> connectionClosed)
+    : m_arrivalMs(arrivalMs), m_deadlineMs(deadlineMs), m_connectionClosed(std::move(connectionClosed))
+{
+}
+
+bool RequestLifetime::abandoned()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_abandoned)
+        return true;
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (m_deadlineMs > 0 && now >= m_deadlineMs)
+    {
+        m_abandoned = true;
+    }
+    else if (m_connectionClosed && now - m_lastProbeMs >= PROBE_INTERVAL_MS)
+    {
+        // A zero-timeout poll of the socket, but still a system call per probe ; 对套接字的零超时轮询，但每次探测仍是一次系统调用
+        m_lastProbeMs = now;
+        m_abandoned = m_connectionClosed();
+    }
+    return m_abandoned;
+}
+
+void RequestLifetime::release()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_connectionClosed = nullptr;
+    m_abandoned = true;
+}
+
+bool RequestLifetime::allAbandoned(const std::vector<std::shared_ptr<RequestLifetime>> &lifetimes)
+{
+    if (lifetimes.empty())
+        return false;
+    for (const std::shared_ptr<RequestLifetime> &lifetime : lifetimes)
+    {
+        if (!lifetime || !lifetime->abandoned())
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <QtGlobal>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Whether the client of an HTTP request is still waiting for the answer.
+ * HTTP 请求的客户端是否仍在等待答案。
+ *
+ * XUnity gives up on a request after its own timeout and sends the text again later, so a
+ * translation still queued or running after that only burns tokens and an upstream slot.
+ * A request is abandoned once its deadline (arrival + the client's timeout, from the
+ * X-Client-Timeout-Ms header or the configured default) has passed, once its connection
+ * has been closed by the client, or once the handler has stopped waiting (release()).
+ * XUnity 会在自身超时后放弃请求，稍后再次发送该文本，因此在那之后仍在排队或运行的翻译只会消耗
+ * token 与上游名额。截止时间（到达时间 + 客户端超时，来自 X-Client-Timeout-Ms 请求头或配置的默认值）
+ * 已过、客户端已关闭连接，或处理函数已不再等待（release()）时，请求即视为已放弃。
+ *
+ * Thread‑safe. Once abandoned, a request stays abandoned.
+ * 线程安全。一旦放弃，请求始终保持放弃状态。
+ */
+class RequestLifetime
+{
+public:
+    /**
+     * @param arrivalMs        When the request was accepted ; 请求被接受的时间
+     * @param deadlineMs       When the client stops waiting, 0 for no deadline ; 客户端停止等待的时间，0 表示无截止时间
+     * @param connectionClosed Probe of the client connection, valid until release() ; 客户端连接的探测函数，在 release() 之前有效
+     */
+    RequestLifetime(qint64 arrivalMs, qint64 deadlineMs, std::function<bool()> connectionClosed);
+
+    qint64 arrivalMs() const { return m_arrivalMs; }
+    qint64 deadlineMs() const { return m_deadlineMs; }
+
+    /**
+     * True once nobody waits for the answer any more. The connection is probed at most every
+     * PROBE_INTERVAL_MS.
+     * 已经没有人等待答案时返回 true。连接最多每 PROBE_INTERVAL_MS 探测一次。
+     */
+    bool abandoned();
+
+    /**
+     * The handler has returned; its connection must not be probed any more.
+     * 处理函数已返回；此后不能再探测其连接。
+     */
+    void release();
+
+    /**
+     * True if every request waiting for a shared result has been abandoned. A null entry
+     * (our own background work) never gives up.
+     * 等待同一结果的所有请求都已放弃时返回 true。空条目（本程序自身的后台工作）永不放弃。
+     */
+    static bool allAbandoned(const std::vector<std::shared_ptr<RequestLifetime>> &lifetimes);
+
+    static constexpr qint64 PROBE_INTERVAL_MS = 200;
+
+private:
+    const qint64 m_arrivalMs;
+    const qint64 m_deadlineMs;
+    std::mutex m_mutex;
+    std::function<bool()> m_connectionClosed;
+    qint64 m_lastProbeMs = 0;
+    bool m_abandoned = false;
+};
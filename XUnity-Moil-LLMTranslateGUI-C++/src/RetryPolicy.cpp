@@ -0,0 +1,84 @@
+#include "RetryPolicy.h"
+#include <QDateTime>
+#include <QRandomGenerator>
+#include <algorithm>
+
+// Retries that refill per second whatever the traffic, and the most the budget can hold.
+// 与流量无关、每秒回填的重试次数，以及预算的上限。
+static const double BUDGET_FLOOR_PER_SECOND = 1.0;
+static const double BUDGET_MAX = 10.0;
+
+int RetryPolicy::nextDelayMs(const AttemptFailure &failure, int retryCount)
+{
+    int delay = 0;
+    switch (failure.kind)
+    {
+    case KeyOutcome::Cancelled:
+        return -1;
+    case KeyOutcome::AuthError:
+    case KeyOutcome::RateLimited:
+        // The key selector has paused this key and its Retry-After, so another key is tried at
+        // once; only when no key was available does the retry wait for one.
+        // 密钥选择器已按 Retry-After 暂停该密钥，因此立即换用其他密钥；只有在没有可用密钥时才等待。
+        if (!failure.keyUnavailable)
+            return 0;
+        // Every key is out for longer than any backoff (e.g. all revoked) ; 所有密钥停用的时间都超过退避上限（例如全部被吊销）
+        if (failure.retryAfterMs > MAX_DELAY_MS)
+            return -1;
+        break;
+    case KeyOutcome::Success:
+    case KeyOutcome::ServerError:
+    case KeyOutcome::Timeout:
+    case KeyOutcome::NetworkError:
+    {
+        // Full jitter: uniform in [0, min(cap, base * 2^n)) ; 完全抖动：在 [0, min(上限, 基数 * 2^n)) 内均匀分布
+        const int shift = std::min(std::max(retryCount - 1, 0), 16);
+        const qint64 ceiling = std::min<qint64>(qint64(BASE_DELAY_MS) << shift, MAX_DELAY_MS);
+        delay = int(QRandomGenerator::global()->bounded(ceiling));
+        break;
+    }
+    }
+    if (failure.retryAfterMs > 0)
+        delay = int(std::max<qint64>(delay, std::min<qint64>(failure.retryAfterMs, MAX_DELAY_MS)));
+    return delay;
+}
+
+void RetryPolicy::setBudgetPercent(int percent)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_percent = std::max(0, percent);
+}
+
+void RetryPolicy::refillLocked(qint64 now)
+{
+    if (m_lastRefillMs > 0)
+        m_balance = std::min(BUDGET_MAX, m_balance + (now - m_lastRefillMs) * BUDGET_FLOOR_PER_SECOND / 1000.0);
+    m_lastRefillMs = now;
+}
+
+void RetryPolicy::recordFirstAttempt()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    refillLocked(QDateTime::currentMSecsSinceEpoch());
+    m_balance = std::min(BUDGET_MAX, m_balance + m_percent / 100.0);
+}
+
+bool RetryPolicy::tryRetry()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    refillLocked(QDateTime::currentMSecsSinceEpoch());
+    if (m_balance < 1.0)
+    {
+        m_denied++;
+        return false;
+    }
+    m_balance -= 1.0;
+    m_retries++;
+    return true;
+}
+
+void RetryPolicy::resetStats()
+{
+    m_retries = 0;
+    m_denied = 0;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "KeyRateLimiter.h"
+#include <QtGlobal>
+#include <atomic>
+#include <mutex>
+
+/**
+ * Why a translation attempt failed, as far as retrying is concerned.
+ * 从重试的角度描述一次翻译尝试失败的原因。
+ */
+struct AttemptFailure
+{
+    KeyOutcome kind = KeyOutcome::Success; ///< Success = the upstream answered but the result was unusable ; Success 表示上游已应答但结果不可用
+    qint64 retryAfterMs = 0;               ///< Retry-After of the reply, or time until a key frees up ; 响应的 Retry-After，或距离有可用密钥的时间
+    bool keyUnavailable = false;           ///< No key could be acquired; nothing was sent ; 未能取得密钥，未发送请求
+};
+
+/**
+ * Retry policy per failure class, plus a global retry budget.
+ * 按失败类型区分的重试策略，以及全局重试预算。
+ *
+ * - 401/403/429: retry at once; the key selector has already moved off the failing key and
+ *   keeps it paused for its Retry-After.
+ * - 5xx, timeouts, network errors, unusable replies: exponential backoff with full jitter, so
+ *   retries after a brownout spread out instead of arriving in lockstep. A Retry-After
+ *   (e.g. on 503) is the minimum delay.
+ * - No key available: wait until the key selector expects one.
+ * - 401/403/429：立即重试；密钥选择器已避开出错的密钥，并按 Retry-After 暂停该密钥。
+ * - 5xx、超时、网络错误、不可用的回复：带完全抖动的指数退避，使服务商抖动之后的重试分散开来，
+ *   而不是同步到达。Retry-After（如 503 时）作为最小延迟。
+ * - 无可用密钥：等待到密钥选择器预计有密钥可用时。
+ *
+ * The budget is a token bucket: each new translation deposits budget_percent/100 of a retry and
+ * a small floor refills over time; each retry withdraws one. Retries therefore add at most about
+ * budget_percent to upstream load, however many attempts a single text is allowed.
+ * 预算是一个令牌桶：每个新的翻译存入 budget_percent/100 次重试，另有少量随时间回填的保底额度；
+ * 每次重试取出一次。因此无论单条文本允许尝试多少次，重试最多只会给上游增加约 budget_percent 的负载。
+ *
+ * Thread‑safe.
+ * 线程安全。
+ */
+class RetryPolicy
+{
+public:
+    static constexpr int BASE_DELAY_MS = 500;
+    static constexpr int MAX_DELAY_MS = 20000;
+
+    /**
+     * Delay before the next attempt.
+     * 下一次尝试前的延迟。
+     *
+     * @param failure    Why the last attempt failed ; 上一次尝试失败的原因
+     * @param retryCount Attempts failed so far (1 for the first retry) ; 已失败的尝试次数（首次重试为 1）
+     * @return Delay in ms, or -1 if retrying cannot help ; 延迟毫秒数；重试无意义时返回 -1
+     */
+    static int nextDelayMs(const AttemptFailure &failure, int retryCount);
+
+    /**
+     * Set the share of first attempts that may be retried.
+     * 设置可以被重试的首次尝试比例。
+     */
+    void setBudgetPercent(int percent);
+
+    /**
+     * A new translation starts (its first attempt is not a retry).
+     * 一个新的翻译开始（其首次尝试不算重试）。
+     */
+    void recordFirstAttempt();
+
+    /**
+     * Take one retry from the budget.
+     * 从预算中取出一次重试。
+     *
+     * @return false if the budget is spent ; 预算耗尽时返回 false
+     */
+    bool tryRetry();
+
+    quint64 retries() const { return m_retries; }
+    quint64 denied() const { return m_denied; }
+    void resetStats();
+
+private:
+    void refillLocked(qint64 now);
+
+    std::mutex m_mutex;
+    double m_percent = 20;
+    double m_balance = 10; ///< Retries available ; 可用的重试次数
+    qint64 m_lastRefillMs = 0;
+
+    std::atomic<quint64> m_retries{0};
+    std::atomic<quint64> m_denied{0};
+};
@@ -0,0 +1,275 @@
+#include "TinyLfuCache.h"
+#include <algorithm>
+
+// ==========================================
+// FrequencySketch
+// 频率草图
+// ==========================================
+
+void FrequencySketch::resize(int expectedEntries)
+{
+    quint32 width = 1024;
+    while (width < quint32(std::max(expectedEntries, 1)) && width < (1u << 24))
+        width <<= 1;
+    m_width = width;
+    m_table.assign(size_t(DEPTH) * m_width, 0);
+    m_sampleSize = qint64(m_width) * 10;
+    m_additions = 0;
+}
+
+void FrequencySketch::clear()
+{
+    std::fill(m_table.begin(), m_table.end(), quint8(0));
+    m_additions = 0;
+}
+
+quint32 FrequencySketch::indexOf(size_t hash, int row) const
+{
+    // Double hashing: row i probes h1 + i * h2.
+    // 双重哈希：第 i 行探测 h1 + i * h2。
+    quint64 h = quint64(hash);
+    quint32 h1 = quint32(h);
+    quint32 h2 = quint32((h * 0x9E3779B97F4A7C15ULL) >> 32) | 1u;
+    return row * m_width + ((h1 + quint32(row) * h2) & (m_width - 1));
+}
+
+void FrequencySketch::increment(const QString &key)
+{
+    if (m_table.empty())
+        resize(0);
+    size_t hash = qHash(key, 0x5bd1e995);
+    bool added = false;
+    for (int row = 0; row < DEPTH; ++row)
+    {
+        quint8 &counter = m_table[indexOf(hash, row)];
+        if (counter < 15)
+        {
+            counter++;
+            added = true;
+        }
+    }
+    if (added && ++m_additions >= m_sampleSize)
+        halve();
+}
+
+int FrequencySketch::frequency(const QString &key) const
+{
+    if (m_table.empty())
+        return 0;
+    size_t hash = qHash(key, 0x5bd1e995);
+    int freq = 15;
+    for (int row = 0; row < DEPTH; ++row)
+        freq = std::min(freq, int(m_table[indexOf(hash, row)]));
+    return freq;
+}
+
+void FrequencySketch::halve()
+{
+    for (quint8 &counter : m_table)
+        counter >>= 1;
+    m_additions /= 2;
+}
+
+// ==========================================
+// TinyLfuCache
+// W-TinyLFU 缓存
+// ==========================================
+
+TinyLfuCache::TinyLfuCache(qint64 budgetBytes) : m_budget(std::max<qint64>(budgetBytes, 1))
+{
+    m_sketch.resize(int(std::min<qint64>(m_budget / 256, 1 << 24)));
+}
+
+/**
+ * Approximate heap cost of an entry: UTF‑16 payload plus node, list and hash overhead.
+ * 条目的近似堆开销：UTF‑16 内容加上节点、链表和哈希表的开销。
+ */
+qint64 TinyLfuCache::entryBytes(const QString &key, const QString &value)
+{
+    return qint64(key.size() + value.size()) * 2 + 128;
+}
+
+void TinyLfuCache::setBudget(qint64 budgetBytes)
+{
+    budgetBytes = std::max<qint64>(budgetBytes, 1);
+    if (budgetBytes == m_budget)
+        return;
+    m_budget = budgetBytes;
+    // Roughly one sketch counter per expected entry (~256 bytes each).
+    // 大约每个预期条目（约 256 字节）一个草图计数器。
+    m_sketch.resize(int(std::min<qint64>(m_budget / 256, 1 << 24)));
+    drainWindow();
+    evictToBudget();
+}
+
+TinyLfuCache::List &TinyLfuCache::listOf(Segment segment)
+{
+    return segment == Window ? m_window : (segment == Probation ? m_probation : m_protected);
+}
+
+qint64 &TinyLfuCache::bytesOf(Segment segment)
+{
+    return segment == Window ? m_windowBytes : (segment == Probation ? m_probationBytes : m_protectedBytes);
+}
+
+/**
+ * Move a node to the MRU end of another segment; iterators stay valid (splice).
+ * 将节点移动到另一段的最近使用端；迭代器保持有效（splice）。
+ */
+void TinyLfuCache::moveTo(List::iterator it, Segment segment)
+{
+    bytesOf(it->segment) -= it->bytes;
+    bytesOf(segment) += it->bytes;
+    List &from = listOf(it->segment);
+    it->segment = segment;
+    List &to = listOf(segment);
+    to.splice(to.begin(), from, it);
+}
+
+void TinyLfuCache::touch(List::iterator it)
+{
+    if (it->segment == Probation)
+    {
+        // Second hit in the main area: protect it, demote the oldest protected entries.
+        // 在主区域再次命中：转入保护段，并降级最旧的保护条目。
+        moveTo(it, Protected);
+        while (m_protectedBytes > protectedBudget() && m_protected.size() > 1)
+            moveTo(std::prev(m_protected.end()), Probation);
+    }
+    else
+    {
+        moveTo(it, it->segment);
+    }
+}
+
+void TinyLfuCache::evict(List::iterator it)
+{
+    bytesOf(it->segment) -= it->bytes;
+    m_index.remove(it->key);
+    listOf(it->segment).erase(it);
+    m_evictions++;
+}
+
+bool TinyLfuCache::get(const QString &key, QString &value)
+{
+    m_sketch.increment(key);
+    auto found = m_index.constFind(key);
+    if (found == m_index.constEnd())
+        return false;
+    List::iterator it = found.value();
+    value = it->value;
+    touch(it);
+    return true;
+}
+
+const QString *TinyLfuCache::peek(const QString &key) const
+{
+    auto found = m_index.constFind(key);
+    return found == m_index.constEnd() ? nullptr : &found.value()->value;
+}
+
+void TinyLfuCache::put(const QString &key, const QString &value)
+{
+    const qint64 bytes = entryBytes(key, value);
+    auto found = m_index.find(key);
+    if (found != m_index.end())
+    {
+        List::iterator it = found.value();
+        bytesOf(it->segment) += bytes - it->bytes;
+        it->value = value;
+        it->bytes = bytes;
+        touch(it);
+        evictToBudget();
+        return;
+    }
+    if (bytes > mainBudget())
+    {
+        m_evictions++; // Larger than the cache itself ; 比缓存本身还大
+        return;
+    }
+
+    m_window.push_front(Node{key, value, bytes, Window});
+    m_windowBytes += bytes;
+    m_index.insert(key, m_window.begin());
+    drainWindow();
+}
+
+/**
+ * Move window overflow into probation, each one competing for admission.
+ * 将窗口溢出的条目移入观察段，每个条目都需竞争准入。
+ */
+void TinyLfuCache::drainWindow()
+{
+    while (m_windowBytes > windowBudget() && !m_window.empty())
+    {
+        List::iterator candidate = std::prev(m_window.end());
+        moveTo(candidate, Probation);
+        admit(candidate);
+    }
+}
+
+/**
+ * TinyLFU admission: while the main area is over budget, the candidate must be more
+ * frequent than the LRU victim, otherwise the candidate itself is dropped.
+ * TinyLFU 准入：主区域超出限额时，候选条目必须比 LRU 牺牲者更频繁，否则丢弃候选条目本身。
+ */
+void TinyLfuCache::admit(List::iterator candidate)
+{
+    while (m_probationBytes + m_protectedBytes > mainBudget())
+    {
+        List::iterator victim;
+        if (m_probation.size() > 1)
+            victim = std::prev(m_probation.end());
+        else if (!m_protected.empty())
+            victim = std::prev(m_protected.end());
+        else
+            victim = candidate;
+
+        if (victim != candidate && m_sketch.frequency(candidate->key) <= m_sketch.frequency(victim->key))
+        {
+            evict(candidate);
+            return;
+        }
+        const bool rejected = (victim == candidate);
+        evict(victim);
+        if (rejected)
+            return;
+    }
+}
+
+void TinyLfuCache::evictToBudget()
+{
+    while (m_probationBytes + m_protectedBytes > mainBudget())
+    {
+        if (!m_probation.empty())
+            evict(std::prev(m_probation.end()));
+        else if (!m_protected.empty())
+            evict(std::prev(m_protected.end()));
+        else
+            break;
+    }
+    while (m_windowBytes > windowBudget() && !m_window.empty())
+        evict(std::prev(m_window.end()));
+}
+
+bool TinyLfuCache::remove(const QString &key)
+{
+    auto found = m_index.find(key);
+    if (found == m_index.end())
+        return false;
+    List::iterator it = found.value();
+    bytesOf(it->segment) -= it->bytes;
+    listOf(it->segment).erase(it);
+    m_index.erase(found);
+    return true;
+}
+
+void TinyLfuCache::clear()
+{
+    m_window.clear();
+    m_probation.clear();
+    m_protected.clear();
+    m_index.clear();
+    m_sketch.clear();
+    m_windowBytes = m_probationBytes = m_protectedBytes = 0;
+}
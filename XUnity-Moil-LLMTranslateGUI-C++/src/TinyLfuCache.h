@@ -0,0 +1,138 @@
+#pragma once
+#include <QString>
+#include <QHash>
+#include <list>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+/**
+ * Count‑min sketch with 4‑bit saturating counters that are halved periodically.
+ * 带周期性减半的 4 位饱和计数 Count‑Min 草图。
+ *
+ * Estimates how often a key was requested recently, using a few bytes per cached entry.
+ * Halving keeps the estimate "recent": strings that were popular an hour ago fade out.
+ * 以每个缓存条目几个字节的代价估计键最近被请求的次数。
+ * 周期性减半使估计值保持"近期"：一小时前流行的字符串会逐渐淡出。
+ */
+class FrequencySketch
+{
+public:
+    /**
+     * Size the sketch for the expected number of entries (clears it).
+     * 按预期条目数设置草图大小（会清空草图）。
+     */
+    void resize(int expectedEntries);
+
+    void increment(const QString &key); ///< Record one access ; 记录一次访问
+    int frequency(const QString &key) const; ///< Estimated recent accesses (0–15) ; 估计的近期访问次数（0–15）
+    void clear();
+
+private:
+    static constexpr int DEPTH = 4; ///< Rows (independent hash functions) ; 行数（独立哈希函数）
+
+    quint32 indexOf(size_t hash, int row) const;
+    void halve();
+
+    std::vector<quint8> m_table; ///< DEPTH rows of m_width counters ; DEPTH 行，每行 m_width 个计数器
+    quint32 m_width = 0;
+    qint64 m_additions = 0;  ///< Increments since the last halving ; 自上次减半以来的递增次数
+    qint64 m_sampleSize = 0; ///< Halve after this many increments ; 递增到该次数后减半
+};
+
+/**
+ * Byte‑bounded in‑memory cache with W‑TinyLFU admission and eviction.
+ * 按字节限额、采用 W‑TinyLFU 准入与淘汰策略的内存缓存。
+ *
+ * New entries land in a small LRU window (1% of the budget). When the window overflows, its
+ * oldest entry only enters the main segmented LRU if the sketch says it is requested more
+ * often than the entry it would push out. A burst of one‑off cutscene lines therefore passes
+ * through the window without evicting UI strings that are shown again and again.
+ * 新条目先进入一个小型 LRU 窗口（占限额的 1%）。窗口溢出时，只有当草图显示其最旧条目比将被
+ * 挤出的条目请求更频繁时，它才能进入主分段 LRU。因此过场动画中大量一次性台词只会经过窗口，
+ * 而不会淘汰反复显示的 UI 字符串。
+ *
+ * Not thread‑safe; the owner serializes access.
+ * 非线程安全，由持有者负责串行化访问。
+ */
+class TinyLfuCache
+{
+public:
+    explicit TinyLfuCache(qint64 budgetBytes = 64LL * 1024 * 1024);
+
+    /**
+     * Change the byte budget, evicting entries if the cache is now over it.
+     * 修改字节限额；若当前超出则淘汰条目。
+     */
+    void setBudget(qint64 budgetBytes);
+
+    /**
+     * Look up a key, recording the access for admission decisions.
+     * 查询键，并记录本次访问用于准入判断。
+     */
+    bool get(const QString &key, QString &value);
+
+    /**
+     * Value of a key without recording an access or changing recency, nullptr if absent.
+     * 获取键的值，不记录访问也不改变新近度；不存在时返回 nullptr。
+     */
+    const QString *peek(const QString &key) const;
+
+    /**
+     * Insert or update an entry. Entries larger than the whole budget are rejected.
+     * 插入或更新条目。大于整个限额的条目会被拒绝。
+     */
+    void put(const QString &key, const QString &value);
+
+    bool remove(const QString &key);
+    void clear();
+
+    int size() const { return m_index.size(); }
+    qint64 budgetBytes() const { return m_budget; }
+    qint64 residentBytes() const { return m_windowBytes + m_probationBytes + m_protectedBytes; }
+    quint64 evictionCount() const { return m_evictions; } ///< Entries evicted or refused admission ; 被淘汰或拒绝准入的条目数
+
+private:
+    enum Segment
+    {
+        Window,    ///< Recently added, not yet admitted ; 新加入，尚未准入
+        Probation, ///< Admitted, accessed once in the main area ; 已准入，在主区域只访问过一次
+        Protected  ///< Accessed again while on probation ; 在观察区再次被访问
+    };
+
+    struct Node
+    {
+        QString key;
+        QString value;
+        qint64 bytes;
+        Segment segment;
+    };
+    using List = std::list<Node>;
+
+    static qint64 entryBytes(const QString &key, const QString &value);
+
+    qint64 windowBudget() const { return std::max<qint64>(m_budget / 100, 1); }
+    qint64 mainBudget() const { return m_budget - windowBudget(); }
+    qint64 protectedBudget() const { return mainBudget() * 8 / 10; }
+
+    List &listOf(Segment segment);
+    qint64 &bytesOf(Segment segment);
+    void moveTo(List::iterator it, Segment segment);
+    void touch(List::iterator it);
+    void evict(List::iterator it);
+    void drainWindow();
+    void admit(List::iterator candidate);
+    void evictToBudget();
+
+    List m_window;    ///< MRU at front ; 最近使用的在前
+    List m_probation; ///< MRU at front ; 最近使用的在前
+    List m_protected; ///< MRU at front ; 最近使用的在前
+    QHash<QString, List::iterator> m_index;
+    FrequencySketch m_sketch;
+
+    qint64 m_budget;
+    qint64 m_windowBytes = 0;
+    qint64 m_probationBytes = 0;
+    qint64 m_protectedBytes = 0;
+    quint64 m_evictions = 0;
+};
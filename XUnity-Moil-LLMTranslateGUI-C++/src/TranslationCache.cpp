@@ -0,0 +1,309 @@
+#include "TranslationCache.h"
+
+/**
+ * Get the singleton instance.
+ * 获取单例实例。
+ */
+TranslationCache &TranslationCache::instance()
+{
+    static TranslationCache _instance;
+    return _instance;
+}
+
+TranslationCache::~TranslationCache()
+{
+    close();
+}
+
+/**
+ * Open the on‑disk store, compacting it when needed.
+ * 打开磁盘存储，必要时进行压缩。
+ */
+int TranslationCache::open(const QString &basePath, QString *report)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_basePath == basePath && m_store.isOpen())
+        return int(m_store.count());
+
+    m_hot.clear();
+    m_basePath = basePath;
+    QString notes;
+    if (!m_store.open(basePath, &notes))
+    {
+        if (report)
+            *report = "failed to open " + basePath + ".tmlog";
+        return 0;
+    }
+
+    // Compact when dead records dominate the log (overwrites, invalidations).
+    // 无效记录（覆盖、失效）占主导时压缩日志。
+    const quint64 dead = m_store.deadBytes();
+    if (dead > 1024 * 1024 && dead * 2 > m_store.logBytes() && m_store.compact())
+        notes += QString(notes.isEmpty() ? "" : "; ") + QString("compacted, %1 KB reclaimed").arg(dead / 1024);
+
+    if (report)
+        *report = notes;
+    return int(m_store.count());
+}
+
+/**
+ * Close the on‑disk store.
+ * 关闭磁盘存储。
+ */
+void TranslationCache::close()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_store.close();
+    m_basePath.clear();
+}
+
+bool TranslationCache::compact()
+{
+    return m_store.compact();
+}
+
+/**
+ * Key of an entry in a scope; the separator never appears in game text.
+ * 条目在作用域中的键；分隔符不会出现在游戏文本中。
+ */
+QString TranslationCache::scopedKey(const QString &scope, const QString &source)
+{
+    return scope.isEmpty() ? source : scope + QChar(0x1F) + source;
+}
+
+/**
+ * Look up a cached translation: hot layer first, then the mapped store.
+ * 查询缓存译文：先查热点层，再查映射存储。
+ */
+bool TranslationCache::lookup(const QString &scope, const QString &source, QString &translation)
+{
+    const QString key = scopedKey(scope, source);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_hot.get(key, translation))
+        {
+            m_hits++;
+            return true;
+        }
+    }
+
+    const QByteArray storeKey = key.toUtf8();
+    QByteArray value;
+    if (!m_store.get(storeKey, value))
+    {
+        m_misses++;
+        return false;
+    }
+
+    translation = QString::fromUtf8(value);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_hot.put(key, translation); // Promote to the hot layer ; 提升到热点层
+    }
+    m_hits++;
+    return true;
+}
+
+/**
+ * Insert a translation into the hot layer and append it to the store.
+ * 将译文写入热点层并追加到存储。
+ */
+void TranslationCache::insert(const QString &scope, const QString &source, const QString &translation)
+{
+    if (source.isEmpty() || translation.isEmpty())
+        return;
+
+    const QString key = scopedKey(scope, source);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const QString *current = m_hot.peek(key);
+        if (current && *current == translation)
+            return; // Unchanged, avoid growing the log ; 未变化，避免日志膨胀
+        m_hot.put(key, translation);
+    }
+    m_store.put(key.toUtf8(), translation.toUtf8());
+}
+
+/**
+ * Add an entry from an external source (XUnity translation files) if it is not cached yet.
+ * 若尚未缓存，则添加来自外部来源（XUnity 译文文件）的条目。
+ */
+bool TranslationCache::importEntry(const QString &scope, const QString &source, const QString &translation)
+{
+    if (source.isEmpty() || translation.isEmpty())
+        return false;
+    const QString scoped = scopedKey(scope, source);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_hot.peek(scoped))
+            return false;
+    }
+    QByteArray key = scoped.toUtf8();
+    QByteArray existing;
+    if (m_store.get(key, existing))
+        return false;
+    return m_store.put(key, translation.toUtf8());
+}
+
+bool TranslationCache::peek(const QString &scope, const QString &source, QString &translation)
+{
+    const QString key = scopedKey(scope, source);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (const QString *hot = m_hot.peek(key))
+        {
+            translation = *hot;
+            return true;
+        }
+    }
+    QByteArray value;
+    if (!m_store.get(key.toUtf8(), value))
+        return false;
+    translation = QString::fromUtf8(value);
+    return true;
+}
+
+void TranslationCache::remove(const QString &scope, const QString &source)
+{
+    const QString key = scopedKey(scope, source);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_hot.remove(key);
+    }
+    m_store.remove(key.toUtf8());
+}
+
+void TranslationCache::forEachEntry(const std::function<bool(const QString &scope, const QString &source, const QString &translation)> &visit)
+{
+    m_store.forEach([&visit](const QByteArray &key, const QByteArray &value)
+                    {
+        if (key.startsWith('\x01'))
+            return true; // Marker ; 标记
+        QString full = QString::fromUtf8(key);
+        int sep = full.indexOf(QChar(0x1F));
+        QString scope = sep < 0 ? QString() : full.left(sep);
+        QString source = sep < 0 ? full : full.mid(sep + 1);
+        return visit(scope, source, QString::fromUtf8(value)); });
+}
+
+// Marker keys start with a control character that never appears in game text.
+// 标记键以游戏文本中不会出现的控制字符开头。
+bool TranslationCache::lookupMarker(const QString &name, QString &value)
+{
+    QByteArray raw;
+    if (!m_store.get("\x01" + name.toUtf8(), raw))
+        return false;
+    value = QString::fromUtf8(raw);
+    return true;
+}
+
+void TranslationCache::storeMarker(const QString &name, const QString &value)
+{
+    m_store.put("\x01" + name.toUtf8(), value.toUtf8(), true);
+}
+
+/**
+ * Remove all entries from memory and from the store.
+ * 清空内存与存储中的所有条目。
+ */
+void TranslationCache::clear()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_hot.clear();
+    }
+    m_store.clear();
+    resetStats();
+}
+
+int TranslationCache::size()
+{
+    return int(m_store.count());
+}
+
+int TranslationCache::hotSize()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hot.size();
+}
+
+void TranslationCache::setBudget(qint64 bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hot.setBudget(bytes);
+}
+
+qint64 TranslationCache::residentBytes()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hot.residentBytes();
+}
+
+qint64 TranslationCache::budgetBytes()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hot.budgetBytes();
+}
+
+quint64 TranslationCache::evictionCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hot.evictionCount();
+}
+
+double TranslationCache::hitRatio() const
+{
+    quint64 total = m_hits + m_misses;
+    return total == 0 ? 0.0 : (100.0 * m_hits) / total;
+}
+
+// ==========================================
+// XUnity text format helpers
+// XUnity 文本格式辅助函数
+// ==========================================
+
+QString TranslationCache::unescapeField(const QString &s)
+{
+    QString out;
+    out.reserve(s.size());
+    for (int i = 0; i < s.size(); ++i)
+    {
+        QChar c = s[i];
+        if (c == '\\' && i + 1 < s.size())
+        {
+            QChar n = s[++i];
+            if (n == 'n')
+                out += '\n';
+            else if (n == 'r')
+                out += '\r';
+            else if (n == 't')
+                out += '\t';
+            else
+                out += n; // "\\" and "\=" ; 反斜杠与等号
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    return out;
+}
+
+/**
+ * Find the first '=' that is not escaped by a backslash.
+ * 查找第一个未被反斜杠转义的 '='。
+ */
+int TranslationCache::findSeparator(const QString &line)
+{
+    for (int i = 0; i < line.size(); ++i)
+    {
+        if (line[i] == '\\')
+        {
+            ++i;
+            continue;
+        }
+        if (line[i] == '=')
+            return i;
+    }
+    return -1;
+}
@@ -0,0 +1,170 @@
+#pragma once
+#include <QString>
+#include <QHash>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include "TranslationStore.h"
+#include "TinyLfuCache.h"
+
+/**
+ * Translation memory cache (singleton).
+ * 翻译记忆缓存（单例）。
+ *
+ * Two layers: a byte‑bounded hot layer (W‑TinyLFU) with the entries used in this session, in
+ * front of a memory‑mapped TranslationStore that holds the full memory on disk. Startup only opens
+ * the store, so hits are served immediately without loading every entry into QStrings,
+ * and the memory survives stopServer/startServer and process restarts.
+ * 两层结构：按字节限额的热点层（W‑TinyLFU）保存本次会话用到的条目，其后是保存完整记忆的内存映射
+ * TranslationStore。启动时只需打开存储，无需把所有条目载入为 QString 即可立即命中，
+ * 记忆在停止/启动服务及进程重启后依然有效。
+ *
+ * Every entry is stored under a scope, the fingerprint of the config that produced it
+ * (model, prompts, temperature, glossary switch). Switching config only changes which
+ * scope is read, so switching back finds the old translations still warm. Entries from
+ * other fingerprints are never returned.
+ * 每个条目都保存在一个作用域下，即生成它的配置指纹（模型、提示词、温度、术语表开关）。
+ * 切换配置只会改变读取的作用域，切换回来时旧译文仍然有效。其他指纹的条目不会被返回。
+ */
+class TranslationCache
+{
+public:
+    /**
+     * Get the singleton instance.
+     * 获取单例实例。
+     */
+    static TranslationCache &instance();
+
+    /**
+     * Open the on‑disk store (no‑op if it is already open with the same path).
+     * 打开磁盘存储（以相同路径重复调用不会有任何操作）。
+     *
+     * Compacts the store when more than half of the log is dead records.
+     * 当日志中超过一半是无效记录时自动压缩。
+     *
+     * @param basePath Store path without extension ; 不含扩展名的存储路径
+     * @param report   Optional note about rebuild/compaction ; 可选：重建/压缩说明
+     * @return Number of entries in the store ; 存储中的条目数
+     */
+    int open(const QString &basePath = "translation_memory", QString *report = nullptr);
+
+    /**
+     * Close the on‑disk store. Hot entries are kept.
+     * 关闭磁盘存储，热点条目保留。
+     */
+    void close();
+
+    /**
+     * Rewrite the store without dead records.
+     * 重写存储，去除无效记录。
+     */
+    bool compact();
+
+    /**
+     * Look up a cached translation (thread‑safe).
+     * 查询缓存译文（线程安全）。
+     *
+     * @param scope       Config fingerprint ; 配置指纹
+     * @param source      Source text exactly as passed to performTranslation ; 传给 performTranslation 的原文
+     * @param translation Receives the cached translation on hit ; 命中时写入缓存译文
+     * @return True on hit ; 命中返回 true
+     */
+    bool lookup(const QString &scope, const QString &source, QString &translation);
+
+    /**
+     * Insert a translation into the hot layer and append it to the store (thread‑safe).
+     * 将译文写入热点层并追加到存储（线程安全）。
+     */
+    void insert(const QString &scope, const QString &source, const QString &translation);
+
+    /**
+     * Add an entry from an external source without overwriting and without touching the hot layer.
+     * 从外部来源添加条目：不覆盖已有条目，也不进入热点层。
+     *
+     * @return True if the entry was new ; 条目为新增时返回 true
+     */
+    bool importEntry(const QString &scope, const QString &source, const QString &translation);
+
+    /**
+     * Read an entry without touching statistics or recency.
+     * 读取条目，不影响统计与新近度。
+     */
+    bool peek(const QString &scope, const QString &source, QString &translation);
+
+    /**
+     * Remove one entry from memory and from the store (e.g. stale after a glossary change).
+     * 从内存和存储中删除一个条目（例如术语表变更后已过时）。
+     */
+    void remove(const QString &scope, const QString &source);
+
+    /**
+     * Visit every translation in every scope until the visitor returns false.
+     * 遍历所有作用域中的全部译文，直到访问函数返回 false。
+     *
+     * Runs without holding the cache lock; meant for background maintenance.
+     * 不持有缓存锁运行，用于后台维护。
+     */
+    void forEachEntry(const std::function<bool(const QString &scope, const QString &source, const QString &translation)> &visit);
+
+    /**
+     * Bookkeeping values kept in the store under a reserved key space (e.g. import offsets).
+     * 以保留键空间保存在存储中的簿记值（例如导入偏移）。
+     */
+    bool lookupMarker(const QString &name, QString &value);
+    void storeMarker(const QString &name, const QString &value);
+
+    /**
+     * Remove all entries from memory and from the store.
+     * 清空内存与存储中的所有条目。
+     */
+    void clear();
+
+    /**
+     * Set the memory budget of the hot layer; entries are evicted if it is exceeded.
+     * 设置热点层的内存限额；超出时淘汰条目。
+     */
+    void setBudget(qint64 bytes);
+
+    int size();    ///< Translations in the store (markers not included) ; 存储中的译文数（不含标记）
+    int hotSize(); ///< Entries in the hot layer ; 热点层条目数
+    qint64 residentBytes(); ///< Approximate memory used by the hot layer ; 热点层近似内存占用
+    qint64 budgetBytes();   ///< Memory budget of the hot layer ; 热点层内存限额
+    quint64 evictionCount(); ///< Hot entries evicted or refused admission ; 热点层淘汰或拒绝准入的条目数
+    quint64 hitCount() const { return m_hits; }
+    quint64 missCount() const { return m_misses; }
+
+    /**
+     * Hit ratio in percent since the last resetStats(), 0 when nothing was looked up.
+     * 自上次 resetStats() 以来的命中率（百分比），无查询时为 0。
+     */
+    double hitRatio() const;
+
+    void resetStats()
+    {
+        m_hits = 0;
+        m_misses = 0;
+    }
+
+    /**
+     * XUnity line format helpers: unescape a field / find the first unescaped '='.
+     * XUnity 行格式辅助函数：字段反转义 / 查找第一个未转义的 '='。
+     */
+    static QString unescapeField(const QString &s);
+    static int findSeparator(const QString &line);
+
+private:
+    TranslationCache() {}
+    ~TranslationCache();
+    TranslationCache(const TranslationCache &) = delete;
+    TranslationCache &operator=(const TranslationCache &) = delete;
+
+    static QString scopedKey(const QString &scope, const QString &source);
+
+    TinyLfuCache m_hot;            ///< Hot layer: source → translation ; 热点层：原文 → 译文
+    QString m_basePath;            ///< Path of the store ; 存储路径
+    TranslationStore m_store;      ///< Memory‑mapped on‑disk store ; 内存映射磁盘存储
+    std::mutex m_mutex;            ///< Protects m_hot and m_basePath ; 保护 m_hot 与 m_basePath
+
+    std::atomic<quint64> m_hits{0};
+    std::atomic<quint64> m_misses{0};
+};
@@ -0,0 +1,349 @@
+#include "TranslationScheduler.h"
+#include <QDateTime>
+#include <algorithm>
+
+// Longest text still treated as UI text ; 仍视为界面文本的最大长度
+static const int INTERACTIVE_MAX_CHARS = 24;
+// Deadline slack per class ; 各等级的截止时间宽限
+static const qint64 CLASS_SLACK_MS[] = {0, 1500, 5000, 15000};
+static const size_t LATENCY_WINDOW = 256;
+
+PriorityClass TranslationScheduler::classify(RequestOrigin origin, const QString &text)
+{
+    const bool shortLine = text.size() <= INTERACTIVE_MAX_CHARS && !text.contains('\n') && !text.contains("[LF]");
+    switch (origin)
+    {
+    case RequestOrigin::Custom:
+        return shortLine ? PriorityClass::Interactive : PriorityClass::Dialogue;
+    case RequestOrigin::Batch:
+        return shortLine ? PriorityClass::Dialogue : PriorityClass::Bulk;
+    case RequestOrigin::Background:
+        break;
+    }
+    return PriorityClass::Background;
+}
+
+void TranslationScheduler::configure(int concurrency, bool lifo, const QHash<QString, int> &weights)
+{
+    std::vector<std::pair<Job, Ticket>> ready;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_concurrency = std::max(0, concurrency);
+        m_lifo = lifo;
+        m_weights = weights;
+        for (auto &entry : m_clients)
+            entry.second.weight = std::max(1, m_weights.value(entry.first, 1));
+        // A raised limit takes effect at once ; 提高的名额立即生效
+        fillSlotsLocked(QDateTime::currentMSecsSinceEpoch(), ready);
+    }
+    for (auto &entry : ready)
+        entry.first.start(entry.second);
+}
+
+void TranslationScheduler::submit(PriorityClass priority, const QString &client, int cost, std::function<void(const Ticket &)> start,
+                                  std::function<bool()> abandoned)
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    Job job{priority, client, std::max(1, cost), now, now + CLASS_SLACK_MS[int(priority)], std::move(start), std::move(abandoned)};
+    Ticket ticket;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Client &owner = clientLocked(client);
+        if (m_concurrency > 0 && m_running >= m_concurrency)
+        {
+            if (owner.jobs.empty())
+                m_backlogged.push_back(client);
+            if (priority != PriorityClass::Background)
+                owner.queuedForeground++;
+            owner.jobs.push_back(std::move(job));
+            m_queued++;
+            return;
+        }
+        ticket = startLocked(job, now);
+    }
+    job.start(ticket);
+}
+
+void TranslationScheduler::finish(const Ticket &ticket)
+{
+    if (ticket.abandoned)
+        return;
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    std::vector<std::pair<Job, Ticket>> ready;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Latencies &latencies = m_latencies[int(ticket.priority)];
+        const qint64 total = now - ticket.submittedMs;
+        latencies.requests++;
+        latencies.waitTotalMs += ticket.startedMs - ticket.submittedMs;
+        latencies.totalMs += total;
+        if (latencies.window.size() < LATENCY_WINDOW)
+        {
+            latencies.window.push_back(total);
+        }
+        else
+        {
+            latencies.window[latencies.next] = total;
+            latencies.next = (latencies.next + 1) % LATENCY_WINDOW;
+        }
+
+        Client &owner = clientLocked(ticket.client);
+        owner.running--;
+        if (ticket.priority == PriorityClass::Background)
+            owner.runningBackground--;
+        m_running--;
+        // The slot passes straight to the next job ; 名额直接交给下一个任务
+        fillSlotsLocked(now, ready);
+    }
+    for (auto &entry : ready)
+        entry.first.start(entry.second);
+}
+
+void TranslationScheduler::flush()
+{
+    std::vector<std::pair<Job, Ticket>> ready;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        for (const QString &client : m_backlogged)
+        {
+            Client &owner = m_clients[client];
+            for (Job &job : owner.jobs)
+            {
+                const Ticket ticket = startLocked(job, now);
+                ready.emplace_back(std::move(job), ticket);
+            }
+            owner.jobs.clear();
+            owner.queuedForeground = 0;
+            owner.deficit = 0;
+        }
+        m_backlogged.clear();
+        m_cursor = 0;
+        m_granted = false;
+        m_queued = 0;
+    }
+    for (auto &entry : ready)
+        entry.first.start(entry.second);
+}
+
+TranslationScheduler::Client &TranslationScheduler::clientLocked(const QString &client)
+{
+    auto it = m_clients.find(client);
+    if (it == m_clients.end())
+    {
+        it = m_clients.emplace(client, Client()).first;
+        it->second.weight = std::max(1, m_weights.value(client, 1));
+    }
+    return it->second;
+}
+
+bool TranslationScheduler::underShareLocked(const Client &client) const
+{
+    if (m_concurrency == 0)
+        return true;
+    // Share of the limit among the clients that currently want slots for foreground work.
+    // 在当前需要名额处理前台任务的客户端之间分配名额。
+    qint64 activeWeight = 0;
+    for (const auto &entry : m_clients)
+    {
+        if (entry.second.running > entry.second.runningBackground || entry.second.queuedForeground > 0)
+            activeWeight += entry.second.weight;
+    }
+    const qint64 share = std::max<qint64>(1, qint64(m_concurrency) * client.weight / std::max<qint64>(1, activeWeight));
+    return client.running < share;
+}
+
+TranslationScheduler::Job TranslationScheduler::takeNextLocked(qint64 now)
+{
+    // Background jobs wait while any foreground job does ; 有前台任务等待时，后台任务继续等待
+    bool foregroundOnly = false;
+    for (const QString &client : m_backlogged)
+    {
+        if (m_clients[client].queuedForeground > 0)
+        {
+            foregroundOnly = true;
+            break;
+        }
+    }
+    auto eligible = [foregroundOnly](const Client &client)
+    { return !foregroundOnly || client.queuedForeground > 0; };
+
+    bool preferUnderShare = false;
+    for (const QString &client : m_backlogged)
+    {
+        const Client &candidate = m_clients[client];
+        if (eligible(candidate) && underShareLocked(candidate))
+        {
+            preferUnderShare = true;
+            break;
+        }
+    }
+
+    // Deficit round robin; terminates because every eligible client earns a quantum per turn.
+    // 差额轮询；每轮每个符合条件的客户端都会获得额度，因此必然结束。
+    for (;;)
+    {
+        if (m_cursor >= m_backlogged.size())
+            m_cursor = 0;
+        Client &client = m_clients[m_backlogged[m_cursor]];
+        if (eligible(client) && (!preferUnderShare || underShareLocked(client)))
+        {
+            if (!m_granted)
+            {
+                client.deficit += qint64(QUANTUM_TOKENS) * client.weight;
+                m_granted = true;
+            }
+            const size_t index = pickJobLocked(client, now, foregroundOnly);
+            if (client.jobs[index].cost <= client.deficit)
+            {
+                Job job = std::move(client.jobs[index]);
+                client.jobs.erase(client.jobs.begin() + index);
+                client.deficit -= job.cost;
+                if (job.priority != PriorityClass::Background)
+                    client.queuedForeground--;
+                m_queued--;
+                if (client.jobs.empty())
+                {
+                    // An idle client does not bank credit ; 空闲的客户端不积攒额度
+                    client.deficit = 0;
+                    m_backlogged.erase(m_backlogged.begin() + m_cursor);
+                    m_granted = false;
+                }
+                return job;
+            }
+        }
+        m_cursor++;
+        m_granted = false;
+    }
+}
+
+TranslationScheduler::Ticket TranslationScheduler::startLocked(Job &job, qint64 now)
+{
+    Client &client = clientLocked(job.client);
+    client.running++;
+    if (job.priority == PriorityClass::Background)
+        client.runningBackground++;
+    client.requests++;
+    client.tokens += quint64(job.cost);
+    client.waitTotalMs += now - job.submittedMs;
+    m_running++;
+    return Ticket{job.priority, job.client, job.cost, job.submittedMs, now};
+}
+
+void TranslationScheduler::fillSlotsLocked(qint64 now, std::vector<std::pair<Job, Ticket>> &ready)
+{
+    while (m_queued > 0 && (m_concurrency == 0 || m_running < m_concurrency))
+    {
+        Job job = takeNextLocked(now);
+        Ticket ticket;
+        if (job.abandoned && job.abandoned())
+            ticket = Ticket{job.priority, job.client, job.cost, job.submittedMs, now, true};
+        else
+            ticket = startLocked(job, now);
+        ready.emplace_back(std::move(job), ticket);
+    }
+}
+
+size_t TranslationScheduler::pickJobLocked(const Client &client, qint64 now, bool foregroundOnly) const
+{
+    const std::vector<Job> &jobs = client.jobs;
+    size_t best = jobs.size();
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        const Job &a = jobs[i];
+        if (foregroundOnly && a.priority == PriorityClass::Background)
+            continue;
+        if (best == jobs.size())
+        {
+            best = i;
+            continue;
+        }
+        const Job &b = jobs[best];
+        bool better = false;
+        if (!m_lifo)
+        {
+            better = a.deadlineMs < b.deadlineMs;
+        }
+        else
+        {
+            const bool aStarved = now - a.submittedMs > STARVATION_MS;
+            const bool bStarved = now - b.submittedMs > STARVATION_MS;
+            if (aStarved != bStarved)
+                better = aStarved;
+            else if (aStarved)
+                better = a.submittedMs < b.submittedMs;
+            else if (a.priority != b.priority)
+                better = a.priority < b.priority;
+            else
+                better = a.submittedMs > b.submittedMs;
+        }
+        if (better)
+            best = i;
+    }
+    return best;
+}
+
+int TranslationScheduler::queued()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queued;
+}
+
+TranslationScheduler::ClassStats TranslationScheduler::stats(PriorityClass priority)
+{
+    std::vector<qint64> window;
+    ClassStats stats;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const Latencies &latencies = m_latencies[int(priority)];
+        stats.requests = latencies.requests;
+        if (latencies.requests == 0)
+            return stats;
+        stats.avgWaitMs = latencies.waitTotalMs / qint64(latencies.requests);
+        stats.avgTotalMs = latencies.totalMs / qint64(latencies.requests);
+        window = latencies.window;
+    }
+    const size_t rank = std::min(window.size() - 1, window.size() * 95 / 100);
+    std::nth_element(window.begin(), window.begin() + rank, window.end());
+    stats.p95TotalMs = window[rank];
+    return stats;
+}
+
+QList<TranslationScheduler::ClientStats> TranslationScheduler::clientStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    QList<ClientStats> list;
+    for (const auto &entry : m_clients)
+    {
+        const Client &client = entry.second;
+        if (client.requests == 0)
+            continue;
+        ClientStats stats;
+        stats.client = entry.first;
+        stats.weight = client.weight;
+        stats.requests = client.requests;
+        stats.tokens = client.tokens;
+        stats.avgWaitMs = client.waitTotalMs / qint64(client.requests);
+        list.append(stats);
+    }
+    return list;
+}
+
+void TranslationScheduler::resetStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (Latencies &latencies : m_latencies)
+        latencies = Latencies();
+    for (auto it = m_clients.begin(); it != m_clients.end();)
+    {
+        if (it->second.running == 0 && it->second.jobs.empty())
+        {
+            it = m_clients.erase(it);
+            continue;
+        }
+        it->second.requests = 0;
+        it->second.tokens = 0;
+        it->second.waitTotalMs = 0;
+        ++it;
+    }
+}
@@ -0,0 +1,202 @@
+#pragma once
+#include <QString>
+#include <QHash>
+#include <QList>
+#include <QtGlobal>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/**
+ * Where a translation request came from.
+ * 翻译请求的来源。
+ */
+enum class RequestOrigin
+{
+    Custom,    ///< "/" endpoint, one text at a time ; "/" 端点，每次一条文本
+    Batch,     ///< Google-style batch endpoint ; Google 风格的批量端点
+    Background ///< Our own work (glossary re-translation) ; 本程序自身的工作（术语重译）
+};
+
+/**
+ * Scheduling class of an upstream translation, most urgent first.
+ * 上游翻译的调度等级，越靠前越紧急。
+ */
+enum class PriorityClass
+{
+    Interactive, ///< Short single-line UI text (labels, buttons) ; 短的单行界面文本（标签、按钮）
+    Dialogue,    ///< Other Custom texts ; 其他 Custom 文本
+    Bulk,        ///< Batch blocks ; 批量文本块
+    Background,
+    Count
+};
+
+/**
+ * Priority scheduler for upstream translations, fair across clients.
+ * 上游翻译的优先级调度器，在客户端之间保持公平。
+ *
+ * At most `concurrency` retry series talk to the LLM at once; the rest wait here instead of
+ * in arrival order inside the network stack or the LLM server. Each waiting job gets a
+ * deadline of arrival + the slack of its class (0 ms for UI text, seconds for batches),
+ * and the earliest deadline runs next: a button label overtakes a backlog of dialogue, while
+ * old jobs still age into the front. In LIFO mode the most urgent class runs newest first,
+ * for backlogs where older lines have already scrolled off screen; jobs waiting longer than
+ * STARVATION_MS still go first.
+ * 最多 `concurrency` 个重试序列同时请求大模型；其余在此等待，而不是在网络栈或大模型服务器内按到达
+ * 顺序排队。每个等待的任务的截止时间为 到达时间 + 其等级的宽限（界面文本 0 ms，批量文本数秒），
+ * 截止时间最早的先执行：按钮标签会超过积压的对白，而旧任务也会随等待逐渐排到前面。LIFO 模式下，
+ * 最紧急的等级按最新优先执行，适用于旧文本已滚出屏幕的积压；等待超过 STARVATION_MS 的任务仍然优先。
+ *
+ * Those rules order the jobs of one client. Across clients (one per IP, i.e. per game or
+ * machine) slots go by deficit round robin over estimated tokens: each turn a client earns
+ * QUANTUM_TOKENS × its weight and spends the cost of the jobs it starts, so a chatty client
+ * gets its weighted share of tokens, not of requests. A client running fewer jobs than its
+ * weighted share of the concurrency limit is served before clients above their share.
+ * 以上规则决定同一客户端内任务的顺序。客户端之间（每个 IP 一个，即每个游戏或每台机器）按预估
+ * token 数进行差额轮询（DRR）：每轮客户端获得 QUANTUM_TOKENS × 权重 的额度，并用它支付所启动任务的
+ * 成本，因此频繁请求的客户端得到的是按权重的 token 份额，而不是请求数份额。正在运行的任务少于其按
+ * 权重分得的并发名额的客户端，优先于超出份额的客户端。
+ *
+ * Background jobs (our own glossary re-translations) only get slots no foreground job is
+ * waiting for, and a client running nothing but background jobs does not reduce the share of
+ * the others.
+ * 后台任务（本程序自身的术语重译）只使用没有前台任务等待的名额；只运行后台任务的客户端不会减少
+ * 其他客户端的份额。
+ *
+ * A job whose client has given up is dropped when its turn comes, without taking a slot.
+ * 客户端已放弃的任务在轮到它时被丢弃，不占用名额。
+ *
+ * Thread‑safe. Jobs are started outside the lock, on the thread that submits or finishes.
+ * 线程安全。任务在锁外启动，运行在提交或完成任务的线程上。
+ */
+class TranslationScheduler
+{
+public:
+    static constexpr qint64 STARVATION_MS = 30000;
+    static constexpr int QUANTUM_TOKENS = 1000;
+
+    /**
+     * A running job; hand it back to finish().
+     * 正在运行的任务；需交还给 finish()。
+     */
+    struct Ticket
+    {
+        PriorityClass priority = PriorityClass::Background;
+        QString client;
+        int cost = 0;
+        qint64 submittedMs = 0;
+        qint64 startedMs = 0;
+        bool abandoned = false; ///< Dropped from the queue without running ; 未运行即从队列中丢弃
+    };
+
+    struct ClassStats
+    {
+        quint64 requests = 0;
+        qint64 avgWaitMs = 0;  ///< Time spent waiting here ; 在此等待的时间
+        qint64 avgTotalMs = 0; ///< Wait + upstream ; 等待 + 上游耗时
+        qint64 p95TotalMs = 0;
+    };
+
+    struct ClientStats
+    {
+        QString client;
+        int weight = 1;
+        quint64 requests = 0;
+        quint64 tokens = 0;    ///< Estimated tokens of the jobs started ; 已启动任务的预估 token 数
+        qint64 avgWaitMs = 0;
+    };
+
+    /**
+     * Classify a request by origin and text length.
+     * 按来源与文本长度对请求分级。
+     */
+    static PriorityClass classify(RequestOrigin origin, const QString &text);
+
+    /**
+     * Set how many jobs may run at once (0 = no limit), whether urgent jobs run newest first,
+     * and the weights of clients (others weigh 1).
+     * 设置可同时运行的任务数（0 表示不限）、紧急任务是否按最新优先执行，以及客户端的权重（其他客户端权重为 1）。
+     */
+    void configure(int concurrency, bool lifo, const QHash<QString, int> &weights = QHash<QString, int>());
+
+    /**
+     * Run a job now if a slot is free, otherwise when its turn comes.
+     * 有空闲名额时立即运行任务，否则等轮到它时运行。
+     *
+     * @param client    Client the job belongs to ; 任务所属的客户端
+     * @param cost      Estimated tokens ; 预估 token 数
+     * @param start     Runs the job, or reports it dropped (Ticket::abandoned) ; 运行任务，或告知任务已被丢弃（Ticket::abandoned）
+     * @param abandoned Checked when the job's turn comes; may be empty ; 轮到该任务时检查；可以为空
+     */
+    void submit(PriorityClass priority, const QString &client, int cost, std::function<void(const Ticket &)> start,
+                std::function<bool()> abandoned = std::function<bool()>());
+
+    /**
+     * A job has finished: record its latency and start the next one. Dropped tickets are ignored.
+     * 任务已完成：记录其延迟并启动下一个任务。已丢弃的票据会被忽略。
+     */
+    void finish(const Ticket &ticket);
+
+    /**
+     * Start every waiting job regardless of the limit (server stopping).
+     * 不受名额限制地启动所有等待中的任务（服务器停止时）。
+     */
+    void flush();
+
+    int queued();
+    ClassStats stats(PriorityClass priority);
+    QList<ClientStats> clientStats();
+    void resetStats();
+
+private:
+    struct Job
+    {
+        PriorityClass priority = PriorityClass::Background;
+        QString client;
+        int cost = 0;
+        qint64 submittedMs = 0;
+        qint64 deadlineMs = 0;
+        std::function<void(const Ticket &)> start;
+        std::function<bool()> abandoned;
+    };
+    struct Client
+    {
+        std::vector<Job> jobs;
+        int weight = 1;
+        int running = 0;
+        int runningBackground = 0; ///< Running jobs of class Background ; 正在运行的 Background 等级任务
+        int queuedForeground = 0;  ///< Waiting jobs of the other classes ; 其他等级的等待任务
+        qint64 deficit = 0;
+        quint64 requests = 0;
+        quint64 tokens = 0;
+        qint64 waitTotalMs = 0;
+    };
+    struct Latencies
+    {
+        quint64 requests = 0;
+        qint64 waitTotalMs = 0;
+        qint64 totalMs = 0;
+        std::vector<qint64> window; ///< Recent totals ; 最近的总耗时
+        size_t next = 0;
+    };
+
+    Client &clientLocked(const QString &client);
+    bool underShareLocked(const Client &client) const;
+    size_t pickJobLocked(const Client &client, qint64 now, bool foregroundOnly) const;
+    Job takeNextLocked(qint64 now);
+    Ticket startLocked(Job &job, qint64 now);
+    void fillSlotsLocked(qint64 now, std::vector<std::pair<Job, Ticket>> &ready);
+
+    std::mutex m_mutex;
+    std::map<QString, Client> m_clients;
+    std::vector<QString> m_backlogged; ///< Clients with waiting jobs, in round-robin order ; 有等待任务的客户端（轮询顺序）
+    size_t m_cursor = 0;
+    bool m_granted = false;            ///< The client at the cursor has had its quantum this turn ; 游标处的客户端本轮已获得额度
+    QHash<QString, int> m_weights;
+    int m_queued = 0;
+    int m_running = 0;
+    int m_concurrency = 16;
+    bool m_lifo = false;
+    Latencies m_latencies[int(PriorityClass::Count)];
+};
@@ -4,19 +4,23 @@
 #include "RegexManager.h"
 #include "LogManager.h"
 #include "XuaConfigHijacker.h" // Ensure this header exists / 确保此头文件存在
-#include <QEventLoop>
+#include "TranslationCache.h"
+#include "XuaTranslationImporter.h"
+#include "QuarantineManager.h"
 #include <QCryptographicHash>
 #include <QRegularExpression>
 #include <QRandomGenerator>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QNetworkRequest>
-#include <QTimer>
 #include <QElapsedTimer> // Required for speed measurement / 测速需要
+#include <QDateTime>
+#include <QSet>
 #include <regex>
 #include <chrono>
 #include <thread>
 #include <algorithm>
+#include <future>
 
 using json = nlohmann::json;
 
@@ -35,7 +39,84 @@ const char *SV_NEW_TERM[] = {"✨ New Term Discovered: ", "✨ 发现新术语:
 const char *SV_RETRY_ATTEMPT[] = {"🔄 Retry translation (%1/%2): ", "🔄 重试翻译 (%1/%2): "};
 const char *SV_RETRY_SUCCESS[] = {"✅ Retry successful", "✅ 重试成功"};
 const char *SV_RETRY_FAILED[] = {"❌ Retry failed, skipping text", "❌ 重试失败，跳过文本"};
+const char *SV_RETRY_DELAY[] = {" (in %1 ms)", "（%1 ms 后）"};
+const char *SV_RETRY_BUDGET[] = {"❌ Retry budget spent, skipping text", "❌ 重试预算已用尽，跳过文本"};
+const char *SV_RETRY_SUMMARY[] = {"🔄 Retries: %1 sent, %2 refused by the retry budget", "🔄 重试：已发送 %1 次，%2 次因重试预算不足被拒绝"};
 const char *SV_ABORTED[] = {"⛔ Translation Aborted", "⛔ 翻译已终止"};
+const char *SV_IMPORT_PROGRESS[] = {"📥 Importing %1: %2 lines, %3 new", "📥 正在导入 %1：%2 行，新增 %3 条"};
+const char *SV_IMPORT_DONE[] = {"📥 XUnity translations imported: %1 files, %2 new, %3 already cached (%4 ms)",
+                                "📥 XUnity 译文导入完成：%1 个文件，新增 %2 条，已缓存 %3 条 (%4 ms)"};
+const char *SV_BATCH_SPLIT[] = {"📦 Batch: %1 lines, %2 cached, %3 repeated, %4 sent upstream",
+                                "📦 批次：%1 行，缓存 %2 行，重复 %3 行，发往上游 %4 行"};
+const char *SV_BATCH_MISMATCH[] = {"⚠️ Batch line count mismatch (%1 sent, %2 received), translating the lines one by one",
+                                   "⚠️ 批次行数不一致（发送 %1 行，收到 %2 行），改为逐行翻译"};
+const char *SV_COALESCED[] = {"🔗 Joined an identical in-flight request", "🔗 已合并到进行中的相同请求"};
+const char *SV_COALESCE_SUMMARY[] = {"🔗 Coalesced duplicate requests: %1", "🔗 已合并的重复请求：%1"};
+const char *SV_QUARANTINED[] = {"🚫 Quarantined for %1 s after %2 failed translation(s): ", "🚫 连续 %2 次翻译失败，隔离 %1 秒: "};
+const char *SV_QUARANTINE_SKIP[] = {"🚫 Skipped quarantined text (%1 s left): ", "🚫 跳过隔离中的文本（剩余 %1 秒）: "};
+const char *SV_TEMPLATE_HIT[] = {"🧩 Template hit: ", "🧩 命中模板: "};
+const char *SV_TEMPLATE_SUMMARY[] = {"🧩 Template cache hits: %1", "🧩 模板缓存命中：%1"};
+const char *SV_GLOSSARY_INDEXED[] = {"📖 Glossary index: %1 terms, %2 cached lines (%3 ms)", "📖 术语索引：%1 个术语，关联 %2 条缓存 (%3 ms)"};
+const char *SV_GLOSSARY_INVALIDATED[] = {"📖 Term \"%1\" changed: %2 cached lines invalidated, %3 already consistent",
+                                         "📖 术语 \"%1\" 已变更：%2 条缓存失效，%3 条已一致"};
+const char *SV_GLOSSARY_RETRANSLATED[] = {"📖 Background re-translation finished: %1 lines", "📖 后台重译完成：%1 行"};
+const char *SV_UPSTREAM_CONNECT[] = {"🔌 New upstream connection: handshake %1 ms (reuse rate %2%)", "🔌 新建上游连接：握手 %1 ms（复用率 %2%）"};
+const char *SV_UPSTREAM_STATS[] = {"🔌 Upstream: %1 requests, %2 new connections, reuse rate %3%, avg handshake %4 ms",
+                                   "🔌 上游：%1 次请求，新建 %2 条连接，复用率 %3%，平均握手 %4 ms"};
+const char *SV_MICROBATCH[] = {"🧺 Micro-batch: %1 requests in one call, %2 fell back", "🧺 合批：%1 个请求合并为一次调用，%2 个单独回退"};
+const char *SV_MICROBATCH_SUMMARY[] = {"🧺 Micro-batches: %1 calls for %2 requests, %3 fell back",
+                                       "🧺 合批：%1 次调用覆盖 %2 个请求，%3 个单独回退"};
+const char *SV_STREAM_STATS[] = {"🌊 Stream: first token %1 ms, %2 tokens in %3 ms (%4 tok/s)", "🌊 流式：首个 token %1 ms，%2 个 token 用时 %3 ms（%4 tok/s）"};
+const char *SV_STREAM_EARLY[] = {" | stopped early", " | 已提前结束"};
+const char *SV_STREAM_OVERFLOW[] = {"⚠️ Runaway output aborted after %1 characters: ", "⚠️ 输出失控，已在 %1 个字符后中止："};
+const char *SV_STREAM_SUMMARY[] = {"🌊 Streamed replies: %1, avg first token %2 ms, stopped early: %3",
+                                   "🌊 流式响应：%1 次，平均首个 token %2 ms，提前结束：%3 次"};
+const char *SV_KEY_QUEUED[] = {"⏳ No API key available (rate limit or circuit open), waiting %1 ms",
+                               "⏳ 暂无可用的 API 密钥（速率上限或已熔断），等待 %1 ms"};
+const char *SV_KEY_SATURATED[] = {"❌ No API key available (rate limit or circuit open), attempt skipped",
+                                  "❌ 暂无可用的 API 密钥（速率上限或已熔断），跳过本次尝试"};
+const char *SV_KEY_THROTTLED[] = {"🐢 Key %1 rate limited (429), paused for %2 ms", "🐢 密钥 %1 被限速 (429)，暂停 %2 ms"};
+const char *SV_KEY_CIRCUIT_OPEN[] = {"🔌 Key %1 disabled after failures (last status %2), probing again in %3 s",
+                                     "🔌 密钥 %1 多次失败已停用（最近状态 %2），%3 秒后再次探测"};
+const char *SV_KEY_CIRCUIT_CLOSED[] = {"🔑 Key %1 recovered and is back in rotation", "🔑 密钥 %1 已恢复，重新参与轮换"};
+const char *SV_KEY_SUMMARY[] = {"🔑 Key %1: %2 requests, %3", "🔑 密钥 %1：%2 次请求，%3"};
+const char *SV_KEY_STATE[] = {"Closed", "正常"};
+const char *SV_KEY_STATE_OPEN[] = {"Disabled, probe in %1 s", "已停用，%1 秒后探测"};
+const char *SV_KEY_STATE_HALF_OPEN[] = {"Probing", "探测中"};
+const char *SV_KEY_HEALTH[] = {"%1 | success %2% | 401/403: %3, 429: %4, 5xx: %5, timeout: %6 | avg %7 ms",
+                               "%1 | 成功率 %2% | 401/403: %3，429: %4，5xx: %5，超时: %6 | 平均 %7 ms"};
+const char *SV_BACKEND_DOWN[] = {"📡 Backend %1 degraded (%2% recent errors), failing over for %3 s",
+                                 "📡 上游 %1 已降级（近期错误率 %2%），%3 秒内切换到其他上游"};
+const char *SV_BACKEND_UP[] = {"📡 Backend %1 answered again and is back in rotation", "📡 上游 %1 已恢复应答，重新参与路由"};
+const char *SV_BACKEND_SUMMARY[] = {"📡 Backend %1 (%2): %3 requests, %4 failed, %5% recent errors, avg %6 ms, taken out %7 times",
+                                    "📡 上游 %1（%2）：%3 次请求，失败 %4 次，近期错误率 %5%，平均 %6 ms，移出轮换 %7 次"};
+const char *SV_TIMEOUT[] = {"❌ Request timed out after %1 ms (predicted %2 ms for ~%3 tokens on %4): ",
+                            "❌ 请求超时 %1 ms（预计 %2 ms，约 %3 token，上游 %4）: "};
+const char *SV_TIMEOUT_UNPREDICTED[] = {"❌ Request timed out after %1 ms (no latency estimate yet for %2): ",
+                                        "❌ 请求超时 %1 ms（上游 %2 尚无延迟估计）: "};
+const char *SV_ADMISSION_SHED[] = {"🚦 Server busy (%1 queued, %2 rejected so far), answering 503, retry after %3 s",
+                                   "🚦 服务器繁忙（排队 %1，累计拒绝 %2），返回 503，%3 秒后重试"};
+const char *SV_ADMISSION_SUMMARY[] = {"🚦 Admission: %1 requests admitted, %2 rejected (queue full), %3 rejected (waited too long)",
+                                      "🚦 准入：接纳 %1 个请求，拒绝 %2 个（队列已满），%3 个（等待过久）"};
+const char *SV_PRIORITY_SUMMARY[] = {"⏫ %1: %2 requests, waited avg %3 ms, latency avg %4 ms, p95 %5 ms",
+                                     "⏫ %1：%2 次请求，平均等待 %3 ms，平均延迟 %4 ms，p95 %5 ms"};
+const char *SV_CLIENT_SUMMARY[] = {"⚖️ Client %1 (weight %2): %3 requests, ~%4 tokens, waited avg %5 ms",
+                                   "⚖️ 客户端 %1（权重 %2）：%3 次请求，约 %4 tokens，平均等待 %5 ms"};
+const char *SV_ABANDONED[] = {"🪦 Client gave up, upstream request cancelled: ", "🪦 客户端已放弃，已取消上游请求: "};
+const char *SV_ABANDON_SUMMARY[] = {"🪦 Clients gave up: %1 queued translations skipped, %2 running ones aborted, ~%3 tokens saved",
+                                    "🪦 客户端已放弃：跳过 %1 个排队的翻译，中止 %2 个进行中的翻译，约节省 %3 tokens"};
+const char *SV_BATCH_API[] = {"📚 Batch API: %1 items, %2 translated, %3 failed [⏱️ %4 ms]",
+                              "📚 批量接口：%1 项，成功 %2 项，失败 %3 项 [⏱️ %4 ms]"};
+const char *SV_PRIORITY_NAMES[][2] = {{"UI text", "界面文本"}, {"Dialogue", "对白"}, {"Batch", "批量"}, {"Background", "后台"}};
+const char *SV_HEDGE_SENT[] = {"🏁 Hedged a request still running after %1 ms: ", "🏁 请求 %1 ms 后仍未返回，已发送对冲请求: "};
+const char *SV_HEDGE_SUMMARY[] = {"🏁 Hedging: %1 hedged requests, %2 won (%3%)", "🏁 对冲：发送 %1 次对冲请求，胜出 %2 次（%3%）"};
+const char *SV_CACHE_LOADED[] = {"📦 Translation memory loaded: %1 entries (config scope %2)", "📦 翻译记忆已加载：%1 条（配置作用域 %2）"};
+const char *SV_CACHE_HIT[] = {"⚡ Cache hit (%1 µs) | Hits: %2, Misses: %3", "⚡ 命中缓存 (%1 µs) | 命中: %2，未命中: %3"};
+const char *SV_CACHE_STATS[] = {"📦 Translation memory: %1 entries, Hits: %2, Misses: %3, Hit rate: %4% | RAM: %5 / %6 MB, Evictions: %7",
+                                "📦 翻译记忆：%1 条，命中: %2，未命中: %3，命中率: %4% | 内存: %5 / %6 MB，淘汰: %7"};
+
+// Items accepted by one /v1/translate/batch request ; 单个 /v1/translate/batch 请求接受的条目数
+static const size_t BATCH_API_MAX_ITEMS = 500;
 
 /**
  * Structure to hold temporary escape mappings during freeze/thaw operations.
@@ -123,6 +204,135 @@ QString TranslationServer::thawEscapesLocal(const QString &input, const EscapeMa
     return newResult;
 }
 
+// ==========================================
+// Template method: numbers and tags become slots, so "HP 120/300" and "HP 80/300"
+// share one cached translation of "HP [N_0]/[N_1]".
+// 模板方法：数字和标签变为槽位，"HP 120/300" 与 "HP 80/300" 共用 "HP [N_0]/[N_1]" 的缓存译文。
+// ==========================================
+
+// Tags as in freezeEscapesLocal, then numbers (with thousands/decimal separators).
+// 标签规则与 freezeEscapesLocal 相同，其次是数字（含千分位/小数分隔符）。
+static const QRegularExpression &templateValueRegex()
+{
+    static const QRegularExpression regex(R"(\{\{.*?\}\}|<[^>]+>|\d+(?:[.,]\d+)*)");
+    return regex;
+}
+
+QString TranslationServer::abstractTemplate(const QString &input, EscapeMap &slotMap)
+{
+    slotMap.map.clear();
+    slotMap.counter = 0;
+
+    // Long texts are prose, where numbers rarely repeat with the same wording.
+    // 长文本多为叙述，数字以相同措辞重复出现的情况很少。
+    if (input.length() > 200)
+        return QString();
+
+    static const QRegularExpression placeholder(R"(\[[TN]_\d+\])");
+    if (input.contains(placeholder))
+        return QString(); // Would be ambiguous with our own slots ; 会与槽位混淆
+
+    QString result;
+    int lastEnd = 0;
+    int numberCount = 0;
+    int tagCount = 0;
+    QRegularExpressionMatchIterator i = templateValueRegex().globalMatch(input);
+    while (i.hasNext())
+    {
+        QRegularExpressionMatch match = i.next();
+        result.append(input.mid(lastEnd, match.capturedStart() - lastEnd));
+
+        QString original = match.captured(0);
+        bool isTag = original.startsWith('<') || original.startsWith('{');
+        QString slotKey = isTag ? QString("[T_%1]").arg(tagCount++) : QString("[N_%1]").arg(numberCount++);
+        slotMap.map[slotKey] = original;
+        result.append(slotKey);
+        lastEnd = match.capturedEnd();
+    }
+    result.append(input.mid(lastEnd));
+    slotMap.counter = numberCount + tagCount;
+    return slotMap.map.isEmpty() ? QString() : result;
+}
+
+bool TranslationServer::fillTemplate(const QString &translation, const EscapeMap &slotMap, QString &result)
+{
+    // Same tolerance for bracket variants as thawEscapesLocal, but surrounding spaces are kept.
+    // 与 thawEscapesLocal 一样容忍不同括号，但保留两侧空格。
+    static const QRegularExpression slotRegex(R"([\[<【{]\s*([TN])_(\d+)\s*[\]>】}])", QRegularExpression::CaseInsensitiveOption);
+
+    QSet<QString> used;
+    QString filled;
+    int lastEnd = 0;
+    QRegularExpressionMatchIterator i = slotRegex.globalMatch(translation);
+    while (i.hasNext())
+    {
+        QRegularExpressionMatch match = i.next();
+        QString key = QString("[%1_%2]").arg(match.captured(1).toUpper()).arg(match.captured(2));
+        auto it = slotMap.map.constFind(key);
+        if (it == slotMap.map.constEnd() || used.contains(key))
+            return false; // Invented or duplicated slot ; 虚构或重复的槽位
+        used.insert(key);
+        filled.append(translation.mid(lastEnd, match.capturedStart() - lastEnd));
+        filled.append(it.value());
+        lastEnd = match.capturedEnd();
+    }
+    if (used.size() != slotMap.map.size())
+        return false; // A value was dropped ; 有值被丢弃
+    filled.append(translation.mid(lastEnd));
+    result = filled;
+    return true;
+}
+
+bool TranslationServer::extractTemplate(const QString &translation, const EscapeMap &slotMap, QString &templTranslation)
+{
+    // A value shared by two slots ("10/10") cannot be told apart ; 两个槽位值相同（"10/10"）时无法区分
+    QHash<QString, QString> slotOf;
+    for (auto it = slotMap.map.constBegin(); it != slotMap.map.constEnd(); ++it)
+    {
+        if (slotOf.contains(it.value()))
+            return false;
+        slotOf.insert(it.value(), it.key());
+    }
+
+    QSet<QString> used;
+    QString result;
+    int lastEnd = 0;
+    QRegularExpressionMatchIterator i = templateValueRegex().globalMatch(translation);
+    while (i.hasNext())
+    {
+        QRegularExpressionMatch match = i.next();
+        auto it = slotOf.constFind(match.captured(0));
+        if (it == slotOf.constEnd() || used.contains(it.value()))
+            return false; // Added, rewritten or repeated value ; 新增、改写或重复的值
+        used.insert(it.value());
+        result.append(translation.mid(lastEnd, match.capturedStart() - lastEnd));
+        result.append(it.value());
+        lastEnd = match.capturedEnd();
+    }
+    if (used.size() != slotMap.map.size())
+        return false; // A value was dropped ; 有值被丢弃
+    result.append(translation.mid(lastEnd));
+
+    QString refilled;
+    if (!fillTemplate(result, slotMap, refilled) || refilled != translation)
+        return false;
+    templTranslation = result;
+    return true;
+}
+
+bool TranslationServer::lookupTemplate(const QString &scope, const QString &text, QString &result)
+{
+    EscapeMap slotMap;
+    QString templ = abstractTemplate(text, slotMap);
+    QString templTranslation;
+    if (templ.isEmpty() || !TranslationCache::instance().lookup(scope, templ, templTranslation))
+        return false;
+    if (!fillTemplate(templTranslation, slotMap, result))
+        return false;
+    m_templateHits++;
+    return true;
+}
+
 // ==========================================
 // Implementation of TranslationServer
 // TranslationServer 的实现
@@ -144,6 +354,19 @@ TranslationServer::TranslationServer(QObject *parent) : QObject(parent), m_runni
     // 将日志消息转发到全局 LogManager。
     connect(this, &TranslationServer::logMessage, [](const QString &msg)
             { LogManager::instance().addLog(msg); });
+
+    // Term changes are handed to the maintenance thread, which invalidates affected entries.
+    // 术语变更交给维护线程处理，由其使受影响的条目失效。
+    GlossaryManager::instance().setChangeListener([this](const QList<GlossaryChange> &changes)
+                                                  {
+        std::lock_guard<std::mutex> lock(m_glossaryMutex);
+        if (!m_glossaryWorkerActive)
+            return;
+        m_glossaryChanges.append(changes);
+        m_glossaryCv.notify_one(); });
+
+    std::lock_guard<std::mutex> lock(m_configMutex);
+    refreshFingerprintLocked();
 }
 
 /**
@@ -153,6 +376,10 @@ TranslationServer::TranslationServer(QObject *parent) : QObject(parent), m_runni
 TranslationServer::~TranslationServer()
 {
     stopServer();
+    // No callback may run on the network thread once members start going away.
+    // 成员开始析构后，网络线程上不得再执行任何回调。
+    m_upstream.shutdown();
+    GlossaryManager::instance().setChangeListener(nullptr);
 }
 
 /**
@@ -163,18 +390,35 @@ TranslationServer::~TranslationServer()
  */
 void TranslationServer::updateConfig(const AppConfig &config)
 {
-    std::lock_guard<std::mutex> keyLock(m_keyMutex);
     std::lock_guard<std::mutex> cfgLock(m_configMutex);
     m_config = config;
-    m_apiKeys.clear();
-    QStringList keys = m_config.api_key.split(',', Qt::SkipEmptyParts);
-    for (const auto &k : keys)
-        m_apiKeys.push_back(k.trimmed());
-    m_currentKeyIndex = 0;
+    // The backend set up in the UI comes first, then the extra ones from the INI file.
+    // 界面中设置的上游排在最前，其后是 INI 文件中的额外上游。
+    QList<BackendConfig> backends;
+    backends.append(BackendConfig{m_config.api_address, m_config.api_key, m_config.model_name, m_config.primary_weight});
+    backends.append(m_config.extra_backends);
+    m_router.configure(backends, m_config.key_rpm, m_config.key_tpm);
+    m_retryPolicy.setBudgetPercent(m_config.retry_budget_percent);
+    m_hedger.configure(m_config.hedge_percentile, m_config.hedge_budget_percent);
+    // Weights are given per IP and kept per client ID, the key the scheduler sees.
+    // 权重按 IP 配置，按客户端 ID（调度器使用的键）保存。
+    QHash<QString, int> clientWeights;
+    for (const QString &entry : m_config.client_weights.split(QRegularExpression("[;,]"), Qt::SkipEmptyParts))
+    {
+        const int eq = entry.indexOf('=');
+        if (eq <= 0)
+            continue;
+        bool ok = false;
+        const int weight = entry.mid(eq + 1).trimmed().toInt(&ok);
+        if (ok && weight > 0)
+            clientWeights.insert(generateClientId(entry.left(eq).trimmed().toStdString()), weight);
+    }
+    m_scheduler.configure(m_config.upstream_concurrency, m_config.scheduler_lifo, clientWeights);
     if (m_config.enable_glossary)
     {
         GlossaryManager::instance().setFilePath(m_config.glossary_path);
     }
+    refreshFingerprintLocked();
 }
 
 /**
@@ -200,11 +444,20 @@ void TranslationServer::startServer()
     m_running = true;
     m_stopRequested = false;
 
+    // Cache appends and learned terms are written here, not on the network thread.
+    // 缓存追加与学到的术语在此线程写入，而不是在网络线程上。
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        m_writerActive = true;
+    }
+    m_writerThread = new std::thread(&TranslationServer::runWriter, this);
+
     m_serverThread = new std::thread(&TranslationServer::runServerLoop, this);
 
     int lang = 1;
     int port = 6800;
     int threads = 64;
+    int cacheBudgetMb = 64;
     QString glossaryPath = "";
 
     {
@@ -213,10 +466,39 @@ void TranslationServer::startServer()
         port = m_config.port;
         threads = std::clamp(m_config.max_threads, 64, 256);
         glossaryPath = m_config.glossary_path;
+        cacheBudgetMb = m_config.cache_budget_mb;
     }
 
     emit logMessage(QString(SV_LOG_START[lang]).arg(port).arg(threads));
 
+    // One manager per six concurrent HTTP/1.1 requests, then open the first connections early.
+    // 每六个并发 HTTP/1.1 请求对应一个管理器，并提前建立最初的几条连接。
+    m_upstream.ensureManagers((threads + 5) / 6);
+    m_upstream.resetStats();
+    m_retryPolicy.resetStats();
+    m_hedger.resetStats();
+    m_admission.resetStats();
+    m_scheduler.resetStats();
+    for (const QString &address : m_router.addresses())
+        m_upstream.prewarm(QUrl(address), 4);
+
+    // Open the memory-mapped translation memory (no-op if it is already open in this process).
+    // 打开内存映射的翻译记忆（本进程内已打开时不会重复打开）。
+    QString cacheReport;
+    TranslationCache::instance().setBudget(qint64(cacheBudgetMb) * 1024 * 1024);
+    int cachedEntries = TranslationCache::instance().open("translation_memory", &cacheReport);
+    emit logMessage(QString(SV_CACHE_LOADED[lang]).arg(cachedEntries).arg(configFingerprint()));
+    if (!cacheReport.isEmpty())
+        emit logMessage("📦 " + cacheReport);
+
+    // Warm-start from XUnity's own translation files, then keep the glossary index, in the background.
+    // 在后台用 XUnity 自身的译文文件预热缓存，随后维护术语索引。
+    if (!glossaryPath.isEmpty())
+        m_importThread = new std::thread([this, glossaryPath, lang]()
+                                         {
+            runImport(glossaryPath, lang);
+            runGlossaryWorker(glossaryPath, lang); });
+
     // Batch mode hijacking logic.
     // 打包模式接管逻辑。
     if (m_config.enable_batch && !glossaryPath.isEmpty())
@@ -239,6 +521,46 @@ void TranslationServer::startServer()
     emit serverStarted();
 }
 
+/**
+ * One-line health summary of a key: circuit state, success rate, error classes and latency.
+ * 密钥的单行健康摘要：熔断状态、成功率、错误分类与延迟。
+ */
+static QString formatKeyHealth(const KeyRateLimiter::KeyStats &stats, int lang)
+{
+    QString state = SV_KEY_STATE[lang];
+    if (stats.circuit == KeyCircuit::Open)
+        state = QString(SV_KEY_STATE_OPEN[lang]).arg((stats.reopenInMs + 999) / 1000);
+    else if (stats.circuit == KeyCircuit::HalfOpen)
+        state = SV_KEY_STATE_HALF_OPEN[lang];
+    return QString(SV_KEY_HEALTH[lang])
+        .arg(state)
+        .arg(QString::number(stats.successRate * 100.0, 'f', 0))
+        .arg(stats.authErrors)
+        .arg(stats.throttled)
+        .arg(stats.serverErrors)
+        .arg(stats.timeouts)
+        .arg(stats.avgLatencyMs);
+}
+
+/**
+ * Runtime health of a configured key, for display next to the key test results.
+ * 已配置密钥的运行时健康状态，用于在密钥测试结果旁显示。
+ *
+ * @param key  Key, optionally with its "#rpm=" suffix.
+ * @param lang UI language.
+ * @return Summary, or empty string if the key has not been used yet.
+ */
+QString TranslationServer::describeKeyHealth(const QString &key, int lang)
+{
+    const QString bare = KeyRateLimiter::stripLimits(key);
+    for (const KeyRateLimiter::KeyStats &stats : m_router.keyStats())
+    {
+        if (stats.key == bare && stats.requests > 0)
+            return formatKeyHealth(stats, lang);
+    }
+    return QString();
+}
+
 /**
  * Stop the HTTP server and clean up.
  * 停止 HTTP 服务器并清理。
@@ -251,6 +573,12 @@ void TranslationServer::stopServer()
     m_stopRequested = true;
     m_running = false;
 
+    // Outstanding upstream calls complete with "aborted", which releases the waiting workers.
+    // 未完成的上游请求以"已中止"结束，从而释放正在等待的工作线程。
+    m_upstream.cancelAll();
+    // Queued series start, see the stop flag and finish at once ; 排队中的序列启动后看到停止标志并立即结束
+    m_scheduler.flush();
+
     if (m_svr)
         m_svr->stop();
 
@@ -264,6 +592,27 @@ void TranslationServer::stopServer()
     delete m_svr;
     m_svr = nullptr;
 
+    m_glossaryCv.notify_all();
+    if (m_importThread && m_importThread->joinable())
+    {
+        m_importThread->join();
+        delete m_importThread;
+        m_importThread = nullptr;
+    }
+
+    // Queued writes are finished, not dropped ; 已排队的写入会写完，而不是丢弃
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        m_writerActive = false;
+    }
+    m_writeCv.notify_all();
+    if (m_writerThread && m_writerThread->joinable())
+    {
+        m_writerThread->join();
+        delete m_writerThread;
+        m_writerThread = nullptr;
+    }
+
     int lang = 1;
     int port = 6800; // default value / 默认值
     QString glossaryPath = "";
@@ -288,10 +637,386 @@ void TranslationServer::stopServer()
         }
     }
 
+    logCacheStats();
+
+    bool isDebug = false;
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        isDebug = m_config.enable_debug_mode;
+    }
+    UpstreamClient::Stats upstream = m_upstream.stats();
+    if (isDebug && upstream.requests > 0)
+    {
+        const quint64 reused = upstream.requests - std::min(upstream.newConnections, upstream.requests);
+        emit logMessage(QString(SV_UPSTREAM_STATS[lang])
+                            .arg(upstream.requests)
+                            .arg(upstream.newConnections)
+                            .arg(QString::number(100.0 * reused / upstream.requests, 'f', 1))
+                            .arg(upstream.newConnections > 0 ? upstream.handshakeMsTotal / qint64(upstream.newConnections) : 0));
+    }
+
+    for (const KeyRateLimiter::KeyStats &key : m_router.keyStats())
+    {
+        const bool troubled = key.throttled > 0 || key.successes < key.requests;
+        if (key.requests > 0 && (troubled || isDebug))
+            emit logMessage(QString(SV_KEY_SUMMARY[lang]).arg(KeyRateLimiter::maskKey(key.key)).arg(key.requests).arg(formatKeyHealth(key, lang)));
+    }
+
+    for (int i = 0; i < int(PriorityClass::Count); ++i)
+    {
+        const TranslationScheduler::ClassStats stats = m_scheduler.stats(PriorityClass(i));
+        if (stats.requests > 0 && (isDebug || stats.avgWaitMs > 0))
+            emit logMessage(QString(SV_PRIORITY_SUMMARY[lang])
+                                .arg(SV_PRIORITY_NAMES[i][lang])
+                                .arg(stats.requests)
+                                .arg(stats.avgWaitMs)
+                                .arg(stats.avgTotalMs)
+                                .arg(stats.p95TotalMs));
+    }
+
+    const QList<TranslationScheduler::ClientStats> clients = m_scheduler.clientStats();
+    if (clients.size() > 1)
+    {
+        for (const TranslationScheduler::ClientStats &client : clients)
+            emit logMessage(QString(SV_CLIENT_SUMMARY[lang])
+                                .arg(client.client)
+                                .arg(client.weight)
+                                .arg(client.requests)
+                                .arg(client.tokens)
+                                .arg(client.avgWaitMs));
+    }
+
+    const AdmissionController::Stats admission = m_admission.stats();
+    if (admission.rejectedFull + admission.rejectedStale > 0 || (isDebug && admission.admitted > 0))
+        emit logMessage(QString(SV_ADMISSION_SUMMARY[lang]).arg(admission.admitted).arg(admission.rejectedFull).arg(admission.rejectedStale));
+
+    if (m_router.count() > 1)
+    {
+        for (const BackendRouter::BackendStats &backend : m_router.stats())
+        {
+            if (backend.requests == 0 && !isDebug)
+                continue;
+            emit logMessage(QString(SV_BACKEND_SUMMARY[lang])
+                                .arg(backend.address)
+                                .arg(backend.model)
+                                .arg(backend.requests)
+                                .arg(backend.failures)
+                                .arg(QString::number(backend.errorRate * 100.0, 'f', 0))
+                                .arg(backend.avgLatencyMs)
+                                .arg(backend.failovers));
+        }
+    }
+
+    if (m_hedger.hedges() > 0)
+    {
+        emit logMessage(QString(SV_HEDGE_SUMMARY[lang])
+                            .arg(m_hedger.hedges())
+                            .arg(m_hedger.wins())
+                            .arg(QString::number(100.0 * m_hedger.wins() / m_hedger.hedges(), 'f', 1)));
+    }
+
+    if (m_retryPolicy.denied() > 0 || (isDebug && m_retryPolicy.retries() > 0))
+        emit logMessage(QString(SV_RETRY_SUMMARY[lang]).arg(m_retryPolicy.retries()).arg(m_retryPolicy.denied()));
+
+    if (m_microBatchCount > 0)
+    {
+        emit logMessage(QString(SV_MICROBATCH_SUMMARY[lang])
+                            .arg(m_microBatchCount.load())
+                            .arg(m_microBatchedItems.load())
+                            .arg(m_microBatchFallbacks.load()));
+    }
+
+    if (m_abandonedQueued + m_abandonedRunning > 0)
+    {
+        emit logMessage(QString(SV_ABANDON_SUMMARY[lang])
+                            .arg(m_abandonedQueued.load())
+                            .arg(m_abandonedRunning.load())
+                            .arg(m_abandonedTokens.load()));
+    }
+
+    if (m_streamCount > 0)
+    {
+        emit logMessage(QString(SV_STREAM_SUMMARY[lang])
+                            .arg(m_streamCount.load())
+                            .arg(m_streamTtftTotalMs.load() / qint64(m_streamCount.load()))
+                            .arg(m_streamEarlyStops.load()));
+    }
+
+    if (m_templateHits > 0)
+        emit logMessage(QString(SV_TEMPLATE_SUMMARY[lang]).arg(m_templateHits.load()));
+
+    if (m_coalescedCount > 0)
+        emit logMessage(QString(SV_COALESCE_SUMMARY[lang]).arg(m_coalescedCount.load()));
+
     emit logMessage(SV_LOG_STOP[lang]);
     emit serverStopped();
 }
 
+/**
+ * Import XUnity translation files into the translation memory (runs in a separate thread).
+ * 将 XUnity 译文文件导入翻译记忆（在单独线程中运行）。
+ *
+ * @param glossaryPath Glossary path used to locate the Translation directory.
+ * @param lang         Language index for log messages.
+ */
+void TranslationServer::runImport(const QString &glossaryPath, int lang)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    int files = 0;
+    qint64 imported = 0;
+    qint64 existing = 0;
+    const QString scope = configFingerprint();
+    const QStringList paths = XuaTranslationImporter::findTranslationFiles(glossaryPath);
+    for (const QString &path : paths)
+    {
+        if (m_stopRequested)
+            return;
+
+        QString fileName = QFileInfo(path).fileName();
+        auto result = XuaTranslationImporter::importFile(
+            path, scope,
+            [this]()
+            { return m_stopRequested.load(); },
+            [this, lang, fileName](const XuaTranslationImporter::Result &r)
+            { emit logMessage(QString(SV_IMPORT_PROGRESS[lang]).arg(fileName).arg(r.lines).arg(r.imported)); });
+
+        if (result.skipped)
+            continue;
+        files++;
+        imported += result.imported;
+        existing += result.existing;
+    }
+
+    if (files > 0)
+        emit logMessage(QString(SV_IMPORT_DONE[lang]).arg(files).arg(imported).arg(existing).arg(timer.elapsed()));
+}
+
+/**
+ * Glossary snapshot kept as a cache marker: revision on the first line, then "term=value" lines.
+ * 以缓存标记保存的术语表快照：第一行为版本，其后为 "术语=译文" 行。
+ */
+static QString serializeGlossary(const QString &revision, const QMap<QString, QString> &terms)
+{
+    QString out = revision + "\n";
+    for (auto it = terms.cbegin(); it != terms.cend(); ++it)
+        out += it.key() + "=" + it.value() + "\n";
+    return out;
+}
+
+static QMap<QString, QString> parseGlossary(const QString &snapshot)
+{
+    QMap<QString, QString> terms;
+    const QStringList lines = snapshot.split('\n', Qt::SkipEmptyParts);
+    for (int i = 1; i < lines.size(); ++i)
+    {
+        int sep = lines[i].indexOf('=');
+        if (sep > 0)
+            terms.insert(lines[i].left(sep), lines[i].mid(sep + 1));
+    }
+    return terms;
+}
+
+/**
+ * Keep the glossary index and apply term changes until the server stops (maintenance thread).
+ * 维护术语索引并处理术语变更，直到服务停止（维护线程）。
+ *
+ * Edits made while the server was not running are found by comparing the glossary with the
+ * snapshot saved at the end of the previous run.
+ * 服务未运行期间的编辑，通过与上次运行结束时保存的快照比对得出。
+ */
+void TranslationServer::runGlossaryWorker(const QString &glossaryPath, int lang)
+{
+    bool enabled = false;
+    bool retranslate = false;
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        enabled = m_config.enable_glossary;
+        retranslate = m_config.glossary_retranslate;
+    }
+    if (!enabled || m_stopRequested)
+        return;
+
+    GlossaryManager &glossary = GlossaryManager::instance();
+    TranslationCache &cache = TranslationCache::instance();
+    const QString markerKey = "glossary:" + glossaryPath;
+    auto shouldStop = [this]()
+    { return m_stopRequested.load(); };
+
+    {
+        std::lock_guard<std::mutex> lock(m_glossaryMutex);
+        m_glossaryWorkerActive = true;
+        m_glossaryChanges.clear();
+        m_retranslateQueue.clear();
+    }
+
+    QMap<QString, QString> terms = glossary.terms();
+    QString snapshot;
+    if (cache.lookupMarker(markerKey, snapshot) && snapshot.section('\n', 0, 0) != glossary.revision())
+    {
+        std::lock_guard<std::mutex> lock(m_glossaryMutex);
+        m_glossaryChanges.append(GlossaryManager::diffTerms(parseGlossary(snapshot), terms));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int pairs = m_glossaryIndex.rebuild(terms.keys(), shouldStop);
+    if (!m_stopRequested)
+        emit logMessage(QString(SV_GLOSSARY_INDEXED[lang]).arg(terms.size()).arg(pairs).arg(timer.elapsed()));
+
+    int retranslated = 0;
+    while (!m_stopRequested)
+    {
+        QList<GlossaryChange> changes;
+        QString source;
+        {
+            std::unique_lock<std::mutex> lock(m_glossaryMutex);
+            m_glossaryCv.wait_for(lock, std::chrono::seconds(1), [this]()
+                                  { return m_stopRequested || !m_glossaryChanges.isEmpty(); });
+            changes.swap(m_glossaryChanges);
+            // Re-translate at most one line per idle second, after pending changes.
+            // 先处理变更，空闲时每秒最多重译一行。
+            if (changes.isEmpty() && !m_retranslateQueue.isEmpty())
+                source = m_retranslateQueue.takeFirst();
+        }
+        if (m_stopRequested)
+            break;
+
+        if (!changes.isEmpty())
+        {
+            applyGlossaryChanges(changes, retranslate, lang);
+        }
+        else if (!source.isEmpty())
+        {
+            if (!performTranslation(source, "glossary-refresh").isEmpty())
+                retranslated++;
+            std::lock_guard<std::mutex> lock(m_glossaryMutex);
+            if (m_retranslateQueue.isEmpty())
+            {
+                emit logMessage(QString(SV_GLOSSARY_RETRANSLATED[lang]).arg(retranslated));
+                retranslated = 0;
+            }
+        }
+    }
+
+    bool applied = false;
+    {
+        std::lock_guard<std::mutex> lock(m_glossaryMutex);
+        m_glossaryWorkerActive = false;
+        applied = m_glossaryChanges.isEmpty();
+        m_glossaryChanges.clear();
+        m_retranslateQueue.clear();
+    }
+    m_glossaryIndex.clear();
+    // Unapplied changes are found again next start by diffing against the old snapshot.
+    // 未处理的变更会在下次启动时与旧快照比对后重新得出。
+    if (applied)
+        cache.storeMarker(markerKey, serializeGlossary(glossary.revision(), glossary.terms()));
+}
+
+/**
+ * Invalidate the cached translations whose source contains a changed term.
+ * 使原文包含已变更术语的缓存译文失效。
+ *
+ * An entry whose translation already contains the new term translation is kept: it was
+ * usually produced together with the term (addNewTerm) and is consistent with it.
+ * 译文中已包含该术语新译文的条目会被保留：它通常与该术语一同产生（addNewTerm），与之一致。
+ */
+void TranslationServer::applyGlossaryChanges(const QList<GlossaryChange> &changes, bool retranslate, int lang)
+{
+    TranslationCache &cache = TranslationCache::instance();
+    const QString currentScope = configFingerprint();
+    auto shouldStop = [this]()
+    { return m_stopRequested.load(); };
+
+    for (const GlossaryChange &change : changes)
+    {
+        int invalidated = 0;
+        int consistent = 0;
+        for (const GlossaryIndex::Entry &entry : m_glossaryIndex.entriesFor(change.term, shouldStop))
+        {
+            QString translation;
+            if (!cache.peek(entry.first, entry.second, translation))
+            {
+                m_glossaryIndex.removeEntry(entry.first, entry.second);
+                continue;
+            }
+            if (!change.value.isEmpty() && translation.contains(change.value, Qt::CaseInsensitive))
+            {
+                consistent++;
+                continue;
+            }
+
+            cache.remove(entry.first, entry.second);
+            m_glossaryIndex.removeEntry(entry.first, entry.second);
+            invalidated++;
+
+            // Only entries of the active config can be re-translated with it.
+            // 只有当前配置的条目能用当前配置重译。
+            if (retranslate && entry.first == currentScope)
+            {
+                std::lock_guard<std::mutex> lock(m_glossaryMutex);
+                if (m_retranslateQueue.size() < 1000 && !m_retranslateQueue.contains(entry.second))
+                    m_retranslateQueue << entry.second;
+            }
+        }
+        if (invalidated > 0)
+            emit logMessage(QString(SV_GLOSSARY_INVALIDATED[lang]).arg(change.term).arg(invalidated).arg(consistent));
+    }
+}
+
+/**
+ * Store a translation and index it against the glossary terms.
+ * 保存译文，并针对术语建立索引。
+ *
+ * Called from the network thread, so the log append and the term scan are left to the writer.
+ * 由网络线程调用，因此日志追加与术语扫描交给写入线程。
+ */
+void TranslationServer::cacheTranslation(const QString &scope, const QString &source, const QString &translation)
+{
+    queueWrite([this, scope, source, translation]()
+               {
+        TranslationCache::instance().insert(scope, source, translation);
+        m_glossaryIndex.addEntry(scope, source); });
+}
+
+void TranslationServer::queueWrite(std::function<void()> write)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        if (m_writerActive)
+        {
+            m_writeQueue.push_back(std::move(write));
+            m_writeCv.notify_one();
+            return;
+        }
+    }
+    write();
+}
+
+/**
+ * Writer thread: runs queued disk writes in order until stopped and drained.
+ * 写入线程：按顺序执行排队的磁盘写入，直到停止且队列写完。
+ */
+void TranslationServer::runWriter()
+{
+    while (true)
+    {
+        std::function<void()> write;
+        {
+            std::unique_lock<std::mutex> lock(m_writeMutex);
+            m_writeCv.wait(lock, [this]()
+                           { return !m_writerActive || !m_writeQueue.empty(); });
+            if (m_writeQueue.empty())
+                return;
+            write = std::move(m_writeQueue.front());
+            m_writeQueue.pop_front();
+        }
+        write();
+    }
+}
+
 /**
  * Main server loop (runs in a separate thread).
  * 主服务器循环（在单独线程中运行）。
@@ -306,10 +1031,42 @@ void TranslationServer::runServerLoop()
         std::lock_guard<std::mutex> lock(m_configMutex);
         threads = std::clamp(m_config.max_threads, 64, 256);
         port = m_config.port;
+        m_admission.configure(threads, m_config.max_queued_requests, m_config.max_queue_ms);
     }
 
-    m_svr->new_task_queue = [threads]
-    { return new httplib::ThreadPool(threads); };
+    m_svr->new_task_queue = [this]
+    { return m_admission.createQueue(); };
+
+    // Every request passes admission first: a flood gets fast 503s instead of minutes of queueing.
+    // 每个请求先经过准入：洪峰会很快得到 503，而不是排队数分钟。
+    m_svr->set_pre_routing_handler([this](const httplib::Request &, httplib::Response &res)
+                                   {
+        const AdmissionController::Decision decision = m_admission.check();
+        if (decision == AdmissionController::Decision::Admit)
+            return httplib::Server::HandlerResponse::Unhandled;
+
+        const int retryAfter = m_admission.retryAfterSeconds();
+        res.status = 503;
+        res.set_header("Retry-After", std::to_string(retryAfter));
+        // A shed connection is never served, so the client should not reuse it ; 被拒连接永远不会得到服务，客户端不应复用它
+        if (decision == AdmissionController::Decision::RejectFull)
+            res.set_header("Connection", "close");
+        res.set_content("Server busy", "text/plain");
+
+        // At most one log line every 5 s during a flood ; 洪峰期间每 5 秒最多记录一行日志
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        qint64 last = m_lastShedLogMs.load();
+        if (now - last >= 5000 && m_lastShedLogMs.compare_exchange_strong(last, now))
+        {
+            int langIdx = 1;
+            {
+                std::lock_guard<std::mutex> lock(m_configMutex);
+                langIdx = m_config.language;
+            }
+            const AdmissionController::Stats stats = m_admission.stats();
+            emit logMessage(QString(SV_ADMISSION_SHED[langIdx]).arg(stats.queued).arg(stats.rejectedFull + stats.rejectedStale).arg(retryAfter));
+        }
+        return httplib::Server::HandlerResponse::Handled; });
 
     // =========================================================
     // Route 1: Original Custom endpoint (with newline protection)
@@ -357,7 +1114,10 @@ void TranslationServer::runServerLoop()
         text.replace("\r\n", "[LF]");
         text.replace("\n", "[LF]");
 
-        QString result = performTranslation(text, QString::fromStdString(req.remote_addr));
+        std::shared_ptr<RequestLifetime> lifetime = createLifetime(req);
+        QString result = performTranslation(text, QString::fromStdString(req.remote_addr), true, true, RequestOrigin::Custom, lifetime);
+        const bool abandoned = result.isEmpty() && lifetime->abandoned();
+        lifetime->release();
 
         // Restore newlines from the placeholder.
         // 从占位符恢复换行符。
@@ -372,7 +1132,13 @@ void TranslationServer::runServerLoop()
             isDebugFinal = m_config.enable_debug_mode;
         }
 
-        if (result.isEmpty())
+        if (abandoned)
+        {
+            // Nobody reads this answer ; 已经没有人读取这个应答
+            res.status = 408;
+            res.set_content("Client gave up", "text/plain");
+        }
+        else if (result.isEmpty())
         {
             res.status = 500;
             res.set_content("Failed", "text/plain");
@@ -428,14 +1194,24 @@ void TranslationServer::runServerLoop()
         QElapsedTimer timer;
         timer.start();
 
-        // Newlines here are line separators; we keep them as is.
-        // 这里的换行符是行分隔符，我们原样保留。
-        QString result = performTranslation(text, QString::fromStdString(req.remote_addr));
+        // Newlines here are line separators: each line is cached and deduplicated on its own.
+        // 这里的换行符是行分隔符：每一行单独缓存与去重。
+        QStringList origLines = text.split('\n');
+        std::shared_ptr<RequestLifetime> lifetime = createLifetime(req);
+        QStringList transLines = performBatchTranslation(origLines, QString::fromStdString(req.remote_addr), lifetime);
+        lifetime->release();
+
+        // Every non-blank line needs its own translation: XUnity caches whatever comes back, so
+        // an incomplete batch is answered with an error and retried instead.
+        // 每个非空行都必须有自己的译文：XUnity 会缓存返回的任何内容，因此不完整的批次以错误应答并由其重试。
+        bool complete = transLines.size() == origLines.size();
+        for (int i = 0; complete && i < origLines.size(); ++i)
+            complete = !transLines[i].isEmpty() || origLines[i].trimmed().isEmpty();
 
         qint64 elapsed = timer.elapsed();
-        emit workFinished(!result.isEmpty() && !m_stopRequested);
+        emit workFinished(complete && !m_stopRequested);
 
-        if (result.isEmpty())
+        if (!complete)
         {
             res.status = 500;
             res.set_content("[]", "application/json");
@@ -448,16 +1224,10 @@ void TranslationServer::runServerLoop()
             isDebugFinal = m_config.enable_debug_mode;
         }
 
-        QStringList origLines = text.split('\n');
-        QStringList transLines = result.split('\n');
-
         for (int i = 0; i < origLines.size(); ++i)
         {
-            QString origL = origLines[i];
-            QString transL = (i < transLines.size()) ? transLines[i] : origL;
-
-            if (transL.isEmpty())
-                transL = "❌ [Missing]";
+            const QString &origL = origLines[i];
+            const QString &transL = transLines[i];
 
             if (isDebugFinal)
                 emit logMessage(QString("[Google] ") + QString(SV_LOG_REQ[langIdx]) + origL);
@@ -477,9 +1247,7 @@ void TranslationServer::runServerLoop()
         json innerArray = json::array();
         for (int i = 0; i < origLines.size(); ++i)
         {
-            QString origL = origLines[i];
-            QString transL = (i < transLines.size()) ? transLines[i] : origL;
-            json item = json::array({transL.toStdString(), origL.toStdString(), nullptr, nullptr, 1});
+            json item = json::array({transLines[i].toStdString(), origLines[i].toStdString(), nullptr, nullptr, 1});
             innerArray.push_back(item);
         }
 
@@ -490,65 +1258,1001 @@ void TranslationServer::runServerLoop()
     m_svr->Get("/translate_a/single", googleHandler);
     m_svr->Post("/translate_a/single", googleHandler);
 
-    m_svr->listen("0.0.0.0", port);
-}
-
-/**
- * Perform translation with retry logic.
- * 执行带有重试逻辑的翻译。
- * 
- * @param text      Input text.
- * @param clientIP  Client IP address (for context separation).
- * @return Translated text, or empty string on failure.
- */
-QString TranslationServer::performTranslation(const QString &text, const QString &clientIP)
-{
-    QString resultText = "";
-    int retryCount = 0;
-    const int MAX_RETRY_COUNT = 5;
-    const int RETRY_DELAY_MS = 1000;
-    int langIdx = 1;
+    // =========================================================
+    // Route 3: Native batch endpoint (JSON items, per-item results)
+    // 路由 3：原生批量端点（JSON 条目，逐项返回结果）
+    // =========================================================
+    // Request:  {"items": [{"id": "a", "text": "...", "context": "..."}, "plain text", ...], "context": "..."}
+    //           (a bare array of items is accepted too; "context" on the request applies to
+    //           items without their own)
+    // Response: {"results": [{"id": "a", "ok": true, "translation": "..."},
+    //                        {"id": 1, "ok": false, "error": "..."}], "succeeded": n, "failed": m}
+    // 请求：items 数组（也接受裸数组），请求级 "context" 用于没有自身提示的条目。
+    // 响应：逐项结果，允许部分成功；未提供 id 的条目以其序号作为 id。
+    auto batchApiHandler = [this](const httplib::Request &req, httplib::Response &res)
     {
-        std::lock_guard<std::mutex> lock(m_configMutex);
-        langIdx = m_config.language;
-    }
+        auto fail = [&res](int status, const std::string &message)
+        {
+            res.status = status;
+            res.set_content(json{{"error", message}}.dump(), "application/json; charset=utf-8");
+        };
+
+        json body = json::parse(req.body, nullptr, false);
+        if (body.is_discarded())
+            return fail(400, "body is not valid JSON");
+        std::string sharedContext;
+        if (body.is_object())
+        {
+            if (body.contains("context") && body["context"].is_string())
+                sharedContext = body["context"].get<std::string>();
+            body = body.contains("items") ? body["items"] : json();
+        }
+        if (!body.is_array() || body.empty())
+            return fail(400, "expected a non-empty \"items\" array");
+        if (body.size() > BATCH_API_MAX_ITEMS)
+            return fail(413, "too many items (max " + std::to_string(BATCH_API_MAX_ITEMS) + ")");
 
-    while (retryCount < MAX_RETRY_COUNT)
-    {
-        if (m_stopRequested)
+        int langIdx = 1;
+        bool isDebug = false;
         {
-            emit logMessage(SV_ABORTED[langIdx]);
-            return "";
+            std::lock_guard<std::mutex> lock(m_configMutex);
+            langIdx = m_config.language;
+            isDebug = m_config.enable_debug_mode;
         }
-        if (retryCount > 0)
+
+        // Malformed items get their error at once; the others are translated.
+        // 格式错误的条目立即得到错误；其余条目正常翻译。
+        json results = json::array();
+        QList<BatchItem> items;
+        QList<int> itemSlots;
+        for (size_t i = 0; i < body.size(); ++i)
         {
-            QString retryMsg = QString(SV_RETRY_ATTEMPT[langIdx]).arg(retryCount + 1).arg(MAX_RETRY_COUNT);
-            emit logMessage(retryMsg);
-            for (int i = 0; i < RETRY_DELAY_MS / 100; ++i)
+            const json &entry = body[i];
+            json result = {{"id", int(i)}};
+            BatchItem item;
+            item.hint = QString::fromStdString(sharedContext);
+            if (entry.is_string())
             {
-                if (m_stopRequested)
-                    return "";
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                item.text = QString::fromStdString(entry.get<std::string>());
             }
+            else if (entry.is_object())
+            {
+                if (entry.contains("id") && (entry["id"].is_string() || entry["id"].is_number()))
+                    result["id"] = entry["id"];
+                if (entry.contains("text") && entry["text"].is_string())
+                    item.text = QString::fromStdString(entry["text"].get<std::string>());
+                if (entry.contains("context") && entry["context"].is_string())
+                    item.hint = QString::fromStdString(entry["context"].get<std::string>());
+            }
+            item.text = item.text.trimmed();
+            item.hint = item.hint.trimmed();
+            if (item.text.isEmpty())
+            {
+                result["ok"] = false;
+                result["error"] = "missing or empty \"text\"";
+            }
+            else
+            {
+                itemSlots << int(results.size());
+                items << item;
+            }
+            results.push_back(result);
         }
-        QString attemptResult = performSingleTranslationAttempt(text, clientIP);
-        if (m_stopRequested)
-            return "";
-        if (isValidTranslationResult(attemptResult))
-        {
-            if (retryCount > 0)
-                emit logMessage(SV_RETRY_SUCCESS[langIdx]);
-            resultText = attemptResult;
-            break;
-        }
-        retryCount++;
-        if (retryCount >= MAX_RETRY_COUNT)
+
+        emit workStarted();
+        QElapsedTimer timer;
+        timer.start();
+
+        QList<BatchItemResult> translated;
+        if (!items.isEmpty())
         {
-            emit logMessage(SV_RETRY_FAILED[langIdx]);
-            resultText = "";
+            std::shared_ptr<RequestLifetime> lifetime = createLifetime(req);
+            translated = performItemBatch(items, QString::fromStdString(req.remote_addr), lifetime);
+            lifetime->release();
+        }
+
+        int succeeded = 0;
+        for (int i = 0; i < items.size(); ++i)
+        {
+            json &result = results[size_t(itemSlots[i])];
+            const BatchItemResult &outcome = translated[i];
+            if (outcome.error.isEmpty())
+            {
+                succeeded++;
+                result["ok"] = true;
+                result["translation"] = outcome.translation.toStdString();
+            }
+            else
+            {
+                result["ok"] = false;
+                result["error"] = outcome.error.toStdString();
+            }
+
+            if (isDebug)
+            {
+                QString logText = items[i].text;
+                logText.replace("\n", "[LF]");
+                QString display = outcome.error.isEmpty() ? outcome.translation : "❌ " + outcome.error;
+                display.replace("\n", "[LF]");
+                emit logMessage(QString("[Batch API] ") + QString(SV_LOG_REQ[langIdx]) + logText);
+                emit logMessage("  -> " + display);
+            }
         }
+
+        const int failed = int(results.size()) - succeeded;
+        emit workFinished(succeeded > 0 && !m_stopRequested);
+        emit logMessage(QString(SV_BATCH_API[langIdx]).arg(results.size()).arg(succeeded).arg(failed).arg(timer.elapsed()));
+
+        json response = {{"results", results}, {"succeeded", succeeded}, {"failed", failed}};
+        res.set_content(response.dump(), "application/json; charset=utf-8");
+    };
+
+    m_svr->Post("/v1/translate/batch", batchApiHandler);
+
+    m_svr->listen("0.0.0.0", port);
+}
+
+/**
+ * Rough token count of a retry series for one text: the source plus a reply about as long,
+ * at about 3 UTF-8 bytes per token (see performSingleTranslationAttempt).
+ * 一个文本的重试序列的粗略 token 数：原文加上长度相当的译文，约 3 个 UTF-8 字节一个 token
+ * （见 performSingleTranslationAttempt）。
+ */
+static int estimateSeriesTokens(const QString &text)
+{
+    return 2 * (int(text.toUtf8().size() / 3) + 1);
+}
+
+/**
+ * Track an HTTP request from its arrival until its client stops waiting.
+ * 从到达起跟踪一个 HTTP 请求，直到其客户端不再等待。
+ *
+ * The client's timeout comes from the X-Client-Timeout-Ms header, else from the config
+ * (0 = none); the connection is watched either way.
+ * 客户端超时取自 X-Client-Timeout-Ms 请求头，否则取自配置（0 表示无）；连接状态始终会被监视。
+ */
+std::shared_ptr<RequestLifetime> TranslationServer::createLifetime(const httplib::Request &req)
+{
+    qint64 timeoutMs = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        timeoutMs = m_config.client_timeout_ms;
     }
-    return resultText;
+    if (req.has_header("X-Client-Timeout-Ms"))
+    {
+        bool ok = false;
+        const qint64 requested = QString::fromStdString(req.get_header_value("X-Client-Timeout-Ms")).trimmed().toLongLong(&ok);
+        if (ok && requested > 0)
+            timeoutMs = requested;
+    }
+    const qint64 arrivalMs = m_admission.arrivalMs();
+    return std::make_shared<RequestLifetime>(arrivalMs, timeoutMs > 0 ? arrivalMs + timeoutMs : 0, req.is_connection_closed);
+}
+
+/**
+ * Perform translation and wait for the result (httplib handlers, maintenance thread).
+ * 执行翻译并等待结果（httplib 处理函数、维护线程）。
+ *
+ * This is the only blocking edge of the pipeline: the caller parks on a future while the
+ * upstream call, retries and coalescing run on the network thread.
+ * 这是管线中唯一的阻塞入口：调用方在 future 上等待，上游请求、重试与合并都在网络线程上进行。
+ *
+ * @param text      Input text.
+ * @param clientIP  Client IP address (for context separation).
+ * @param useCache  Whether to read/write the translation memory for this exact text.
+ * @param allowMicroBatch Whether the upstream call may be shared with concurrent requests.
+ * @param origin    Where the request came from; sets its scheduling priority.
+ * @param lifetime  Client of the request; the wait ends early once it gives up. May be null.
+ * @param cacheable Receives whether the result came from the primary model. May be null.
+ * @return Translated text, or empty string on failure.
+ */
+QString TranslationServer::performTranslation(const QString &text, const QString &clientIP, bool useCache, bool allowMicroBatch, RequestOrigin origin,
+                                              std::shared_ptr<RequestLifetime> lifetime, bool *cacheable)
+{
+    auto promise = std::make_shared<std::promise<std::pair<QString, bool>>>();
+    std::future<std::pair<QString, bool>> future = promise->get_future();
+    performTranslationAsync(
+        text, clientIP, useCache, [promise](const QString &result, bool fromPrimary)
+        { promise->set_value({result, fromPrimary}); },
+        allowMicroBatch, origin, lifetime);
+
+    if (cacheable)
+        *cacheable = false;
+    // The HTTP worker is freed as soon as the client is gone ; 客户端离开后立即释放 HTTP 工作线程
+    while (future.wait_for(std::chrono::milliseconds(100)) != std::future_status::ready)
+    {
+        if (m_stopRequested || (lifetime && lifetime->abandoned()))
+            return "";
+    }
+    const std::pair<QString, bool> result = future.get();
+    if (cacheable)
+        *cacheable = result.second;
+    return result.first;
+}
+
+/**
+ * Perform translation: translation memory first, then templates, then the upstream path.
+ * 执行翻译：先查翻译记忆，再查模板，最后才走上游路径。
+ *
+ * @param text      Input text.
+ * @param clientIP  Client IP address (for context separation).
+ * @param useCache  Whether to read/write the translation memory for this exact text.
+ * @param done      Receives the translation, or an empty string on failure, and whether it may be
+ *                  stored in the current scope. Called exactly once, on the calling thread for
+ *                  local answers, otherwise on the network thread.
+ * @param allowMicroBatch Whether the upstream call may be shared with concurrent requests.
+ * @param origin    Where the request came from.
+ * @param lifetime  Client of the request, or null for our own work.
+ * @param hint      Context hint for the model. It changes the translation, so hinted texts
+ *                  are cached and coalesced in a scope of their own.
+ */
+void TranslationServer::performTranslationAsync(const QString &text, const QString &clientIP, bool useCache, TranslationCallback done, bool allowMicroBatch, RequestOrigin origin,
+                                                std::shared_ptr<RequestLifetime> lifetime, const QString &hint)
+{
+    int langIdx = 1;
+    bool isDebug = false;
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        langIdx = m_config.language;
+        isDebug = m_config.enable_debug_mode;
+    }
+
+    // Translation memory: answer repeated texts locally without calling the LLM.
+    // 翻译记忆：重复文本直接本地返回，不再请求大模型。
+    // Cache entries and in-flight requests only match within the same config fingerprint.
+    // 缓存条目与进行中的请求仅在相同配置指纹内匹配。
+    QString scope = configFingerprint();
+    if (!hint.isEmpty())
+        scope += "~" + QCryptographicHash::hash(hint.toUtf8(), QCryptographicHash::Md5).toHex().left(8);
+    TranslationCache &cache = TranslationCache::instance();
+    QElapsedTimer cacheTimer;
+    cacheTimer.start();
+    QString cachedText;
+    if (useCache && cache.lookup(scope, text, cachedText))
+    {
+        if (isDebug)
+            emit logMessage(QString(SV_CACHE_HIT[langIdx])
+                                .arg(cacheTimer.nsecsElapsed() / 1000)
+                                .arg(cache.hitCount())
+                                .arg(cache.missCount()));
+        done(cachedText, true);
+        return;
+    }
+
+    // Template cache: numbers and tags are slots, the template is learned from the first translation.
+    // 模板缓存：数字和标签作为槽位，模板从第一次的译文中提取。
+    bool useTemplate = false;
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        useTemplate = useCache && m_config.enable_template_cache;
+    }
+    EscapeMap slotMap;
+    QString templ = useTemplate ? abstractTemplate(text, slotMap) : QString();
+    if (!templ.isEmpty())
+    {
+        QString templTranslation;
+        QString filled;
+        if (cache.lookup(scope, templ, templTranslation) && fillTemplate(templTranslation, slotMap, filled))
+        {
+            m_templateHits++;
+            if (isDebug)
+                emit logMessage(QString(SV_TEMPLATE_HIT[langIdx]) + templ.left(50));
+            done(filled, true);
+            return;
+        }
+
+        // Nothing left to translate, e.g. "120/300" or a bare tag.
+        // 没有可翻译的内容，例如 "120/300" 或单独的标签。
+        QString letters = templ;
+        letters.remove(QRegularExpression(R"(\[[TN]_\d+\])"));
+        if (std::none_of(letters.cbegin(), letters.cend(), [](QChar c)
+                         { return c.isLetter(); }))
+        {
+            done(text, true);
+            return;
+        }
+
+        // The model only ever sees the real text. Its translation becomes the template's
+        // when the values map back onto their slots and fill back to the same translation.
+        // 模型只会看到真实文本。当译文中的值能对应回各自槽位、且填回后与译文一致时，才将其作为模板译文。
+        performUpstreamTranslation(
+            text, clientIP, true, scope, [this, scope, templ, slotMap, done](const QString &result, bool cacheable)
+            {
+            QString templTranslation;
+            if (cacheable && !result.isEmpty() && extractTemplate(result, slotMap, templTranslation))
+                cacheTranslation(scope, templ, templTranslation);
+            done(result, cacheable); },
+            allowMicroBatch, origin, lifetime, hint);
+        return;
+    }
+
+    performUpstreamTranslation(text, clientIP, useCache, scope, done, allowMicroBatch, origin, lifetime, hint);
+}
+
+/**
+ * Upstream path of a translation: quarantine, in-flight coalescing, then the LLM with retries.
+ * 翻译的上游路径：隔离检查、合并进行中的相同请求，最后带重试地请求大模型。
+ *
+ * @param text      Input text.
+ * @param clientIP  Client IP address (for context separation).
+ * @param useCache  Whether to store the result in the translation memory.
+ * @param scope     Config fingerprint the request was started under.
+ * @param done      Receives the translation, or an empty string on failure.
+ * @param allowMicroBatch Whether the upstream call may be shared with concurrent requests.
+ * @param origin    Where the request came from.
+ * @param lifetime  Client of the request, or null for our own work.
+ * @param hint      Context hint for the model, or empty.
+ */
+void TranslationServer::performUpstreamTranslation(const QString &text, const QString &clientIP, bool useCache, const QString &scope, TranslationCallback done, bool allowMicroBatch, RequestOrigin origin,
+                                                   std::shared_ptr<RequestLifetime> lifetime, const QString &hint)
+{
+    int langIdx = 1;
+    bool isDebug = false;
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        langIdx = m_config.language;
+        isDebug = m_config.enable_debug_mode;
+    }
+
+    // Negative cache: texts the model keeps refusing fail fast until their quarantine ends.
+    // 负缓存：模型反复拒绝的文本在隔离期结束前直接失败。
+    QString textKey = scope + "|" + text.normalized(QString::NormalizationForm_C).trimmed();
+    QuarantineManager &quarantine = QuarantineManager::instance();
+    qint64 remainingMs = 0;
+    if (quarantine.isQuarantined(textKey, remainingMs))
+    {
+        if (isDebug)
+            emit logMessage(QString(SV_QUARANTINE_SKIP[langIdx]).arg((remainingMs + 999) / 1000) + text.left(50));
+        done("", false);
+        return;
+    }
+
+    // Single-flight: identical concurrent texts share one upstream call; followers only
+    // leave a callback behind instead of waiting on a thread.
+    // 单飞合并：并发的相同文本共享同一次上游请求；跟随者只留下一个回调，而不占用线程等待。
+    std::string flightKey = textKey.toStdString();
+    bool isFollower = false;
+    {
+        std::lock_guard<std::mutex> lock(m_inFlightMutex);
+        auto it = m_inFlight.find(flightKey);
+        if (it != m_inFlight.end())
+        {
+            it->second.followers.push_back(done);
+            it->second.waiters.push_back(lifetime);
+            m_coalescedCount++;
+            isFollower = true;
+        }
+        else
+        {
+            m_inFlight.emplace(flightKey, InFlightRequest{{}, {lifetime}});
+        }
+    }
+    if (isFollower)
+    {
+        if (isDebug)
+            emit logMessage(SV_COALESCED[langIdx]);
+        return;
+    }
+
+    // A text released from quarantine gets a single probe instead of the full retry series.
+    // 刚解除隔离的文本只试探一次，而不是完整的重试序列。
+    const int maxAttempts = quarantine.failureCount(textKey) > 0 ? 1 : 5;
+    RetryCallback finish = [this, text, textKey, flightKey, scope, useCache, langIdx, done](const QString &resultText, bool contentRejected, bool cacheable)
+    {
+        QuarantineManager &quarantine = QuarantineManager::instance();
+        if (!resultText.isEmpty())
+        {
+            quarantine.recordSuccess(textKey);
+            // The scope only covers the primary model ; 作用域只对应主模型
+            if (useCache && cacheable)
+                cacheTranslation(scope, text, resultText);
+        }
+        else if (contentRejected && !m_stopRequested)
+        {
+            qint64 duration = quarantine.recordFailure(textKey, text);
+            emit logMessage(QString(SV_QUARANTINED[langIdx]).arg(duration / 1000).arg(quarantine.failureCount(textKey)) + text.left(50));
+        }
+
+        std::vector<TranslationCallback> followers;
+        {
+            std::lock_guard<std::mutex> lock(m_inFlightMutex);
+            auto it = m_inFlight.find(flightKey);
+            if (it != m_inFlight.end())
+            {
+                followers.swap(it->second.followers);
+                m_inFlight.erase(it);
+            }
+        }
+        done(resultText, cacheable);
+        for (const TranslationCallback &follower : followers)
+            follower(resultText, cacheable);
+    };
+
+    int microBatchWindow = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        microBatchWindow = m_config.micro_batch_window_ms;
+    }
+    // The call is only worth making while one of the requests sharing it is still waiting.
+    // 只有在共享该调用的请求中仍有一个在等待时，这次调用才有意义。
+    AbandonedCheck abandoned;
+    if (lifetime)
+    {
+        abandoned = [this, flightKey]()
+        {
+            std::lock_guard<std::mutex> lock(m_inFlightMutex);
+            auto it = m_inFlight.find(flightKey);
+            return it != m_inFlight.end() && RequestLifetime::allAbandoned(it->second.waiters);
+        };
+    }
+
+    // A hint applies to its own text only, so hinted texts are never micro-batched.
+    // 提示只适用于其自身的文本，因此带提示的文本不参与合批。
+    const PriorityClass priority = TranslationScheduler::classify(origin, text);
+    if (allowMicroBatch && hint.isEmpty() && microBatchWindow > 0 && text.size() <= 200 && !text.contains('\n'))
+        submitMicroBatch(scope, clientIP, MicroBatchItem{text, maxAttempts, priority, finish, abandoned});
+    else
+        performTranslationWithRetry(text, clientIP, maxAttempts, finish, priority, abandoned, hint);
+}
+
+/**
+ * Add a request to the micro-batch of its client and config. The first request starts the
+ * window timer; a full batch is sent at once.
+ * 将请求加入其客户端与配置对应的合批。第一个请求启动窗口定时器；批次满时立即发送。
+ */
+void TranslationServer::submitMicroBatch(const QString &scope, const QString &clientIP, MicroBatchItem item)
+{
+    int windowMs = 30;
+    int maxItems = 16;
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        windowMs = m_config.micro_batch_window_ms;
+        maxItems = m_config.micro_batch_max_items;
+    }
+
+    const QString key = scope + "|" + clientIP;
+    std::vector<MicroBatchItem> full;
+    quint64 startedId = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_microBatchMutex);
+        PendingMicroBatch &batch = m_microBatches[key];
+        if (batch.items.empty())
+        {
+            batch.id = m_nextMicroBatchId++;
+            batch.clientIP = clientIP;
+            startedId = batch.id;
+        }
+        batch.items.push_back(std::move(item));
+        if (int(batch.items.size()) >= maxItems)
+        {
+            full.swap(batch.items);
+            m_microBatches.erase(key);
+        }
+    }
+
+    if (!full.empty())
+    {
+        runMicroBatch(clientIP, std::move(full));
+        return;
+    }
+    if (startedId != 0)
+    {
+        m_upstream.schedule(windowMs, [this, key, startedId]()
+                            {
+            std::vector<MicroBatchItem> items;
+            QString ip;
+            {
+                std::lock_guard<std::mutex> lock(m_microBatchMutex);
+                auto it = m_microBatches.find(key);
+                // The batch may already have been sent because it filled up.
+                // 批次可能因已满而提前发送。
+                if (it == m_microBatches.end() || it->second.id != startedId)
+                    return;
+                items.swap(it->second.items);
+                ip = it->second.clientIP;
+                m_microBatches.erase(it);
+            }
+            runMicroBatch(ip, std::move(items)); });
+    }
+}
+
+/**
+ * Send a micro-batch as one numbered multi-line prompt ("#1: ...") and hand each line back
+ * to its request. Lines that are missing, repeated or spill over fall back to their own request.
+ * 将合批作为一个编号多行提示（"#1: ..."）发送，并把每一行交还给对应的请求。
+ * 缺失、重复或跨行的行回退为单独请求。
+ */
+void TranslationServer::runMicroBatch(const QString &clientIP, std::vector<MicroBatchItem> items)
+{
+    // Lines nobody waits for any more are dropped before the prompt is built.
+    // 构建提示词之前丢弃已经没有人等待的行。
+    std::vector<MicroBatchItem> live;
+    for (MicroBatchItem &item : items)
+    {
+        if (item.abandoned && item.abandoned())
+        {
+            m_abandonedQueued++;
+            m_abandonedTokens += estimateSeriesTokens(item.text);
+            item.done("", false, false);
+        }
+        else
+        {
+            live.push_back(std::move(item));
+        }
+    }
+    items.swap(live);
+    if (items.empty())
+        return;
+
+    if (items.size() == 1)
+    {
+        performTranslationWithRetry(items[0].text, clientIP, items[0].maxAttempts, items[0].done, items[0].priority, items[0].abandoned);
+        return;
+    }
+
+    // The batch runs at the priority of its most urgent line ; 合批按其中最紧急的一行的优先级调度
+    QStringList lines;
+    PriorityClass priority = PriorityClass::Background;
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        lines << QString("#%1: %2").arg(i + 1).arg(items[i].text);
+        priority = std::min(priority, items[i].priority);
+    }
+    m_microBatchCount++;
+    m_microBatchedItems += items.size();
+
+    auto shared = std::make_shared<std::vector<MicroBatchItem>>(std::move(items));
+    AbandonedCheck abandoned = [shared]()
+    {
+        for (const MicroBatchItem &item : *shared)
+        {
+            if (!item.abandoned || !item.abandoned())
+                return false;
+        }
+        return true;
+    };
+    // One attempt only: a failed batch falls back to requests that have their own retries.
+    // 只尝试一次：失败的合批会回退为各自带重试的单独请求。
+    performTranslationWithRetry(lines.join('\n'), clientIP, 1, [this, clientIP, shared](const QString &block, bool, bool cacheable)
+                                {
+        static const QRegularExpression numbered(R"(^\s*[#＃]?\s*(\d+)\s*[:：]\s?(.*)$)");
+        QHash<int, QString> byNumber;
+        QSet<int> broken;
+        int last = -1;
+        for (const QString &line : block.split('\n'))
+        {
+            QRegularExpressionMatch m = numbered.match(line);
+            if (m.hasMatch())
+            {
+                last = m.captured(1).toInt();
+                if (byNumber.contains(last))
+                    broken.insert(last);
+                byNumber.insert(last, m.captured(2).trimmed());
+            }
+            else if (!line.trimmed().isEmpty())
+            {
+                broken.insert(last); // Translation spilled onto an unnumbered line ; 译文溢出到无编号的行
+            }
+        }
+
+        int fallbacks = 0;
+        for (size_t i = 0; i < shared->size(); ++i)
+        {
+            MicroBatchItem &item = (*shared)[i];
+            const int number = int(i) + 1;
+            QString translated = byNumber.value(number);
+            if (!m_stopRequested && !broken.contains(number) && isValidTranslationResult(translated))
+            {
+                item.done(translated, false, cacheable);
+            }
+            else
+            {
+                fallbacks++;
+                performTranslationWithRetry(item.text, clientIP, item.maxAttempts, item.done, item.priority, item.abandoned);
+            }
+        }
+        m_microBatchFallbacks += fallbacks;
+
+        bool isDebug = false;
+        int langIdx = 1;
+        {
+            std::lock_guard<std::mutex> lock(m_configMutex);
+            isDebug = m_config.enable_debug_mode;
+            langIdx = m_config.language;
+        }
+        if (isDebug)
+            emit logMessage(QString(SV_MICROBATCH[langIdx]).arg(shared->size()).arg(fallbacks)); },
+                                priority, abandoned, QString(), true);
+}
+
+/**
+ * Translate a batch line by line: cached and repeated lines are answered locally,
+ * only the unique missing lines are sent upstream as one block.
+ * 逐行翻译一个批次：已缓存和重复的行在本地应答，只有去重后的缺失行作为一个整块发往上游。
+ *
+ * @param lines     Source lines (order is preserved in the result).
+ * @param clientIP  Client IP address (for context separation).
+ * @param lifetime  Client of the request, or null.
+ * @return One translation per input line, or an empty list on failure.
+ */
+QStringList TranslationServer::performBatchTranslation(const QStringList &lines, const QString &clientIP, std::shared_ptr<RequestLifetime> lifetime)
+{
+    int langIdx = 1;
+    bool isDebug = false;
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        langIdx = m_config.language;
+        isDebug = m_config.enable_debug_mode;
+    }
+
+    bool useTemplate = false;
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        useTemplate = m_config.enable_template_cache;
+    }
+
+    const QString scope = configFingerprint();
+    TranslationCache &cache = TranslationCache::instance();
+    QStringList results;
+    QStringList missing;             // Unique lines to send upstream ; 需要发往上游的去重行
+    QHash<QString, int> missingSlot; // Line → index in missing ; 行 → 在 missing 中的位置
+    QVector<int> pendingLines;       // Result positions waiting for upstream ; 等待上游结果的位置
+    int cachedCount = 0;
+    int duplicateCount = 0;
+
+    for (const QString &line : lines)
+    {
+        QString key = line.trimmed();
+        QString cached;
+        if (key.isEmpty())
+        {
+            results << line;
+        }
+        else if (missingSlot.contains(key))
+        {
+            duplicateCount++;
+            results << QString();
+            pendingLines << results.size() - 1;
+        }
+        else if (cache.lookup(scope, key, cached) || (useTemplate && lookupTemplate(scope, key, cached)))
+        {
+            cachedCount++;
+            results << cached;
+        }
+        else
+        {
+            missingSlot.insert(key, missing.size());
+            missing << key;
+            results << QString();
+            pendingLines << results.size() - 1;
+        }
+    }
+
+    if (isDebug && lines.size() > 1)
+        emit logMessage(QString(SV_BATCH_SPLIT[langIdx]).arg(lines.size()).arg(cachedCount).arg(duplicateCount).arg(missing.size()));
+
+    if (missing.isEmpty())
+        return results;
+
+    QStringList translated;
+    if (missing.size() == 1)
+    {
+        QString single = performTranslation(missing.first(), clientIP, true, false, RequestOrigin::Batch, lifetime);
+        if (single.isEmpty())
+            return QStringList();
+        translated << single;
+    }
+    else
+    {
+        // The joined block itself is not cached; its lines are, once they line up and the
+        // primary model produced them.
+        // 拼接后的整块本身不缓存；行数对齐且由主模型生成时逐行缓存。
+        bool cacheable = false;
+        QString block = performTranslation(missing.join('\n'), clientIP, false, false, RequestOrigin::Batch, lifetime, &cacheable);
+        if (block.isEmpty())
+            return QStringList();
+        translated = block.split('\n');
+
+        if (translated.size() == missing.size())
+        {
+            for (int i = 0; cacheable && i < missing.size(); ++i)
+            {
+                if (isValidTranslationResult(translated[i].trimmed()))
+                    cacheTranslation(scope, missing[i], translated[i]);
+            }
+        }
+        else
+        {
+            // Lines were dropped or merged, so no line can be trusted to belong to its source
+            // (XUnity caches whatever it gets back). Each line is translated on its own instead.
+            // If any of them fails the whole batch fails, so XUnity retries it; the lines that
+            // did succeed are cached by then and answered locally on the retry.
+            // 有行被丢弃或合并，任何一行都无法确认对应其原文（XUnity 会缓存返回的任何内容），改为逐行单独翻译。
+            // 任何一行失败则整个批次失败，由 XUnity 重试；成功的行此时已缓存，重试时在本地应答。
+            emit logMessage(QString(SV_BATCH_MISMATCH[langIdx]).arg(missing.size()).arg(translated.size()));
+            QList<BatchItem> items;
+            for (const QString &line : missing)
+                items << BatchItem{line, QString()};
+            const QList<BatchItemResult> perLine = performItemBatch(items, clientIP, lifetime);
+            translated.clear();
+            for (const BatchItemResult &result : perLine)
+            {
+                if (!result.error.isEmpty())
+                    return QStringList();
+                translated << result.translation;
+            }
+        }
+    }
+
+    for (int pos : pendingLines)
+        results[pos] = translated[missingSlot.value(lines[pos].trimmed())];
+    return results;
+}
+
+/**
+ * Translate independent items concurrently. Each item takes the full single-text path
+ * (translation memory, templates, quarantine, single-flight, micro-batching) on its own, so it
+ * is cached on its own and one failing item does not fail the others.
+ * 并发翻译彼此独立的条目。每个条目单独走完整的单文本路径（翻译记忆、模板、隔离、单飞合并、合批），
+ * 因此逐项缓存，且一个条目失败不会影响其他条目。
+ *
+ * @param items     Items; newlines in a text are kept.
+ * @param clientIP  Client IP address (for context separation).
+ * @param lifetime  Client of the request; the wait ends early once it gives up. May be null.
+ * @return One result per item, with an error for the items that failed or were not finished.
+ */
+QList<BatchItemResult> TranslationServer::performItemBatch(const QList<BatchItem> &items, const QString &clientIP, std::shared_ptr<RequestLifetime> lifetime)
+{
+    struct Pending
+    {
+        std::mutex mutex;
+        QStringList translations;
+        QList<bool> finished;
+        int remaining = 0;
+        std::promise<void> done;
+    };
+    auto pending = std::make_shared<Pending>();
+    for (int i = 0; i < items.size(); ++i)
+    {
+        pending->translations << QString();
+        pending->finished << false;
+    }
+    pending->remaining = int(items.size());
+    std::future<void> future = pending->done.get_future();
+
+    for (int i = 0; i < items.size(); ++i)
+    {
+        // Same newline protection as the "/" endpoint ; 与 "/" 端点相同的换行符保护
+        QString text = items[i].text;
+        text.replace("\r\n", "[LF]");
+        text.replace("\n", "[LF]");
+        performTranslationAsync(
+            text, clientIP, true, [pending, i](const QString &result, bool)
+            {
+            QString translation = result;
+            translation.replace("[LF]", "\n");
+            std::lock_guard<std::mutex> lock(pending->mutex);
+            pending->translations[i] = translation;
+            pending->finished[i] = true;
+            if (--pending->remaining == 0)
+                pending->done.set_value(); },
+            true, RequestOrigin::Batch, lifetime, items[i].hint);
+    }
+
+    while (future.wait_for(std::chrono::milliseconds(100)) != std::future_status::ready)
+    {
+        if (m_stopRequested || (lifetime && lifetime->abandoned()))
+            break;
+    }
+
+    QList<BatchItemResult> results;
+    std::lock_guard<std::mutex> lock(pending->mutex);
+    for (int i = 0; i < items.size(); ++i)
+    {
+        BatchItemResult result;
+        result.translation = pending->translations[i];
+        if (!pending->finished[i])
+            result.error = m_stopRequested ? "server stopping" : "client gave up";
+        else if (result.translation.isEmpty())
+            result.error = "translation failed";
+        results << result;
+    }
+    return results;
+}
+
+/**
+ * Progress of one retry series; shared by the callbacks that drive it.
+ * 一个重试序列的进度；由驱动它的各个回调共享。
+ */
+struct RetryState
+{
+    QString text;
+    QString clientIP;
+    int maxAttempts = 5;
+    int retryCount = 0;
+    int rejectedCount = 0;
+    int langIdx = 1;
+    TranslationServer::RetryCallback done;
+    TranslationServer::AbandonedCheck abandoned;
+    QString hint;
+    bool numbered = false;
+};
+
+/**
+ * Call the LLM with retry logic (no caching, no coalescing).
+ * 调用大模型并执行重试逻辑（不涉及缓存与合并）。
+ *
+ * @param text        Input text.
+ * @param clientIP    Client IP address (for context separation).
+ * @param maxAttempts Maximum number of attempts.
+ * @param done        Receives the translation (empty on failure), whether the upstream answered
+ *                    but every failed attempt was refused or invalid, and whether the translation
+ *                    came from the primary model; runs on the network thread.
+ * @param priority    Scheduling class; the series waits in the scheduler until its turn, which
+ *                    also depends on the client's fair share.
+ * @param abandoned   True once nobody waits for the result: the series is then skipped in the
+ *                    queue or aborted. May be empty.
+ * @param hint        Context hint for the model, or empty.
+ * @param numbered    True for the numbered lines ("#n: ") of a micro-batch.
+ */
+void TranslationServer::performTranslationWithRetry(const QString &text, const QString &clientIP, int maxAttempts, RetryCallback done, PriorityClass priority,
+                                                    AbandonedCheck abandoned, const QString &hint, bool numbered)
+{
+    auto state = std::make_shared<RetryState>();
+    auto ticket = std::make_shared<TranslationScheduler::Ticket>();
+    state->text = text;
+    state->clientIP = clientIP;
+    state->maxAttempts = maxAttempts;
+    state->abandoned = abandoned;
+    state->hint = hint;
+    state->numbered = numbered;
+    // The slot is handed on before the caller continues, which may schedule more work.
+    // 在调用方继续（可能调度更多工作）之前先交出名额。
+    state->done = [this, ticket, done = std::move(done)](const QString &result, bool contentRejected, bool cacheable)
+    {
+        m_scheduler.finish(*ticket);
+        done(result, contentRejected, cacheable);
+    };
+    // Fair-share cost: prompt plus source plus a reply about as long as the source.
+    // 公平份额的成本：提示词 + 原文 + 与原文长度相当的译文。
+    int cost = estimateSeriesTokens(text);
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        state->langIdx = m_config.language;
+        cost += int(m_config.system_prompt.toUtf8().size() / 3);
+    }
+    m_scheduler.submit(
+        priority, generateClientId(clientIP.toStdString()), cost, [this, state, ticket](const TranslationScheduler::Ticket &started)
+        {
+        *ticket = started;
+        if (started.abandoned)
+        {
+            m_abandonedQueued++;
+            m_abandonedTokens += quint64(started.cost);
+            state->done("", false, false);
+            return;
+        }
+        m_retryPolicy.recordFirstAttempt();
+        runRetryAttempt(state); },
+        abandoned);
+}
+
+/**
+ * Start the next attempt of a retry series; the backoff runs as a timer on the network thread.
+ * The delay depends on why the attempt failed (see RetryPolicy), and every retry needs room
+ * in the global retry budget.
+ * 开始重试序列的下一次尝试；退避以网络线程上的定时器实现。延迟取决于尝试失败的原因
+ * （见 RetryPolicy），且每次重试都需要全局重试预算中有余额。
+ */
+void TranslationServer::runRetryAttempt(const std::shared_ptr<RetryState> &state)
+{
+    if (m_stopRequested)
+    {
+        emit logMessage(SV_ABORTED[state->langIdx]);
+        state->done("", false, false);
+        return;
+    }
+
+    // A retry nobody waits for is not sent ; 没有人等待的重试不再发送
+    if (state->retryCount > 0 && state->abandoned && state->abandoned())
+    {
+        m_abandonedRunning++;
+        m_abandonedTokens += estimateSeriesTokens(state->text);
+        state->done("", false, false);
+        return;
+    }
+
+    performSingleTranslationAttempt(
+        state->text, state->clientIP, [this, state](const QString &attemptResult, bool rejected, const AttemptFailure &failure, bool cacheable)
+        {
+        if (m_stopRequested)
+        {
+            state->done("", false, false);
+            return;
+        }
+        if (rejected)
+            state->rejectedCount++;
+        if (isValidTranslationResult(attemptResult))
+        {
+            if (state->retryCount > 0)
+                emit logMessage(SV_RETRY_SUCCESS[state->langIdx]);
+            state->done(attemptResult, false, cacheable);
+            return;
+        }
+        // Not a failure of the text: its clients left ; 不是文本本身的失败：其客户端已离开
+        if (state->abandoned && state->abandoned())
+        {
+            state->done("", false, false);
+            return;
+        }
+
+        state->retryCount++;
+        if (state->retryCount >= state->maxAttempts)
+        {
+            emit logMessage(SV_RETRY_FAILED[state->langIdx]);
+            // Network errors and timeouts say nothing about the text itself; only refusals count.
+            // 网络错误与超时与文本本身无关；只有被拒绝的结果才计入。
+            state->done("", state->rejectedCount == state->retryCount, false);
+            return;
+        }
+
+        const int delayMs = RetryPolicy::nextDelayMs(failure, state->retryCount);
+        if (delayMs < 0)
+        {
+            state->done("", false, false);
+            return;
+        }
+        if (!m_retryPolicy.tryRetry())
+        {
+            // Not every attempt was made, so the text is not quarantined.
+            // 并未尝试完所有次数，因此不隔离该文本。
+            emit logMessage(SV_RETRY_BUDGET[state->langIdx]);
+            state->done("", false, false);
+            return;
+        }
+
+        emit logMessage(QString(SV_RETRY_ATTEMPT[state->langIdx]).arg(state->retryCount + 1).arg(state->maxAttempts) +
+                        QString(SV_RETRY_DELAY[state->langIdx]).arg(delayMs));
+        m_upstream.schedule(delayMs, [this, state]()
+                            { runRetryAttempt(state); }); },
+        state->abandoned, state->hint, state->numbered);
+}
+
+/**
+ * Fingerprint of the configuration that influences a translation (computed by updateConfig).
+ * 影响翻译结果的配置指纹（由 updateConfig 计算）。
+ *
+ * Two requests with the same text but different model or prompts must not be merged, and
+ * their cache entries live in different scopes.
+ * 文本相同但模型或提示词不同的请求不能合并，其缓存条目也位于不同的作用域。
+ *
+ * @return First 16 hex characters of the MD5 over the relevant fields.
+ */
+QString TranslationServer::configFingerprint()
+{
+    std::lock_guard<std::mutex> lock(m_configMutex);
+    return m_fingerprint;
+}
+
+/**
+ * Recompute the fingerprint from model, prompts, temperature and the glossary switch.
+ * 根据模型、提示词、温度和术语表开关重新计算指纹。
+ *
+ * Must be called with m_configMutex held.
+ * 调用时必须持有 m_configMutex。
+ */
+void TranslationServer::refreshFingerprintLocked()
+{
+    // Glossary contents are not part of it: term changes invalidate only the affected entries.
+    // 术语表内容不参与指纹：术语变更只会使受影响的条目失效。
+    QString glossary = m_config.enable_glossary ? "g" : "-";
+    QByteArray material = (m_config.model_name + QChar(0x1F) +
+                           m_config.system_prompt + QChar(0x1F) +
+                           m_config.pre_prompt + QChar(0x1F) +
+                           QString::number(m_config.temperature) + QChar(0x1F) +
+                           glossary)
+                              .toUtf8();
+    m_fingerprint = QCryptographicHash::hash(material, QCryptographicHash::Md5).toHex().left(16);
 }
 
 /**
@@ -568,17 +2272,265 @@ bool TranslationServer::isValidTranslationResult(const QString &result)
 }
 
 /**
- * Perform a single translation attempt (no retry).
- * 执行单次翻译尝试（无重试）。
+ * Incremental parser for an OpenAI-style SSE stream ("data: {...}" events).
+ * OpenAI 风格 SSE 流（"data: {...}" 事件）的增量解析器。
+ *
+ * It decides when the translation is complete, so the rest of the generation (commentary,
+ * extra lines) is never waited for, and it bounds runaway outputs, reasoning included.
+ * 它判断译文何时已经完整，从而不必等待其余生成内容（解释、多余的行），并限制包括推理内容在内的失控输出。
+ */
+struct StreamState
+{
+    QByteArray pending;        ///< Incomplete SSE line ; 未完整的 SSE 行
+    QString content;           ///< Concatenated content deltas ; 拼接后的正文增量
+    qint64 reasoningChars = 0; ///< Streamed reasoning, discarded ; 流式推理内容（丢弃）
+    int deltas = 0;            ///< Content/reasoning chunks, about one token each ; 正文/推理分块数，约等于 token 数
+    qint64 firstTokenMs = -1;
+    QElapsedTimer timer;
+    json usage;
+    int expectedLines = 1;     ///< Lines sent for translation ; 送去翻译的行数
+    bool extraction = false;   ///< Reply is wrapped in <tl>, terms follow as <tm> ; 译文包裹在 <tl> 中，术语以 <tm> 跟随
+    int maxChars = 16000;
+    bool overflow = false;
+    bool complete = false;
+
+    /**
+     * Consume body bytes. Returns false once reading can stop (complete or overflow).
+     * 处理响应体数据。可以停止读取时（已完整或溢出）返回 false。
+     */
+    bool feed(const QByteArray &chunk)
+    {
+        pending += chunk;
+        int newline;
+        while ((newline = pending.indexOf('\n')) >= 0)
+        {
+            QByteArray line = pending.left(newline).trimmed();
+            pending.remove(0, newline + 1);
+            if (!line.startsWith("data:"))
+                continue;
+            QByteArray data = line.mid(5).trimmed();
+            if (data == "[DONE]")
+                return true;
+
+            json event = json::parse(data.toStdString(), nullptr, false);
+            if (event.is_discarded())
+                continue;
+            if (event.contains("usage") && event["usage"].is_object())
+                usage = event["usage"];
+            if (!event.contains("choices") || !event["choices"].is_array() || event["choices"].empty())
+                continue;
+
+            const json delta = event["choices"][0].value("delta", json::object());
+            bool received = false;
+            if (delta.contains("content") && delta["content"].is_string())
+            {
+                content += QString::fromStdString(delta["content"].get<std::string>());
+                received = true;
+            }
+            for (const char *key : {"reasoning_content", "reasoning"})
+            {
+                if (delta.contains(key) && delta[key].is_string())
+                {
+                    reasoningChars += QString::fromStdString(delta[key].get<std::string>()).size();
+                    received = true;
+                }
+            }
+            if (!received)
+                continue;
+
+            deltas++;
+            if (firstTokenMs < 0)
+                firstTokenMs = timer.elapsed();
+            if (content.size() + reasoningChars > maxChars)
+            {
+                overflow = true;
+                return false;
+            }
+            if (checkComplete())
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * Whether the visible reply already holds the whole translation; if so, cut the rest.
+     * 可见回复是否已包含完整译文；若是，则截去其余部分。
+     */
+    bool checkComplete()
+    {
+        if (!content.contains("</tl>", Qt::CaseInsensitive) && content.count('\n') < expectedLines)
+            return false;
+
+        static const QRegularExpression thinkBlock("<think(?:ing)?>.*?</think(?:ing)?>",
+                                                   QRegularExpression::CaseInsensitiveOption | QRegularExpression::DotMatchesEverythingOption);
+        static const QRegularExpression openThink("<think(?:ing)?>", QRegularExpression::CaseInsensitiveOption);
+        QString visible = content;
+        visible.remove(thinkBlock);
+        if (visible.contains(openThink))
+            return false; // Still thinking ; 仍在思考
+
+        if (extraction)
+        {
+            // Complete after </tl> plus any <tm> terms; anything else that follows is chatter.
+            // 在 </tl> 及其后的 <tm> 术语之后即完整；之后的其他内容都是多余的。
+            int close = visible.indexOf("</tl>", 0, Qt::CaseInsensitive);
+            if (close < 0)
+                return false;
+            static const QRegularExpression termBlock("\\s*<tm>.*?</tm>", QRegularExpression::CaseInsensitiveOption | QRegularExpression::DotMatchesEverythingOption);
+            int pos = close + 5;
+            QRegularExpressionMatch m;
+            while ((m = termBlock.match(visible, pos, QRegularExpression::NormalMatch, QRegularExpression::AnchorAtOffsetMatchOption)).hasMatch())
+                pos = m.capturedEnd();
+            QString rest = visible.mid(pos).trimmed();
+            if (rest.isEmpty() || rest.startsWith("<tm", Qt::CaseInsensitive) || QString("<tm>").startsWith(rest, Qt::CaseInsensitive))
+                return false;
+            content = visible.left(pos);
+        }
+        else
+        {
+            // Complete once a line beyond the expected count starts.
+            // 一旦开始出现超出预期行数的新行即视为完整。
+            int pos = 0;
+            while (pos < visible.size() && visible[pos].isSpace())
+                pos++;
+            for (int i = 0; i < expectedLines; ++i)
+            {
+                pos = visible.indexOf('\n', pos);
+                if (pos < 0)
+                    return false;
+                pos++;
+            }
+            if (visible.mid(pos).trimmed().isEmpty())
+                return false;
+            content = visible.left(pos - 1);
+        }
+        complete = true;
+        return true;
+    }
+
+    /**
+     * The streamed reply in the shape of a non-streamed /chat/completions response.
+     * 将流式回复组装为非流式 /chat/completions 响应的形式。
+     */
+    json toResponse() const
+    {
+        json response;
+        response["choices"] = json::array({{{"message", {{"content", content.toStdString()}}}}});
+        if (usage.is_object())
+            response["usage"] = usage;
+        return response;
+    }
+};
+
+/**
+ * Everything a single attempt needs to turn the upstream reply into a translation.
+ * 单次尝试将上游响应转换为译文所需的全部信息。
+ */
+struct AttemptContext
+{
+    AppConfig cfg;
+    json payload; ///< Request without "model", which depends on the backend ; 不含 "model" 的请求体，模型取决于上游
+    EscapeMap escapes;
+    QString processedText;
+    std::string clientId;
+    QString userContent;
+    bool performExtraction = false;
+    std::shared_ptr<StreamState> stream; ///< Set when the reply is streamed ; 流式响应时设置
+    int estimatedTokens = 0;             ///< Charged to the key's token bucket ; 计入密钥 token 桶的预估值
+    BackendRoute route;                  ///< Backend and key the request was sent with ; 发送请求所用的上游与密钥
+    int outputTokens = 0;                ///< Expected reply length, for the latency model ; 预期响应长度，用于延迟模型
+    qint64 predictedMs = -1;             ///< Predicted duration, -1 if unknown ; 预测耗时，未知时为 -1
+    qint64 timeoutMs = 0;                ///< Deadline of the request ; 请求的超时时间
+    TranslationServer::AbandonedCheck abandoned; ///< True once nobody waits for the result ; 已经没有人等待结果时为 true
+    bool numbered = false;                       ///< Numbered lines of a micro-batch ; 合批的编号行
+};
+
+// Deadline used until a backend's latency model has seen enough requests.
+// 上游的延迟模型见到足够多的请求之前使用的超时时间。
+static const qint64 DEFAULT_TIMEOUT_MS = 40000;
+
+// How long an attempt may wait for a key with headroom before it fails like a network error.
+// 尝试等待有余量的密钥的最长时间，超过后按网络错误处理。
+static const qint64 KEY_QUEUE_MAX_MS = 5000;
+
+/**
+ * Milliseconds a Retry-After header asks for (delta-seconds or HTTP date), 0 if absent.
+ * Retry-After 响应头要求等待的毫秒数（秒数或 HTTP 日期），无则为 0。
+ */
+static qint64 retryAfterMs(const QByteArray &value)
+{
+    const QString text = QString::fromLatin1(value).trimmed();
+    if (text.isEmpty())
+        return 0;
+    bool ok = false;
+    const double seconds = text.toDouble(&ok);
+    if (ok)
+        return std::max<qint64>(qint64(seconds * 1000), 0);
+    const QDateTime when = QDateTime::fromString(text, Qt::RFC2822Date);
+    if (when.isValid())
+        return std::max<qint64>(QDateTime::currentDateTimeUtc().msecsTo(when), 0);
+    return 0;
+}
+
+/**
+ * Classify a reply for the health of the key it was sent with.
+ * 按所用密钥的健康度对响应分类。
+ */
+static KeyOutcome keyOutcomeOf(const UpstreamResponse &reply)
+{
+    if (reply.aborted)
+        return KeyOutcome::Cancelled;
+    if (reply.timedOut || reply.error == QNetworkReply::TimeoutError)
+        return KeyOutcome::Timeout;
+    if (reply.statusCode == 401 || reply.statusCode == 403)
+        return KeyOutcome::AuthError;
+    if (reply.statusCode == 429)
+        return KeyOutcome::RateLimited;
+    if (reply.statusCode >= 500)
+        return KeyOutcome::ServerError;
+    if (reply.error != QNetworkReply::NoError && reply.statusCode == 0)
+        return KeyOutcome::NetworkError;
+    return KeyOutcome::Success;
+}
+
+/**
+ * An attempt and its optional hedge; whichever answers validly first wins (network thread only
+ * once the attempt is sent).
+ * 一次尝试及其可选的对冲请求；先返回有效答案者胜出（发送后仅在网络线程访问）。
+ */
+struct HedgeRace
+{
+    TranslationServer::AttemptCallback done;
+    int outstanding = 0;
+    bool finished = false;
+    quint64 primaryId = 0;
+    quint64 hedgeId = 0;
+    bool abandoned = false; ///< Cancelled because every waiter gave up ; 因所有等待者都已放弃而取消
+};
+
+/**
+ * Perform a single translation attempt (no retry). The request is sent asynchronously.
+ * 执行单次翻译尝试（无重试）。请求以异步方式发送。
  * 
- * @param text      Input text.
- * @param clientIP  Client IP.
- * @return Translated text, or empty string on failure.
+ * @param text     Input text.
+ * @param clientIP Client IP.
+ * @param done     Receives the translation (empty on failure), whether the upstream answered
+ *                 but the result was refused or invalid, why it failed, and whether the backend
+ *                 that answered runs the primary model; runs on the network thread.
+ * @param abandoned True once nobody waits for the result; the request is then cancelled. May be empty.
+ * @param hint     Context hint added to the system prompt, or empty.
+ * @param numbered True for the numbered lines ("#n: ") of a micro-batch.
  */
-QString TranslationServer::performSingleTranslationAttempt(const QString &text, const QString &clientIP)
+void TranslationServer::performSingleTranslationAttempt(const QString &text, const QString &clientIP, AttemptCallback done, AbandonedCheck abandoned, const QString &hint,
+                                                        bool numbered)
 {
+    AttemptFailure cancelled;
+    cancelled.kind = KeyOutcome::Cancelled;
     if (m_stopRequested)
-        return "";
+    {
+        done("", false, cancelled, false);
+        return;
+    }
 
     AppConfig cfg;
     {
@@ -586,11 +2538,11 @@ QString TranslationServer::performSingleTranslationAttempt(const QString &text,
         cfg = m_config;
     }
 
-    QString apiKey = getNextApiKey();
-    if (apiKey.isEmpty())
+    if (m_router.isEmpty())
     {
         emit logMessage("❌ " + QString(SV_ERR_KEY[cfg.language]));
-        return "";
+        done("", false, cancelled, false);
+        return;
     }
 
     EscapeMap escapeCtx;
@@ -607,7 +2559,7 @@ QString TranslationServer::performSingleTranslationAttempt(const QString &text,
     bool performExtraction = false;
 
     finalSystemPrompt += "\n\n【Translation Rules (CRITICAL)】:\n"
-                         "1. 🛑 PRESERVE TAGS: Keep tags like '[T_0]' EXACTLY as is.\n"
+                         "1. 🛑 PRESERVE TAGS: Keep tags like '[T_0]' and '[N_0]' EXACTLY as is.\n"
                          "2. 🛑 PRESERVE NEWLINES: Keep '[LF]' EXACTLY as is. It represents a line break in dialogs.\n"
                          "   - Input: \"A:[LF]Hello\"\n"
                          "   - Output: \"A:[LF]你好\"\n"
@@ -619,6 +2571,16 @@ QString TranslationServer::performSingleTranslationAttempt(const QString &text,
                          "   - If input is a single word like \"CAMPAIGN\", output ONLY the noun \"活动\" or \"战役\". NEVER append context.\n"
                          "5. Output ONLY the translated result.\n";
 
+    // Micro-batches are sent as "#1: ...\n#2: ..." and split by number.
+    // 合批以 "#1: ...\n#2: ..." 形式发送，并按编号拆分。
+    if (numbered)
+        finalSystemPrompt += "6. 🔢 NUMBERED LINES: Each input line starts with '#n: '. Translate every line on its own and "
+                             "output exactly one line per input line, keeping its '#n: ' prefix.\n";
+
+    if (!hint.isEmpty())
+        finalSystemPrompt += "\n【Context】: " + hint + "\n"
+                             "Use it only to choose the right meaning and tone. Do NOT translate or output it.\n";
+
     if (cfg.enable_glossary)
     {
         QString glossaryContext = GlossaryManager::instance().getContextPrompt(processedText);
@@ -655,66 +2617,327 @@ QString TranslationServer::performSingleTranslationAttempt(const QString &text,
     messages.push_back({{"role", "user"}, {"content", currentUserContent.toStdString()}});
 
     json payload;
-    payload["model"] = cfg.model_name.toStdString();
     payload["messages"] = messages;
     payload["temperature"] = cfg.temperature;
+    if (cfg.enable_streaming)
+    {
+        payload["stream"] = true;
+        payload["stream_options"] = {{"include_usage", true}};
+    }
 
-    QNetworkAccessManager manager;
-    QNetworkRequest request(QUrl(cfg.api_address + "/chat/completions"));
-    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    request.setRawHeader("Authorization", ("Bearer " + apiKey).toUtf8());
-    request.setTransferTimeout(45000);
+    auto ctx = std::make_shared<AttemptContext>();
+    ctx->cfg = cfg;
+    ctx->payload = std::move(payload);
+    ctx->escapes = escapeCtx;
+    ctx->processedText = processedText;
+    ctx->clientId = clientId;
+    ctx->userContent = currentUserContent;
+    ctx->performExtraction = performExtraction;
+    ctx->abandoned = std::move(abandoned);
+    ctx->numbered = numbered;
+
+    if (cfg.enable_streaming)
+    {
+        ctx->stream = std::make_shared<StreamState>();
+        ctx->stream->expectedLines = processedText.count('\n') + 1;
+        ctx->stream->extraction = performExtraction;
+        ctx->stream->maxChars = cfg.stream_max_chars;
+    }
+
+    // UTF-8 averages about 3 bytes per token across English and CJK text; the reply is
+    // assumed to be about as long as the source. Corrected from "usage" once it arrives.
+    // UTF-8 文本在中英文间平均约 3 字节一个 token；假定译文与原文长度相当。收到 "usage" 后再修正。
+    ctx->outputTokens = int(processedText.toUtf8().size() / 3) + 1;
+    ctx->estimatedTokens = int(ctx->payload.dump().size() / 3) + ctx->outputTokens;
+
+    dispatchAttempt(ctx, done, 0);
+}
 
-    QNetworkReply *reply = manager.post(request, QByteArray::fromStdString(payload.dump()));
+/**
+ * Send an attempt to the backend the router picks, with its API key that has the most
+ * headroom. While every key is at its rate limit, the attempt waits on a timer (not a thread)
+ * for up to KEY_QUEUE_MAX_MS.
+ * 发送尝试到路由器选定的上游，并使用该上游余量最多的 API 密钥。所有密钥都达到速率上限时，
+ * 尝试通过定时器（而非线程）等待，最长 KEY_QUEUE_MAX_MS。
+ */
+void TranslationServer::dispatchAttempt(std::shared_ptr<AttemptContext> ctx, AttemptCallback done, qint64 queuedMs)
+{
+    AttemptFailure failure;
+    if (m_stopRequested || (ctx->abandoned && ctx->abandoned()))
+    {
+        failure.kind = KeyOutcome::Cancelled;
+        done("", false, failure, false);
+        return;
+    }
+
+    const AppConfig &cfg = ctx->cfg;
+    qint64 waitMs = 0;
+    if (!m_router.acquire(ctx->estimatedTokens, ctx->route, waitMs))
+    {
+        // Don't wait for a key that won't free up in time (open circuit, empty TPM bucket).
+        // 不等待来不及恢复的密钥（熔断打开、TPM 桶耗尽）。
+        if (waitMs > 0 && waitMs <= KEY_QUEUE_MAX_MS - queuedMs)
+        {
+            const int delay = int(std::max<qint64>(waitMs, 10));
+            if (cfg.enable_debug_mode && queuedMs == 0)
+                emit logMessage(QString(SV_KEY_QUEUED[cfg.language]).arg(waitMs));
+            m_upstream.schedule(delay, [this, ctx, done, queuedMs, delay]()
+                                { dispatchAttempt(ctx, done, queuedMs + delay); });
+            return;
+        }
+        emit logMessage(waitMs > 0 ? QString(SV_KEY_SATURATED[cfg.language]) : "❌ " + QString(SV_ERR_KEY[cfg.language]));
+        // The retry waits for the key selector instead of trying again at once.
+        // 重试会等待密钥选择器，而不是立即再试。
+        failure.kind = (waitMs > 0) ? KeyOutcome::RateLimited : KeyOutcome::Cancelled;
+        failure.retryAfterMs = waitMs;
+        failure.keyUnavailable = true;
+        done("", false, failure, false);
+        return;
+    }
 
-    QEventLoop loop;
-    QTimer checkTimer;
-    checkTimer.setInterval(100);
+    auto race = std::make_shared<HedgeRace>();
+    race->done = std::move(done);
+    race->primaryId = postAttempt(ctx, race, false);
+    if (ctx->abandoned)
+        m_upstream.schedule(int(RequestLifetime::PROBE_INTERVAL_MS), [this, ctx, race]()
+                            { watchAbandonment(ctx, race); });
 
-    QObject::connect(&checkTimer, &QTimer::timeout, [&]()
-                     {
-        if (m_stopRequested) { reply->abort(); loop.quit(); } });
-    checkTimer.start();
+    if (!cfg.enable_hedging)
+        return;
+    m_hedger.recordAttempt();
+    const qint64 triggerMs = m_hedger.triggerMs();
+    if (triggerMs < 0)
+        return;
+    // Scheduled after primaryId is set, so the timer sees it ; 在设置 primaryId 之后调度，定时器可以看到它
+    m_upstream.schedule(int(triggerMs), [this, ctx, race, triggerMs]()
+                        { sendHedge(ctx, race, triggerMs); });
+}
 
-    QTimer timeoutTimer;
-    timeoutTimer.setSingleShot(true);
-    QObject::connect(&timeoutTimer, &QTimer::timeout, &loop, &QEventLoop::quit);
-    QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
+/**
+ * Send the hedge of an attempt that is still running, preferably on another backend, else on
+ * another key. A single key is reused, since a slow reply is usually not the key's fault.
+ * 为仍在进行的尝试发送对冲请求，优先使用其他上游，其次是其他密钥。只有一个密钥时沿用该密钥，
+ * 因为响应缓慢通常与密钥无关。
+ */
+void TranslationServer::sendHedge(std::shared_ptr<AttemptContext> ctx, std::shared_ptr<HedgeRace> race, qint64 triggerMs)
+{
+    if (race->finished || race->abandoned || m_stopRequested || !m_hedger.tryHedge())
+        return;
 
-    timeoutTimer.start(40000);
-    loop.exec();
+    qint64 waitMs = 0;
+    BackendRoute route;
+    if (!m_router.acquire(ctx->estimatedTokens, route, waitMs, ctx->route) &&
+        !m_router.acquire(ctx->estimatedTokens, route, waitMs))
+    {
+        m_hedger.refund();
+        return;
+    }
+
+    auto hedgeCtx = std::make_shared<AttemptContext>(*ctx);
+    hedgeCtx->route = route;
+    if (ctx->stream)
+    {
+        hedgeCtx->stream = std::make_shared<StreamState>();
+        hedgeCtx->stream->expectedLines = ctx->stream->expectedLines;
+        hedgeCtx->stream->extraction = ctx->stream->extraction;
+        hedgeCtx->stream->maxChars = ctx->stream->maxChars;
+    }
+    race->hedgeId = postAttempt(hedgeCtx, race, true);
+    if (ctx->cfg.enable_debug_mode)
+        emit logMessage(QString(SV_HEDGE_SENT[ctx->cfg.language]).arg(triggerMs) + ctx->processedText.left(50));
+}
+
+/**
+ * Poll the waiters of an attempt while it runs, and cancel its requests (primary and hedge)
+ * once every waiter has given up: a closed connection or a passed deadline stops the
+ * generation instead of paying for a reply nobody reads.
+ * 在尝试进行期间轮询其等待者，所有等待者都放弃后取消其请求（主请求与对冲请求）：连接关闭或
+ * 截止时间已过会停止生成，而不是为没人读取的回复付费。
+ */
+void TranslationServer::watchAbandonment(std::shared_ptr<AttemptContext> ctx, std::shared_ptr<HedgeRace> race)
+{
+    if (race->finished || m_stopRequested)
+        return;
+    if (!ctx->abandoned())
+    {
+        m_upstream.schedule(int(RequestLifetime::PROBE_INTERVAL_MS), [this, ctx, race]()
+                            { watchAbandonment(ctx, race); });
+        return;
+    }
+
+    race->abandoned = true;
+    m_abandonedRunning++;
+    // The prompt has been read already; what is saved is the reply ; 提示词已被读取；节省的是回复部分
+    m_abandonedTokens += quint64(ctx->outputTokens);
+    if (ctx->cfg.enable_debug_mode)
+        emit logMessage(QString(SV_ABANDONED[ctx->cfg.language]) + ctx->processedText.left(50));
+    m_upstream.cancel(race->primaryId);
+    if (race->hedgeId != 0)
+        m_upstream.cancel(race->hedgeId);
+}
+
+/**
+ * Post one upstream request of an attempt. The first valid answer of the race completes the
+ * attempt and cancels the other request; if both fail, the last failure is reported.
+ * 发送尝试中的一个上游请求。竞争中第一个有效答案完成该尝试并取消另一个请求；
+ * 两者都失败时，报告最后一次失败。
+ */
+quint64 TranslationServer::postAttempt(std::shared_ptr<AttemptContext> ctx, std::shared_ptr<HedgeRace> race, bool hedge)
+{
+    json payload = ctx->payload;
+    payload["model"] = ctx->route.model.toStdString();
+    const QByteArray body = QByteArray::fromStdString(payload.dump());
+
+    // The deadline follows the backend's latency for a reply of this length: a short label no
+    // longer holds a request for 40 s, and a long block gets the time it needs.
+    // 超时时间跟随该上游对此长度响应的延迟：短标签不再占用请求 40 秒，长文本块也能得到所需时间。
+    const AppConfig &cfg = ctx->cfg;
+    qint64 spreadMs = 0;
+    qint64 timeoutMs = DEFAULT_TIMEOUT_MS;
+    ctx->predictedMs = -1;
+    if (m_router.predictLatency(ctx->route, ctx->outputTokens, ctx->predictedMs, spreadMs))
+        timeoutMs = std::max(2 * ctx->predictedMs, ctx->predictedMs + 4 * spreadMs);
+    ctx->timeoutMs = std::clamp<qint64>(timeoutMs, cfg.timeout_floor_ms, std::max(cfg.timeout_floor_ms, cfg.timeout_ceiling_ms));
+
+    QNetworkRequest request(QUrl(ctx->route.address + "/chat/completions"));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    request.setRawHeader("Authorization", ("Bearer " + ctx->route.apiKey).toUtf8());
+    request.setTransferTimeout(int(ctx->timeoutMs) + 5000);
+
+    UpstreamClient::StreamHandler onData;
+    if (ctx->stream)
+    {
+        ctx->stream->timer.start();
+        onData = [stream = ctx->stream](const QByteArray &chunk)
+        { return stream->feed(chunk); };
+    }
+
+    race->outstanding++;
+    return m_upstream.postAsync(
+        request, body, int(ctx->timeoutMs), [this, ctx, race, hedge](const UpstreamResponse &reply)
+        {
+        bool rejected = false;
+        QString result = parseTranslationReply(reply, *ctx, &rejected);
+        if (reply.error == QNetworkReply::NoError && !reply.stoppedEarly)
+        {
+            m_hedger.recordLatency(reply.elapsedMs);
+            m_router.recordLatency(ctx->route, ctx->outputTokens, reply.elapsedMs);
+        }
+        else if (reply.timedOut)
+        {
+            // A lower bound, but it keeps a model that guessed too short from timing out forever.
+            // 只是下限，但可以避免预测过短的模型一直超时。
+            m_router.recordLatency(ctx->route, ctx->outputTokens, reply.elapsedMs);
+        }
+        race->outstanding--;
+        if (race->finished)
+            return;
+
+        const bool valid = isValidTranslationResult(result);
+        if (!valid && race->outstanding > 0)
+            return;
+        race->finished = true;
+        if (valid && race->hedgeId != 0)
+        {
+            if (hedge)
+                m_hedger.recordWin();
+            m_upstream.cancel(hedge ? race->primaryId : race->hedgeId);
+        }
+        AttemptFailure failure;
+        failure.kind = keyOutcomeOf(reply);
+        failure.retryAfterMs = retryAfterMs(reply.retryAfter);
+        // The cache scope is fingerprinted from the primary model only.
+        // 缓存作用域的指纹只包含主模型。
+        race->done(result, rejected, failure, ctx->route.model == ctx->cfg.model_name); },
+        onData);
+}
+
+/**
+ * Turn an upstream reply into a translation: strip thinking and markup, learn new terms,
+ * restore escapes and update the client context.
+ * 将上游响应转换为译文：清理思考内容与标记、学习新术语、恢复转义并更新客户端上下文。
+ *
+ * @param reply           Upstream reply.
+ * @param ctx             State captured when the request was built.
+ * @param contentRejected Set when the upstream answered but the result was refused or invalid.
+ * @return Translated text, or empty string on failure.
+ */
+QString TranslationServer::parseTranslationReply(const UpstreamResponse &reply, const AttemptContext &ctx, bool *contentRejected)
+{
+    const AppConfig &cfg = ctx.cfg;
+    const EscapeMap &escapeCtx = ctx.escapes;
+    const QString &processedText = ctx.processedText;
+    const std::string &clientId = ctx.clientId;
+    const QString &currentUserContent = ctx.userContent;
+    const bool performExtraction = ctx.performExtraction;
+    const bool numbered = ctx.numbered;
 
     QString resultText = "";
 
-    if (m_stopRequested)
+    const KeyOutcome outcome = keyOutcomeOf(reply);
+    const BackendRouter::Verdict verdict = m_router.report(ctx.route, outcome, reply.elapsedMs, retryAfterMs(reply.retryAfter));
+    const QString maskedKey = KeyRateLimiter::maskKey(ctx.route.apiKey);
+    if (outcome == KeyOutcome::RateLimited)
+        emit logMessage(QString(SV_KEY_THROTTLED[cfg.language]).arg(maskedKey).arg(verdict.key.pauseMs));
+    if (verdict.key.circuitOpened)
+        emit logMessage(QString(SV_KEY_CIRCUIT_OPEN[cfg.language]).arg(maskedKey).arg(reply.statusCode).arg(verdict.key.openForMs / 1000));
+    if (verdict.key.circuitClosed)
+        emit logMessage(QString(SV_KEY_CIRCUIT_CLOSED[cfg.language]).arg(maskedKey));
+    if (verdict.degraded)
+        emit logMessage(QString(SV_BACKEND_DOWN[cfg.language]).arg(ctx.route.address).arg(QString::number(verdict.errorRate * 100.0, 'f', 0)).arg(verdict.downForMs / 1000));
+    if (verdict.recovered)
+        emit logMessage(QString(SV_BACKEND_UP[cfg.language]).arg(ctx.route.address));
+
+    if (reply.aborted || m_stopRequested)
+        return "";
+
+    if (reply.timedOut)
     {
-        reply->deleteLater();
+        if (ctx.predictedMs >= 0)
+            emit logMessage(QString(SV_TIMEOUT[cfg.language]).arg(reply.elapsedMs).arg(ctx.predictedMs).arg(ctx.outputTokens).arg(ctx.route.address) + processedText.left(50));
+        else
+            emit logMessage(QString(SV_TIMEOUT_UNPREDICTED[cfg.language]).arg(reply.elapsedMs).arg(ctx.route.address) + processedText.left(50));
         return "";
     }
 
-    if (!timeoutTimer.isActive())
+    if (cfg.enable_debug_mode && reply.newConnection)
+    {
+        UpstreamClient::Stats upstream = m_upstream.stats();
+        const quint64 reused = upstream.requests - std::min(upstream.newConnections, upstream.requests);
+        emit logMessage(QString(SV_UPSTREAM_CONNECT[cfg.language])
+                            .arg(reply.handshakeMs)
+                            .arg(QString::number(upstream.requests > 0 ? 100.0 * reused / upstream.requests : 0.0, 'f', 1)));
+    }
+
+    const StreamState *stream = (ctx.stream && ctx.stream->deltas > 0) ? ctx.stream.get() : nullptr;
+    if (stream && stream->overflow)
     {
-        emit logMessage("❌ Request Timeout");
-        reply->abort();
-        reply->deleteLater();
+        emit logMessage(QString(SV_STREAM_OVERFLOW[cfg.language]).arg(stream->content.size() + stream->reasoningChars) + processedText.left(50));
+        if (contentRejected)
+            *contentRejected = true;
         return "";
     }
-    timeoutTimer.stop();
-    checkTimer.stop();
+    if (stream)
+        recordStreamMetrics(*stream, reply, cfg);
 
-    if (reply->error() == QNetworkReply::NoError)
+    if (reply.error == QNetworkReply::NoError)
     {
-        QByteArray responseBytes = reply->readAll();
+        QByteArray responseBytes = reply.body;
         try
         {
-            json response = json::parse(responseBytes.toStdString());
+            // A server that ignores "stream" answers with a plain body, parsed as before.
+            // 忽略 "stream" 的服务器会返回普通响应体，按原方式解析。
+            json response = stream ? stream->toResponse() : json::parse(responseBytes.toStdString());
 
             if (response.contains("usage"))
             {
                 int p = response["usage"].value("prompt_tokens", 0);
                 int c = response["usage"].value("completion_tokens", 0);
                 if (p > 0 || c > 0)
+                {
                     emit tokenUsageReceived(p, c);
+                    m_router.settle(ctx.route, ctx.estimatedTokens, p + c);
+                }
             }
 
             if (response.contains("choices") && !response["choices"].empty())
@@ -734,7 +2957,7 @@ QString TranslationServer::performSingleTranslationAttempt(const QString &text,
                 if (performExtraction)
                 {
                     QRegularExpression reTm("<tm>\\s*(.*?)\\s*=\\s*(.*?)\\s*</tm>", QRegularExpression::DotMatchesEverythingOption);
-                    QRegularExpression tokenRegex(R"(\[T_\d+\])");
+                    QRegularExpression tokenRegex(R"(\[[TN]_\d+\])");
                     QRegularExpression lfRegex(R"(\[LF\])");
                     QRegularExpression termCodeRegex("Z[A-Z]{2}Z");
 
@@ -762,7 +2985,9 @@ QString TranslationServer::performSingleTranslationAttempt(const QString &text,
 
                         if (isValidTerm && processedText.contains(k, Qt::CaseInsensitive))
                         {
-                            GlossaryManager::instance().addNewTerm(k, v);
+                            // Appends to the glossary file ; 追加写入术语表文件
+                            queueWrite([k, v]()
+                                       { GlossaryManager::instance().addNewTerm(k, v); });
                             emit logMessage(QString(SV_NEW_TERM[cfg.language]) + k + " = " + v);
                         }
                         reconstructionBuffer.append(v);
@@ -794,23 +3019,32 @@ QString TranslationServer::performSingleTranslationAttempt(const QString &text,
                     resultText = RegexManager::instance().processPost(resultText);
                 }
 
+                // A micro-batch is several unrelated lines, not one exchange of the conversation.
+                // 合批是多条互不相关的行，而不是对话中的一轮。
                 if (isValidTranslationResult(resultText))
                 {
-                    std::lock_guard<std::mutex> lock(m_contextMutex);
-                    Context &ctx = m_contexts[clientId];
-                    ctx.history.push_back({currentUserContent, resultText});
-                    while (ctx.history.size() > ctx.max_len)
-                        ctx.history.pop_front();
+                    if (!numbered)
+                    {
+                        std::lock_guard<std::mutex> lock(m_contextMutex);
+                        Context &ctx = m_contexts[clientId];
+                        ctx.history.push_back({currentUserContent, resultText});
+                        while (ctx.history.size() > ctx.max_len)
+                            ctx.history.pop_front();
+                    }
                 }
                 else
                 {
                     resultText = "";
+                    if (contentRejected)
+                        *contentRejected = true;
                 }
             }
             else
             {
                 emit logMessage("❌ " + QString(SV_ERR_FMT[cfg.language]));
                 resultText = "";
+                if (contentRejected)
+                    *contentRejected = true;
             }
         }
         catch (...)
@@ -821,28 +3055,38 @@ QString TranslationServer::performSingleTranslationAttempt(const QString &text,
     }
     else
     {
-        emit logMessage("❌ Network Error: " + reply->errorString());
+        emit logMessage("❌ Network Error: " + reply.errorString);
         resultText = "";
     }
 
-    reply->deleteLater();
     return resultText;
 }
 
 /**
- * Get the next API key in round‑robin fashion.
- * 以轮询方式获取下一个 API 密钥。
- * 
- * @return Next API key, or empty string if none.
+ * Record time-to-first-token and throughput of a streamed reply.
+ * 记录流式响应的首个 token 耗时与吞吐量。
  */
-QString TranslationServer::getNextApiKey()
+void TranslationServer::recordStreamMetrics(const StreamState &stream, const UpstreamResponse &reply, const AppConfig &cfg)
 {
-    std::lock_guard<std::mutex> lock(m_keyMutex);
-    if (m_apiKeys.empty())
-        return "";
-    QString key = m_apiKeys[m_currentKeyIndex];
-    m_currentKeyIndex = (m_currentKeyIndex + 1) % m_apiKeys.size();
-    return key;
+    m_streamCount++;
+    m_streamTtftTotalMs += stream.firstTokenMs;
+    if (reply.stoppedEarly)
+        m_streamEarlyStops++;
+
+    if (!cfg.enable_debug_mode)
+        return;
+    int tokens = stream.deltas;
+    if (stream.usage.is_object())
+        tokens = stream.usage.value("completion_tokens", tokens);
+    const qint64 generationMs = std::max<qint64>(reply.elapsedMs - stream.firstTokenMs, 1);
+    QString msg = QString(SV_STREAM_STATS[cfg.language])
+                      .arg(stream.firstTokenMs)
+                      .arg(tokens)
+                      .arg(reply.elapsedMs)
+                      .arg(QString::number(tokens * 1000.0 / generationMs, 'f', 1));
+    if (reply.stoppedEarly)
+        msg += SV_STREAM_EARLY[cfg.language];
+    emit logMessage(msg);
 }
 
 /**
@@ -874,4 +3118,26 @@ void TranslationServer::clearAllContexts()
     }
     QString msg = (langIdx == 0) ? "🧹 Context memory cleared." : "🧹 上下文记忆已清空。";
     LOG(msg);
+}
+
+/**
+ * Log translation memory statistics: entries, hit ratio, hot-layer memory and evictions.
+ * 输出翻译记忆统计：条目数、命中率、热点层内存与淘汰数。
+ */
+void TranslationServer::logCacheStats()
+{
+    int lang = 1;
+    {
+        std::lock_guard<std::mutex> lock(m_configMutex);
+        lang = m_config.language;
+    }
+    TranslationCache &cache = TranslationCache::instance();
+    emit logMessage(QString(SV_CACHE_STATS[lang])
+                        .arg(cache.size())
+                        .arg(cache.hitCount())
+                        .arg(cache.missCount())
+                        .arg(cache.hitRatio(), 0, 'f', 1)
+                        .arg(cache.residentBytes() / (1024.0 * 1024.0), 0, 'f', 1)
+                        .arg(cache.budgetBytes() / (1024 * 1024))
+                        .arg(cache.evictionCount()));
 }
\ No newline at end of file
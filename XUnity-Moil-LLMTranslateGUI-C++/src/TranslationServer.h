@@ -9,7 +9,20 @@
 #include <mutex>
 #include <map>
 #include <atomic> 
+#include <future>
+#include <condition_variable>
+#include <functional>
+#include <memory>
 #include "ConfigManager.h"
+#include "GlossaryManager.h"
+#include "GlossaryIndex.h"
+#include "UpstreamClient.h"
+#include "BackendRouter.h"
+#include "RetryPolicy.h"
+#include "HedgePolicy.h"
+#include "AdmissionController.h"
+#include "TranslationScheduler.h"
+#include "RequestLifetime.h"
 #include "httplib.h"
 
 
@@ -22,6 +35,50 @@ struct Context {
     int max_len; // 最大历史记录数 / Maximum history records count
 };
 
+/**
+ * 等待合批的单行请求 / A single-line request waiting in a micro-batch
+ */
+struct MicroBatchItem {
+    QString text; // 原文 / Source text
+    int maxAttempts = 5; // 单独回退时的最大尝试次数 / Attempts if it falls back to its own request
+    PriorityClass priority = PriorityClass::Dialogue; // 调度等级 / Scheduling class
+    std::function<void(const QString&, bool, bool)> done; // 与 performTranslationWithRetry 相同的回调 / Same callback as performTranslationWithRetry
+    std::function<bool()> abandoned; // 等待者是否都已放弃（可为空）/ Whether every waiter has given up (may be empty)
+};
+
+/**
+ * 批量接口中的一项 / One item of the batch API
+ */
+struct BatchItem {
+    QString text; // 原文（可含换行）/ Source text (may contain newlines)
+    QString hint; // 上下文提示（可为空）/ Context hint (may be empty)
+};
+
+/**
+ * 批量接口中一项的结果 / Result of one batch API item
+ */
+struct BatchItemResult {
+    QString translation; // 译文，失败时为空 / Translation, empty on failure
+    QString error;       // 失败原因 / Why it failed
+};
+
+/**
+ * 进行中的上游请求及其等待者 / An in-flight upstream request and the requests waiting for it
+ */
+struct InFlightRequest {
+    std::vector<std::function<void(const QString&)>> followers; // 等待结果的跟随者 / Followers waiting for the result
+    std::vector<std::shared_ptr<RequestLifetime>> waiters; // 领导者与跟随者的客户端（空表示后台工作）/ Clients of the leader and followers (null for background work)
+};
+
+/**
+ * 同一客户端、同一配置下正在收集的合批 / Micro-batch being collected for one client and config
+ */
+struct PendingMicroBatch {
+    quint64 id = 0; // 批次编号（定时器据此识别）/ Batch id (recognised by its timer)
+    QString clientIP;
+    std::vector<MicroBatchItem> items;
+};
+
 /**
  * 翻译服务器类 - Translation Server Class
  * 
@@ -32,6 +89,11 @@ class TranslationServer : public QObject {
     Q_OBJECT
     
 public:
+    // cacheable: 译文来自主模型，可写入当前作用域 / The result came from the primary model and may be stored in the current scope
+    using TranslationCallback = std::function<void(const QString& result, bool cacheable)>;      // 翻译完成回调 / Translation completion callback
+    using RetryCallback = std::function<void(const QString& result, bool contentRejected, bool cacheable)>; // 重试序列完成回调 / Retry series completion callback
+    using AttemptCallback = std::function<void(const QString& result, bool contentRejected, const AttemptFailure& failure, bool cacheable)>; // 单次尝试完成回调 / Single attempt completion callback
+    using AbandonedCheck = std::function<bool()>;                                                 // 等待者是否都已放弃 / Whether every waiter has given up
 
     // 依然保留这个便捷函数，内部会触发 logMessage 信号
     // 构造函数中的 connect 会将其路由到 LogManager
@@ -68,6 +130,24 @@ public:
      * 清除所有客户端上下文 / Clear all client contexts
      */
     void clearAllContexts();
+
+    /**
+     * 输出缓存统计（命中率、内存占用、淘汰数）/ Log cache statistics (hit ratio, resident bytes, evictions)
+     */
+    void logCacheStats();
+
+    /**
+     * 密钥运行时健康状态（熔断状态、成功率、错误分类、延迟）/ Runtime health of a key (circuit state, success rate, error classes, latency)
+     * @param key 密钥（可带 "#rpm=" 后缀）/ Key (a "#rpm=" suffix is ignored)
+     * @param lang 界面语言 / UI language
+     * @return 描述文本，尚未使用过的密钥返回空 / Description, empty for a key not used yet
+     */
+    QString describeKeyHealth(const QString& key, int lang);
+
+    /**
+     * HTTP准入队列状态（排队数、处理中、拒绝数）/ HTTP admission state (queued, in service, rejected)
+     */
+    AdmissionController::Stats admissionStats() const { return m_admission.stats(); }
     
     /**
      * 检查服务器是否正在运行 / Check if server is running
@@ -117,20 +197,220 @@ private:
      * 运行服务器主循环 / Run server main loop
      */
     void runServerLoop();
+
+    /**
+     * 后台导入 XUnity 译文文件 / Import XUnity translation files in the background
+     * @param glossaryPath 术语表路径 / Glossary path
+     * @param lang 日志语言 / Log language
+     */
+    void runImport(const QString& glossaryPath, int lang);
+
+    /**
+     * 后台术语表维护：建立倒排索引并处理术语变更 / Background glossary maintenance: build the index, apply term changes
+     * @param glossaryPath 术语表路径 / Glossary path
+     * @param lang 日志语言 / Log language
+     */
+    void runGlossaryWorker(const QString& glossaryPath, int lang);
+
+    /**
+     * 使受术语变更影响的缓存条目失效 / Invalidate the cache entries affected by term changes
+     * @param changes 变更的术语 / Changed terms
+     * @param retranslate 是否加入后台重译队列 / Whether to queue them for background re-translation
+     * @param lang 日志语言 / Log language
+     */
+    void applyGlossaryChanges(const QList<GlossaryChange>& changes, bool retranslate, int lang);
+
+    /**
+     * 写入缓存并更新术语倒排索引（在写入线程上执行）/ Insert into the cache and the glossary index (on the writer thread)
+     */
+    void cacheTranslation(const QString& scope, const QString& source, const QString& translation);
+
+    /**
+     * 在写入线程上按顺序执行磁盘写入，写入线程未运行时就地执行 / Run a disk write in order on the writer thread, or right away when it is not running
+     * @param write 写入操作 / Write operation
+     */
+    void queueWrite(std::function<void()> write);
+
+    /**
+     * 写入线程主循环，停止前写完队列 / Writer thread loop; drains the queue before it stops
+     */
+    void runWriter();
+
+    /**
+     * 记录HTTP请求的到达时间与客户端截止时间 / Track when an HTTP request arrived and when its client stops waiting
+     * @param req HTTP请求（X-Client-Timeout-Ms 请求头优先于配置）/ HTTP request (the X-Client-Timeout-Ms header overrides the config)
+     * @return 请求生命周期，处理函数返回前需 release() / Request lifetime; release() it before the handler returns
+     */
+    std::shared_ptr<RequestLifetime> createLifetime(const httplib::Request& req);
     
     /**
-     * 执行翻译 / Perform translation
+     * 执行翻译并等待结果（阻塞入口）/ Perform translation and wait for the result (blocking edge)
      * @param text 要翻译的文本 / Text to translate
      * @param clientIP 客户端IP地址 / Client IP address
+     * @param useCache 是否读写翻译记忆 / Whether to read/write the translation memory
+     * @param origin 请求来源（决定调度优先级）/ Where the request came from (sets its scheduling priority)
+     * @param lifetime 客户端放弃时提前返回（可为空）/ Return early once the client gives up (may be null)
+     * @param cacheable 写入译文是否来自主模型（可为空）/ Receives whether the result came from the primary model (may be null)
      * @return 翻译结果 / Translation result
      */
-    QString performTranslation(const QString& text, const QString& clientIP);
+    QString performTranslation(const QString& text, const QString& clientIP, bool useCache = true, bool allowMicroBatch = false, RequestOrigin origin = RequestOrigin::Background,
+                               std::shared_ptr<RequestLifetime> lifetime = nullptr, bool* cacheable = nullptr);
+
+    /**
+     * 异步执行翻译 / Perform translation asynchronously
+     * @param text 要翻译的文本 / Text to translate
+     * @param clientIP 客户端IP地址 / Client IP address
+     * @param useCache 是否读写翻译记忆 / Whether to read/write the translation memory
+     * @param done 完成回调（恰好调用一次）/ Completion callback (called exactly once)
+     * @param allowMicroBatch 是否可与并发请求合批 / Whether it may be micro-batched with concurrent requests
+     * @param origin 请求来源 / Where the request came from
+     * @param lifetime 请求的客户端（可为空）/ Client of the request (may be null)
+     * @param hint 上下文提示，参与缓存作用域（可为空）/ Context hint, part of the cache scope (may be empty)
+     */
+    void performTranslationAsync(const QString& text, const QString& clientIP, bool useCache, TranslationCallback done, bool allowMicroBatch = false, RequestOrigin origin = RequestOrigin::Background,
+                                 std::shared_ptr<RequestLifetime> lifetime = nullptr, const QString& hint = QString());
+
+    /**
+     * 上游路径：隔离、单飞合并、带重试的请求 / Upstream path: quarantine, single-flight, request with retries
+     * @param text 要翻译的文本 / Text to translate
+     * @param clientIP 客户端IP地址 / Client IP address
+     * @param useCache 是否写入翻译记忆 / Whether to store the result in the translation memory
+     * @param scope 缓存作用域（配置指纹）/ Cache scope (config fingerprint)
+     * @param done 完成回调 / Completion callback
+     * @param allowMicroBatch 是否可与并发请求合批 / Whether it may be micro-batched with concurrent requests
+     * @param origin 请求来源 / Where the request came from
+     * @param lifetime 请求的客户端（可为空）/ Client of the request (may be null)
+     * @param hint 上下文提示（可为空）/ Context hint (may be empty)
+     */
+    void performUpstreamTranslation(const QString& text, const QString& clientIP, bool useCache, const QString& scope, TranslationCallback done, bool allowMicroBatch = false, RequestOrigin origin = RequestOrigin::Background,
+                                    std::shared_ptr<RequestLifetime> lifetime = nullptr, const QString& hint = QString());
+
+    /**
+     * 🧺 加入合批 / Add a request to a micro-batch
+     * @param scope 缓存作用域（配置指纹）/ Cache scope (config fingerprint)
+     * @param clientIP 客户端IP地址 / Client IP address
+     * @param item 请求 / Request
+     */
+    void submitMicroBatch(const QString& scope, const QString& clientIP, MicroBatchItem item);
+
+    /**
+     * 🧺 发送一个合批（编号多行提示，缺失或错位的行单独回退）/ Send a micro-batch (numbered multi-line prompt, missing or misaligned lines fall back)
+     * @param clientIP 客户端IP地址 / Client IP address
+     * @param items 请求 / Requests
+     */
+    void runMicroBatch(const QString& clientIP, std::vector<MicroBatchItem> items);
+
+    /**
+     * 逐行批量翻译（行级缓存与去重）/ Line-level batch translation (per-line cache and dedup)
+     * @param lines 原文行 / Source lines
+     * @param clientIP 客户端IP地址 / Client IP address
+     * @param lifetime 请求的客户端（可为空）/ Client of the request (may be null)
+     * @return 与输入逐行对应的译文，失败时为空 / One translation per line, empty on failure
+     */
+    QStringList performBatchTranslation(const QStringList& lines, const QString& clientIP, std::shared_ptr<RequestLifetime> lifetime = nullptr);
+
+    /**
+     * 并发翻译彼此独立的条目（逐项缓存，允许部分成功）/ Translate independent items concurrently (cached per item, partial success allowed)
+     * @param items 条目 / Items
+     * @param clientIP 客户端IP地址 / Client IP address
+     * @param lifetime 请求的客户端（可为空）/ Client of the request (may be null)
+     * @return 与输入逐项对应的结果 / One result per item
+     */
+    QList<BatchItemResult> performItemBatch(const QList<BatchItem>& items, const QString& clientIP, std::shared_ptr<RequestLifetime> lifetime = nullptr);
+
+    /**
+     * 执行带重试的上游翻译（不查缓存）/ Perform upstream translation with retries (no cache)
+     * @param text 要翻译的文本 / Text to translate
+     * @param clientIP 客户端IP地址 / Client IP address
+     * @param maxAttempts 最大尝试次数 / Maximum number of attempts
+     * @param done 完成回调：译文、失败是否由模型拒绝/无效结果导致、译文是否来自主模型 / Callback: result, whether failure was caused by refused/invalid output, whether the result came from the primary model
+     * @param priority 调度等级 / Scheduling class
+     * @param abandoned 等待者都放弃后跳过排队、中止请求（可为空）/ Skip the queue and abort the request once every waiter has given up (may be empty)
+     * @param hint 上下文提示（可为空）/ Context hint (may be empty)
+     * @param numbered 合批的编号多行文本（"#n: "）/ Numbered multi-line text of a micro-batch ("#n: ")
+     */
+    void performTranslationWithRetry(const QString& text, const QString& clientIP, int maxAttempts, RetryCallback done, PriorityClass priority = PriorityClass::Background,
+                                     AbandonedCheck abandoned = nullptr, const QString& hint = QString(), bool numbered = false);
+
+    /**
+     * 开始重试序列的下一次尝试 / Start the next attempt of a retry series
+     * @param state 重试进度 / Retry progress
+     */
+    void runRetryAttempt(const std::shared_ptr<struct RetryState>& state);
+
+    /**
+     * 🧩 模板抽象 - 将数字和标签替换为槽位 / Template abstraction - replace numbers and tags with slots
+     * @param input 输入文本 / Input text
+     * @param slotMap 槽位映射（[N_n]/[T_n] → 原值）/ Slot map ([N_n]/[T_n] → original value)
+     * @return 模板文本，无法模板化时为空 / Template text, empty if the text has no slots
+     */
+    QString abstractTemplate(const QString& input, struct EscapeMap& slotMap);
+
+    /**
+     * 🧩 模板填充 - 将槽位值填回模板译文 / Template filling - put slot values back into a template translation
+     * @param translation 模板译文 / Template translation
+     * @param slotMap 槽位映射 / Slot map
+     * @param result 填充后的译文 / Filled translation
+     * @return 每个槽位恰好出现一次时为 true / True if every slot appears exactly once
+     */
+    bool fillTemplate(const QString& translation, const struct EscapeMap& slotMap, QString& result);
+
+    /**
+     * 🧩 模板提取 - 将译文中的槽位值换回槽位 / Template extraction - turn the slot values in a translation back into slots
+     * @param translation 原文的译文 / Translation of the source text
+     * @param slotMap 原文的槽位映射 / Slot map of the source text
+     * @param templTranslation 模板译文 / Template translation
+     * @return 每个值恰好对应一个槽位且填回后与译文一致时为 true / True if every value maps to exactly one slot and filling it back gives the translation
+     */
+    bool extractTemplate(const QString& translation, const struct EscapeMap& slotMap, QString& templTranslation);
+
+    /**
+     * 仅查缓存的模板命中（不请求上游）/ Template hit from the cache only (no upstream call)
+     * @param scope 缓存作用域（配置指纹）/ Cache scope (config fingerprint)
+     * @param text 原文 / Source text
+     * @param result 填充后的译文 / Filled translation
+     * @return 是否命中 / Whether it was a hit
+     */
+    bool lookupTemplate(const QString& scope, const QString& text, QString& result);
+
+    /**
+     * 计算影响译文的配置指纹 / Compute fingerprint of translation-relevant config
+     * @return 指纹字符串 / Fingerprint string
+     */
+    QString configFingerprint();
+
+    /**
+     * 重新计算配置指纹（需持有 m_configMutex）/ Recompute the config fingerprint (m_configMutex held)
+     */
+    void refreshFingerprintLocked();
     
     /**
-     * 获取下一个API密钥（轮询） / Get next API key (round-robin)
-     * @return API密钥 / API key
+     * 选定上游并取得有余量的API密钥后发送请求；全部密钥饱和时短暂排队 / Send the request once a backend key has headroom; queue briefly while every key is saturated
+     * @param ctx 构建请求时保存的状态 / State captured when the request was built
+     * @param done 完成回调 / Completion callback
+     * @param queuedMs 已排队时间 / Time already spent queued
+     */
+    void dispatchAttempt(std::shared_ptr<struct AttemptContext> ctx, AttemptCallback done, qint64 queuedMs);
+
+    /**
+     * 发送一次尝试中的上游请求（主请求或对冲请求）/ Post one upstream request of an attempt (primary or hedge)
+     * @param ctx 请求状态（含所用上游与密钥）/ Request state (including its backend and key)
+     * @param race 主请求与对冲请求共享的竞争状态 / Race shared by the primary and the hedge
+     * @param hedge 是否为对冲请求 / Whether this is the hedge
+     * @return 上游调用编号 / Upstream call id
+     */
+    quint64 postAttempt(std::shared_ptr<struct AttemptContext> ctx, std::shared_ptr<struct HedgeRace> race, bool hedge);
+
+    /**
+     * 为仍未返回的尝试发送对冲请求 / Send the hedge of an attempt that has not returned yet
+     * @param triggerMs 触发对冲的延迟 / Delay that triggered the hedge
+     */
+    void sendHedge(std::shared_ptr<struct AttemptContext> ctx, std::shared_ptr<struct HedgeRace> race, qint64 triggerMs);
+
+    /**
+     * 等待者都放弃后取消进行中的上游请求 / Cancel the upstream requests of an attempt once every waiter has given up
      */
-    QString getNextApiKey();
+    void watchAbandonment(std::shared_ptr<struct AttemptContext> ctx, std::shared_ptr<struct HedgeRace> race);
     
     /**
      * 生成客户端ID / Generate client ID
@@ -142,12 +422,30 @@ private:
     QString m_hijackedIniPath; // 🔥 新增：记忆当前被劫持的配置文件路径
     
     /**
-     * 执行单次翻译尝试 / Perform single translation attempt
+     * 执行单次翻译尝试（异步）/ Perform single translation attempt (asynchronous)
      * @param text 要翻译的文本 / Text to translate
      * @param clientIP 客户端IP地址 / Client IP address
+     * @param done 完成回调：译文、上游已应答但结果被拒绝、失败原因、译文是否来自主模型 / Callback: result, whether the upstream answered but the result was rejected, why it failed, and whether the result came from the primary model
+     * @param abandoned 等待者是否都已放弃（可为空）/ Whether every waiter has given up (may be empty)
+     * @param hint 加入系统提示词的上下文提示（可为空）/ Context hint added to the system prompt (may be empty)
+     * @param numbered 合批的编号多行文本：加入编号规则，且不计入上下文 / Numbered micro-batch text: adds the numbering rule and stays out of the context history
+     */
+    void performSingleTranslationAttempt(const QString& text, const QString& clientIP, AttemptCallback done, AbandonedCheck abandoned = nullptr, const QString& hint = QString(),
+                                         bool numbered = false);
+
+    /**
+     * 解析上游响应为译文 / Parse an upstream reply into a translation
+     * @param reply 上游响应 / Upstream reply
+     * @param ctx 构建请求时保存的状态 / State captured when the request was built
+     * @param contentRejected 输出：上游已应答但结果被拒绝 / Out: upstream answered but the result was rejected
      * @return 翻译结果 / Translation result
      */
-    QString performSingleTranslationAttempt(const QString& text, const QString& clientIP);
+    QString parseTranslationReply(const UpstreamResponse& reply, const struct AttemptContext& ctx, bool* contentRejected);
+
+    /**
+     * 记录流式响应的首 token 耗时与吞吐量 / Record time-to-first-token and throughput of a streamed reply
+     */
+    void recordStreamMetrics(const struct StreamState& stream, const UpstreamResponse& reply, const AppConfig& cfg);
     
     /**
      * 验证翻译结果有效性 / Validate translation result
@@ -176,22 +474,63 @@ private:
 
 private:
     AppConfig m_config; // 当前配置 / Current configuration
+    QString m_fingerprint; // 配置指纹（缓存作用域）/ Config fingerprint (cache scope)
     std::atomic<bool> m_running; // 服务器运行状态 / Server running status
     std::atomic<bool> m_stopRequested; // 停止请求标志 / Stop request flag
     
     std::thread* m_serverThread = nullptr; // 服务器线程 / Server thread
+    std::thread* m_importThread = nullptr; // 后台维护线程（导入、术语索引）/ Background maintenance thread (import, glossary index)
+    std::thread* m_writerThread = nullptr; // 写入线程（翻译记忆、学到的术语）/ Writer thread (translation memory, learned terms)
     httplib::Server* m_svr = nullptr; // HTTP服务器实例 / HTTP server instance
     
     std::map<std::string, Context> m_contexts; // 客户端上下文映射 / Client context map
     std::mutex m_contextMutex; // 上下文互斥锁 / Context mutex
     
-    std::vector<QString> m_apiKeys; // API密钥列表 / API key list
-    int m_currentKeyIndex = 0; // 当前密钥索引 / Current key index
-    std::mutex m_keyMutex; // 密钥互斥锁 / Key mutex
+    BackendRouter m_router;      // 多上游路由与按密钥限速 / Multi-backend routing and per-key rate limiting
+    RetryPolicy m_retryPolicy;   // 重试退避与全局重试预算 / Retry backoff and global retry budget
+    HedgePolicy m_hedger;        // 对冲请求的触发延迟与预算 / Hedged request trigger and budget
+    AdmissionController m_admission; // HTTP请求的有界准入队列 / Bounded admission queue for HTTP requests
+    TranslationScheduler m_scheduler;  // 上游翻译的优先级调度 / Priority scheduling of upstream translations
+    std::atomic<qint64> m_lastShedLogMs{0}; // 上次记录拒绝日志的时间 / When a rejection was last logged
     
     // 配置互斥锁 / Configuration mutex
     std::mutex m_configMutex;
 
+    // 进行中的上游请求（单飞合并）/ In-flight upstream requests (single-flight)
+    std::map<std::string, InFlightRequest> m_inFlight; // 键 → 进行中的请求 / Key → in-flight request
+    std::mutex m_inFlightMutex;
+    std::atomic<quint64> m_coalescedCount{0}; // 被合并的请求数 / Coalesced request count
+    std::atomic<quint64> m_templateHits{0};   // 模板缓存命中数 / Template cache hits
+    std::map<QString, PendingMicroBatch> m_microBatches; // 作用域+客户端 → 收集中的合批 / Scope + client → batch being collected
+    std::mutex m_microBatchMutex;
+    quint64 m_nextMicroBatchId = 1;                       // 受 m_microBatchMutex 保护 / Guarded by m_microBatchMutex
+    std::atomic<quint64> m_microBatchCount{0};            // 发出的合批数 / Micro-batches sent
+    std::atomic<quint64> m_microBatchedItems{0};          // 合批中的请求数 / Requests sent in micro-batches
+    std::atomic<quint64> m_microBatchFallbacks{0};        // 单独回退的请求数 / Requests that fell back
+    std::atomic<quint64> m_abandonedQueued{0};   // 客户端放弃后跳过的排队请求 / Queued requests skipped after their clients gave up
+    std::atomic<quint64> m_abandonedRunning{0};  // 客户端放弃后中止的请求与重试 / Running requests and retries aborted after their clients gave up
+    std::atomic<quint64> m_abandonedTokens{0};   // 因此节省的预估 token / Estimated tokens saved that way
+    std::atomic<quint64> m_streamCount{0};      // 流式响应数 / Streamed replies
+    std::atomic<qint64> m_streamTtftTotalMs{0}; // 首 token 耗时总和 / Sum of time to first token
+    std::atomic<quint64> m_streamEarlyStops{0}; // 提前结束的流 / Streams stopped early
+
+    // 共享的上游连接池 / Shared upstream connection pool
+    UpstreamClient m_upstream;
+
+    // 术语变更的选择性失效 / Selective invalidation on glossary changes
+    GlossaryIndex m_glossaryIndex;                  // 术语 → 缓存条目 / Term → cache entries
+    QList<GlossaryChange> m_glossaryChanges;        // 待处理的术语变更 / Pending term changes
+    QStringList m_retranslateQueue;                 // 待后台重译的原文 / Sources waiting for re-translation
+    bool m_glossaryWorkerActive = false;            // 维护线程是否在接收变更 / Whether the worker accepts changes
+    std::mutex m_glossaryMutex;
+    std::condition_variable m_glossaryCv;
+
+    // 网络线程之外的磁盘写入 / Disk writes kept off the network thread
+    std::deque<std::function<void()>> m_writeQueue; // 待执行的写入 / Pending writes
+    bool m_writerActive = false;                    // 写入线程是否在接收写入 / Whether the writer accepts writes
+    std::mutex m_writeMutex;
+    std::condition_variable m_writeCv;
+
     // 🔥 已删除：m_logHistory 和 m_logHistoryMutex - 现在由 LogManager 接管
     // std::deque<QString> m_logHistory; 
     // std::mutex m_logHistoryMutex;     
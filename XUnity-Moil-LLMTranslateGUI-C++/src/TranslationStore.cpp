@@ -0,0 +1,687 @@
+#include "TranslationStore.h"
+#include <QDateTime>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+const char LOG_MAGIC[4] = {'X', 'T', 'M', 'L'};
+const char INDEX_MAGIC[4] = {'X', 'T', 'M', 'I'};
+const quint64 MIN_INDEX_CAPACITY = 1024;
+const double MAX_LOAD_FACTOR = 0.7;
+const quint64 MIN_LOG_RESERVE = 1024 * 1024;
+}
+
+TranslationStore::~TranslationStore()
+{
+    close();
+}
+
+/**
+ * Open (or create) the store.
+ * 打开（或创建）存储。
+ */
+bool TranslationStore::open(const QString &basePath, QString *report)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return openLocked(basePath, report);
+}
+
+bool TranslationStore::openLocked(const QString &basePath, QString *report)
+{
+    closeLocked();
+    m_basePath = basePath;
+
+    m_logFile.setFileName(basePath + ".tmlog");
+    if (!m_logFile.open(QIODevice::ReadWrite))
+        return false;
+
+    if (m_logFile.size() < qint64(sizeof(LogHeader)))
+    {
+        if (!initLog())
+            return false;
+    }
+    else
+    {
+        LogHeader header;
+        m_logFile.seek(0);
+        m_logFile.read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (std::memcmp(header.magic, LOG_MAGIC, 4) != 0 || header.version != FORMAT_VERSION)
+        {
+            // Unknown format: keep the old file for inspection and start a new store.
+            // 未知格式：保留旧文件以便检查，并新建存储。
+            quint32 oldVersion = std::memcmp(header.magic, LOG_MAGIC, 4) == 0 ? header.version : 0;
+            QString backup = QString("%1.tmlog.v%2.bak").arg(basePath).arg(oldVersion);
+            m_logFile.close();
+            QFile::remove(backup);
+            QFile::rename(basePath + ".tmlog", backup);
+            QFile::remove(basePath + ".tmidx");
+            if (report)
+                *report = QString("store format v%1 moved to %2").arg(oldVersion).arg(backup);
+
+            m_logFile.setFileName(basePath + ".tmlog");
+            if (!m_logFile.open(QIODevice::ReadWrite) || !initLog())
+                return false;
+        }
+        else
+        {
+            m_logCreatedAt = header.createdAt;
+        }
+    }
+
+    m_logSize = quint64(m_logFile.size());
+    if (!mapLog(m_logSize))
+        return false;
+
+    if (!openIndex())
+    {
+        if (report && report->isEmpty() && m_logSize > sizeof(LogHeader))
+            *report = "index rebuilt from log";
+        if (!rebuildIndex())
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Unmap and close both files.
+ * 解除映射并关闭两个文件。
+ */
+void TranslationStore::close()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    closeLocked();
+}
+
+void TranslationStore::closeLocked()
+{
+    if (m_indexMap)
+    {
+        m_indexFile.unmap(m_indexMap);
+        m_indexMap = nullptr;
+    }
+    if (m_indexFile.isOpen())
+        m_indexFile.close();
+    if (m_logMap)
+    {
+        m_logFile.unmap(m_logMap);
+        m_logMap = nullptr;
+    }
+    if (m_logFile.isOpen())
+    {
+        m_logFile.flush();
+        // Cut off the reserve ; 截掉预留空间
+        if (m_logSize > 0 && quint64(m_logFile.size()) > m_logSize)
+            m_logFile.resize(qint64(m_logSize));
+        m_logFile.close();
+    }
+    m_mappedLogSize = 0;
+    m_logSize = 0;
+}
+
+bool TranslationStore::isOpen()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_logMap != nullptr && m_indexMap != nullptr;
+}
+
+/**
+ * Write a fresh log header (truncates the log).
+ * 写入新的日志头（截断日志）。
+ */
+bool TranslationStore::initLog()
+{
+    LogHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, LOG_MAGIC, 4);
+    header.version = FORMAT_VERSION;
+    header.headerSize = sizeof(LogHeader);
+    header.createdAt = QDateTime::currentMSecsSinceEpoch();
+
+    if (!m_logFile.resize(0) || !m_logFile.seek(0))
+        return false;
+    if (m_logFile.write(reinterpret_cast<const char *>(&header), sizeof(header)) != qint64(sizeof(header)))
+        return false;
+    m_logFile.flush();
+    m_logCreatedAt = header.createdAt;
+    return true;
+}
+
+/**
+ * (Re)map the log with room to grow: the file is extended with zeros to at least `needed`
+ * bytes plus half the used size, so appends land inside the mapping and the next remap is
+ * only due once that reserve is used up. After a crash the reserve is cut off by scanLog(),
+ * whose first zero header fails its checksum.
+ * （重新）映射日志并预留增长空间：文件以零扩展到至少 `needed` 字节再加已用大小的一半，
+ * 使追加落在映射范围内，预留空间用完后才需要再次映射。崩溃后预留空间由 scanLog() 截掉
+ * （其第一个全零记录头无法通过校验）。
+ */
+bool TranslationStore::mapLog(quint64 needed)
+{
+    if (m_logMap)
+    {
+        m_logFile.unmap(m_logMap);
+        m_logMap = nullptr;
+    }
+    m_mappedLogSize = 0;
+    m_logFile.flush();
+
+    const quint64 capacity = std::max(needed, m_logSize + std::max(m_logSize / 2, MIN_LOG_RESERVE));
+    if (quint64(m_logFile.size()) < capacity && !m_logFile.resize(qint64(capacity)))
+        return false;
+    m_logMap = m_logFile.map(0, qint64(capacity));
+    m_mappedLogSize = m_logMap ? capacity : 0;
+    return m_logMap != nullptr;
+}
+
+/**
+ * Open and validate the existing index, then index any records appended after it.
+ * 打开并校验现有索引，然后为其之后追加的记录建立索引。
+ *
+ * @return False if the index is missing or does not belong to the current log.
+ */
+bool TranslationStore::openIndex()
+{
+    m_indexFile.setFileName(m_basePath + ".tmidx");
+    if (!m_indexFile.exists() || !m_indexFile.open(QIODevice::ReadWrite))
+        return false;
+
+    qint64 fileSize = m_indexFile.size();
+    if (fileSize < qint64(sizeof(IndexHeader)))
+    {
+        m_indexFile.close();
+        return false;
+    }
+
+    m_indexMap = m_indexFile.map(0, fileSize);
+    if (!m_indexMap)
+    {
+        m_indexFile.close();
+        return false;
+    }
+
+    const IndexHeader *h = indexHeader();
+    bool valid = std::memcmp(h->magic, INDEX_MAGIC, 4) == 0 &&
+                 h->version == FORMAT_VERSION &&
+                 h->capacity >= MIN_INDEX_CAPACITY &&
+                 (h->capacity & (h->capacity - 1)) == 0 &&
+                 quint64(fileSize) == sizeof(IndexHeader) + h->capacity * sizeof(IndexSlot) &&
+                 h->logCreatedAt == m_logCreatedAt &&
+                 h->coveredLogSize >= sizeof(LogHeader) &&
+                 h->coveredLogSize <= m_logSize;
+    if (!valid)
+    {
+        m_indexFile.unmap(m_indexMap);
+        m_indexMap = nullptr;
+        m_indexFile.close();
+        return false;
+    }
+
+    // Records written after the last index update (e.g. after a crash).
+    // 上次索引更新之后写入的记录（例如崩溃后）。
+    if (h->coveredLogSize < m_logSize)
+        scanLog(h->coveredLogSize);
+    return true;
+}
+
+/**
+ * Create a zero‑filled index file with the given capacity and map it.
+ * 创建指定容量的零填充索引文件并映射。
+ */
+bool TranslationStore::createIndex(const QString &path, quint64 capacity)
+{
+    if (m_indexMap)
+    {
+        m_indexFile.unmap(m_indexMap);
+        m_indexMap = nullptr;
+    }
+    if (m_indexFile.isOpen())
+        m_indexFile.close();
+
+    QFile::remove(path);
+    m_indexFile.setFileName(path);
+    if (!m_indexFile.open(QIODevice::ReadWrite))
+        return false;
+
+    qint64 fileSize = qint64(sizeof(IndexHeader) + capacity * sizeof(IndexSlot));
+    if (!m_indexFile.resize(fileSize))
+        return false;
+    m_indexMap = m_indexFile.map(0, fileSize);
+    if (!m_indexMap)
+        return false;
+
+    std::memset(m_indexMap, 0, size_t(fileSize));
+    IndexHeader *h = indexHeader();
+    std::memcpy(h->magic, INDEX_MAGIC, 4);
+    h->version = FORMAT_VERSION;
+    h->capacity = capacity;
+    h->coveredLogSize = sizeof(LogHeader);
+    h->logCreatedAt = m_logCreatedAt;
+    return true;
+}
+
+/**
+ * Rebuild the index from scratch by scanning the whole log.
+ * 扫描整个日志，从头重建索引。
+ */
+bool TranslationStore::rebuildIndex()
+{
+    quint64 estimate = m_logSize / 64; // Rough record count ; 粗略估计记录数
+    quint64 capacity = nextPow2(std::max<quint64>(MIN_INDEX_CAPACITY, quint64(estimate / MAX_LOAD_FACTOR) + 1));
+    if (!createIndex(m_basePath + ".tmidx", capacity))
+        return false;
+    scanLog(sizeof(LogHeader));
+    return true;
+}
+
+/**
+ * Double the index capacity. The new index is written next to the old one and swapped in.
+ * 将索引容量翻倍。新索引写在旧索引旁边，再替换旧索引。
+ */
+bool TranslationStore::growIndex()
+{
+    const IndexHeader oldHeader = *indexHeader();
+    const quint64 oldCapacity = oldHeader.capacity;
+    QByteArray oldSlots(reinterpret_cast<const char *>(indexSlots()), int(oldCapacity * sizeof(IndexSlot)));
+
+    QString indexPath = m_basePath + ".tmidx";
+    QString tmpPath = indexPath + ".tmp";
+    if (!createIndex(tmpPath, oldCapacity * 2))
+        return false;
+
+    IndexHeader *h = indexHeader();
+    h->coveredLogSize = oldHeader.coveredLogSize;
+    h->deadBytes = oldHeader.deadBytes;
+    h->liveCount = oldHeader.liveCount;
+
+    const quint64 mask = h->capacity - 1;
+    const IndexSlot *src = reinterpret_cast<const IndexSlot *>(oldSlots.constData());
+    IndexSlot *dst = indexSlots();
+    for (quint64 i = 0; i < oldCapacity; ++i)
+    {
+        if (src[i].offset == 0)
+            continue;
+        quint64 pos = src[i].hash & mask;
+        while (dst[pos].offset != 0)
+            pos = (pos + 1) & mask;
+        dst[pos] = src[i];
+        h->count++;
+    }
+
+    // Swap the files: the index has to be unmapped/closed before it can be renamed on Windows.
+    // 替换文件：在 Windows 上必须先解除映射并关闭索引才能重命名。
+    m_indexFile.unmap(m_indexMap);
+    m_indexMap = nullptr;
+    m_indexFile.close();
+    QFile::remove(indexPath);
+    if (!QFile::rename(tmpPath, indexPath))
+        return false;
+
+    m_indexFile.setFileName(indexPath);
+    if (!m_indexFile.open(QIODevice::ReadWrite))
+        return false;
+    m_indexMap = m_indexFile.map(0, m_indexFile.size());
+    return m_indexMap != nullptr;
+}
+
+/**
+ * Index every complete record from the given offset to the end of the log.
+ * A torn record at the tail (crash during append) is cut off.
+ * 为从指定偏移到日志末尾的每条完整记录建立索引。
+ * 末尾不完整的记录（追加时崩溃）会被截掉。
+ */
+void TranslationStore::scanLog(quint64 from)
+{
+    quint64 offset = from;
+    while (offset + sizeof(RecordHeader) <= m_logSize)
+    {
+        RecordHeader rec;
+        const char *key = nullptr;
+        const char *value = nullptr;
+        if (!readRecord(offset, rec, key, value) ||
+            rec.checksum != checksum(key, rec.keyLen, value, rec.valueLen))
+            break;
+
+        indexInsert(hashKey(key, rec.keyLen), offset, key, rec.keyLen, rec.flags);
+        offset += sizeof(RecordHeader) + rec.keyLen + rec.valueLen;
+    }
+
+    if (offset < m_logSize)
+    {
+        m_logFile.unmap(m_logMap);
+        m_logMap = nullptr;
+        m_logFile.resize(qint64(offset));
+        m_logSize = offset;
+        mapLog(offset);
+    }
+    if (m_indexMap)
+        indexHeader()->coveredLogSize = offset;
+}
+
+/**
+ * Read a record header and pointers to its key/value inside the mapping.
+ * The mapping always covers the used log (appendRecord() maps ahead of its writes).
+ * 读取记录头以及映射内键/值的指针。
+ * 映射始终覆盖已用日志（appendRecord() 在写入前先扩大映射）。
+ */
+bool TranslationStore::readRecord(quint64 offset, RecordHeader &rec, const char *&key, const char *&value)
+{
+    if (offset + sizeof(RecordHeader) > m_logSize)
+        return false;
+
+    std::memcpy(&rec, m_logMap + offset, sizeof(RecordHeader));
+    quint64 end = offset + sizeof(RecordHeader) + quint64(rec.keyLen) + quint64(rec.valueLen);
+    if (end > m_logSize)
+        return false;
+
+    key = reinterpret_cast<const char *>(m_logMap + offset + sizeof(RecordHeader));
+    value = key + rec.keyLen;
+    return true;
+}
+
+/**
+ * Insert or update the slot for a key. Overwritten records are counted as dead bytes.
+ * 插入或更新键对应的槽位。被覆盖的记录计入无效字节。
+ */
+void TranslationStore::indexInsert(quint64 hash, quint64 offset, const char *key, quint32 keyLen, quint32 flags)
+{
+    if (double(indexHeader()->count + 1) > double(indexHeader()->capacity) * MAX_LOAD_FACTOR)
+        growIndex();
+    if (!m_indexMap)
+        return;
+
+    IndexHeader *h = indexHeader();
+    IndexSlot *table = indexSlots();
+    const quint64 mask = h->capacity - 1;
+    quint64 pos = hash & mask;
+    while (table[pos].offset != 0)
+    {
+        if (table[pos].hash == hash)
+        {
+            RecordHeader old;
+            const char *oldKey = nullptr;
+            const char *oldValue = nullptr;
+            if (readRecord(table[pos].offset, old, oldKey, oldValue) &&
+                old.keyLen == keyLen && std::memcmp(oldKey, key, keyLen) == 0)
+            {
+                h->deadBytes += sizeof(RecordHeader) + old.keyLen + old.valueLen;
+                if (isCounted(old.flags))
+                    h->liveCount--;
+                if (isCounted(flags))
+                    h->liveCount++;
+                table[pos].offset = offset;
+                return;
+            }
+        }
+        pos = (pos + 1) & mask;
+    }
+    table[pos].hash = hash;
+    table[pos].offset = offset;
+    h->count++;
+    if (isCounted(flags))
+        h->liveCount++;
+}
+
+/**
+ * Find the slot holding a key, or -1.
+ * 查找保存该键的槽位，不存在返回 -1。
+ */
+qint64 TranslationStore::findSlot(const QByteArray &key, quint64 hash)
+{
+    const IndexHeader *h = indexHeader();
+    const IndexSlot *table = indexSlots();
+    const quint64 mask = h->capacity - 1;
+    quint64 pos = hash & mask;
+    while (table[pos].offset != 0)
+    {
+        if (table[pos].hash == hash)
+        {
+            RecordHeader rec;
+            const char *k = nullptr;
+            const char *v = nullptr;
+            if (readRecord(table[pos].offset, rec, k, v) &&
+                rec.keyLen == quint32(key.size()) && std::memcmp(k, key.constData(), rec.keyLen) == 0)
+                return qint64(pos);
+        }
+        pos = (pos + 1) & mask;
+    }
+    return -1;
+}
+
+bool TranslationStore::get(const QByteArray &key, QByteArray &value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_logMap || !m_indexMap)
+        return false;
+
+    qint64 slot = findSlot(key, hashKey(key.constData(), quint32(key.size())));
+    if (slot < 0)
+        return false;
+
+    RecordHeader rec;
+    const char *k = nullptr;
+    const char *v = nullptr;
+    if (!readRecord(indexSlots()[slot].offset, rec, k, v) || (rec.flags & FLAG_TOMBSTONE))
+        return false;
+    value = QByteArray(v, int(rec.valueLen));
+    return true;
+}
+
+bool TranslationStore::put(const QByteArray &key, const QByteArray &value, bool metadata)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return appendRecord(key, value, metadata ? FLAG_METADATA : 0);
+}
+
+bool TranslationStore::remove(const QByteArray &key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_indexMap || findSlot(key, hashKey(key.constData(), quint32(key.size()))) < 0)
+        return false;
+    return appendRecord(key, QByteArray(), FLAG_TOMBSTONE);
+}
+
+/**
+ * Append one record to the log and point the index at it.
+ * 向日志追加一条记录，并让索引指向它。
+ */
+bool TranslationStore::appendRecord(const QByteArray &key, const QByteArray &value, quint32 flags)
+{
+    if (!m_logMap || !m_indexMap || key.isEmpty())
+        return false;
+
+    RecordHeader rec;
+    rec.keyLen = quint32(key.size());
+    rec.valueLen = quint32(value.size());
+    rec.flags = flags;
+    rec.checksum = checksum(key.constData(), rec.keyLen, value.constData(), rec.valueLen);
+
+    QByteArray buffer;
+    buffer.reserve(int(sizeof(rec)) + key.size() + value.size());
+    buffer.append(reinterpret_cast<const char *>(&rec), sizeof(rec));
+    buffer.append(key);
+    buffer.append(value);
+
+    const quint64 offset = m_logSize;
+    const quint64 end = offset + quint64(buffer.size());
+    if (end > m_mappedLogSize && !mapLog(end))
+        return false;
+    if (!m_logFile.seek(qint64(offset)) || m_logFile.write(buffer) != buffer.size())
+        return false;
+    m_logFile.flush();
+    m_logSize = end;
+
+    indexInsert(hashKey(key.constData(), rec.keyLen), offset, key.constData(), rec.keyLen, flags);
+    if (m_indexMap)
+        indexHeader()->coveredLogSize = m_logSize;
+    return true;
+}
+
+/**
+ * Visit each live record, copying index slots in batches of 1024 under the lock.
+ * 遍历每条有效记录，在锁内按每批 1024 个索引槽位复制。
+ */
+void TranslationStore::forEach(const std::function<bool(const QByteArray &key, const QByteArray &value)> &visit)
+{
+    std::vector<std::pair<QByteArray, QByteArray>> batch;
+    quint64 next = 0;
+    while (true)
+    {
+        batch.clear();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_logMap || !m_indexMap)
+                return;
+            const quint64 capacity = indexHeader()->capacity;
+            if (next >= capacity)
+                return;
+            const quint64 end = std::min<quint64>(capacity, next + 1024);
+            for (; next < end; ++next)
+            {
+                const quint64 offset = indexSlots()[next].offset;
+                if (offset == 0)
+                    continue;
+                RecordHeader rec;
+                const char *k = nullptr;
+                const char *v = nullptr;
+                if (readRecord(offset, rec, k, v) && !(rec.flags & FLAG_TOMBSTONE))
+                    batch.emplace_back(QByteArray(k, int(rec.keyLen)), QByteArray(v, int(rec.valueLen)));
+            }
+        }
+        for (const auto &record : batch)
+        {
+            if (!visit(record.first, record.second))
+                return;
+        }
+    }
+}
+
+bool TranslationStore::compact()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_logMap || !m_indexMap)
+        return false;
+
+    const QString logPath = m_basePath + ".tmlog";
+    const QString tmpPath = logPath + ".compact";
+    QFile out(tmpPath);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    LogHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, LOG_MAGIC, 4);
+    header.version = FORMAT_VERSION;
+    header.headerSize = sizeof(LogHeader);
+    header.createdAt = QDateTime::currentMSecsSinceEpoch();
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    const quint64 capacity = indexHeader()->capacity;
+    const IndexSlot *table = indexSlots();
+    for (quint64 i = 0; i < capacity; ++i)
+    {
+        if (table[i].offset == 0)
+            continue;
+        RecordHeader rec;
+        const char *k = nullptr;
+        const char *v = nullptr;
+        if (!readRecord(table[i].offset, rec, k, v) || (rec.flags & FLAG_TOMBSTONE))
+            continue;
+        out.write(reinterpret_cast<const char *>(&rec), sizeof(rec));
+        out.write(k, rec.keyLen);
+        out.write(v, rec.valueLen);
+    }
+    out.flush();
+    bool ok = out.error() == QFileDevice::NoError;
+    out.close();
+    if (!ok)
+    {
+        QFile::remove(tmpPath);
+        return false;
+    }
+
+    // The new log has a new identity, so the old index is rebuilt on reopen.
+    // 新日志拥有新的身份标识，重新打开时旧索引会被重建。
+    QString base = m_basePath;
+    closeLocked();
+    QFile::remove(logPath);
+    QFile::remove(base + ".tmidx");
+    if (!QFile::rename(tmpPath, logPath))
+        return false;
+    return openLocked(base, nullptr);
+}
+
+/**
+ * Drop all records and start an empty store.
+ * 删除所有记录，重新开始一个空存储。
+ */
+bool TranslationStore::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_basePath.isEmpty())
+        return false;
+    QString base = m_basePath;
+    closeLocked();
+    QFile::remove(base + ".tmlog");
+    QFile::remove(base + ".tmidx");
+    return openLocked(base, nullptr);
+}
+
+quint64 TranslationStore::count()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_indexMap ? indexHeader()->liveCount : 0;
+}
+
+quint64 TranslationStore::logBytes()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_logSize;
+}
+
+quint64 TranslationStore::deadBytes()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_indexMap ? indexHeader()->deadBytes : 0;
+}
+
+// ==========================================
+// Hash helpers
+// 哈希辅助函数
+// ==========================================
+
+quint64 TranslationStore::hashKey(const char *data, quint32 len)
+{
+    quint64 h = 14695981039346656037ULL; // FNV‑1a 64
+    for (quint32 i = 0; i < len; ++i)
+    {
+        h ^= quint8(data[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+quint32 TranslationStore::checksum(const char *key, quint32 keyLen, const char *value, quint32 valueLen)
+{
+    quint32 h = 2166136261u; // FNV‑1a 32
+    for (quint32 i = 0; i < keyLen; ++i)
+    {
+        h ^= quint8(key[i]);
+        h *= 16777619u;
+    }
+    for (quint32 i = 0; i < valueLen; ++i)
+    {
+        h ^= quint8(value[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+quint64 TranslationStore::nextPow2(quint64 v)
+{
+    quint64 p = 1;
+    while (p < v)
+        p <<= 1;
+    return p;
+}
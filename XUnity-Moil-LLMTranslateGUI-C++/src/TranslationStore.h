@@ -0,0 +1,188 @@
+#pragma once
+#include <QString>
+#include <QFile>
+#include <QByteArray>
+#include <mutex>
+#include <functional>
+
+/**
+ * Memory‑mapped on‑disk translation store.
+ * 基于内存映射的磁盘翻译存储。
+ *
+ * The store is made of two files next to each other:
+ *   <base>.tmlog  – append‑only log of records (key, value, flags, checksum)
+ *   <base>.tmidx  – open‑addressing hash index (hash → record offset)
+ * Both files are opened with QFile::map(), so startup only validates the headers and
+ * scans records appended after the last index update; lookups read straight from the
+ * mapping without materialising the whole memory as QStrings. While open, the log file is
+ * kept longer than its records (a zero‑filled reserve of half the log, at least 1 MiB) so
+ * appends land inside the mapping; the reserve is cut off again on close.
+ * 存储由两个相邻文件组成：
+ *   <base>.tmlog  – 仅追加的记录日志（键、值、标志、校验和）
+ *   <base>.tmidx  – 开放寻址哈希索引（哈希 → 记录偏移）
+ * 两个文件都通过 QFile::map() 映射，启动时只需校验文件头并扫描索引之后追加的记录；
+ * 查询直接读取映射内存，无需把整个记忆载入为 QString。打开期间日志文件比记录更长（零填充的预留空间，
+ * 为日志大小的一半，至少 1 MiB），使追加落在映射范围内；关闭时会截掉预留空间。
+ *
+ * Both files carry a magic and a format version. A log with an unknown version is moved
+ * aside as "<base>.tmlog.v<N>.bak" and a new one is started; an index that does not match
+ * its log is simply rebuilt from the log. Integers are stored in native (little‑endian) order.
+ * 两个文件都带有魔数与格式版本号。版本未知的日志会被改名为 "<base>.tmlog.v<N>.bak" 并新建；
+ * 与日志不匹配的索引会直接从日志重建。整数按本机字节序（小端）存储。
+ *
+ * Not a singleton: TranslationCache owns one instance. All public methods are thread‑safe.
+ * 非单例：由 TranslationCache 持有一个实例。所有公有方法均线程安全。
+ */
+class TranslationStore
+{
+public:
+    static constexpr quint32 FORMAT_VERSION = 1; ///< On‑disk format version ; 磁盘格式版本
+
+    TranslationStore() = default;
+    ~TranslationStore();
+
+    /**
+     * Open (or create) the store.
+     * 打开（或创建）存储。
+     *
+     * @param basePath Path without extension, e.g. "translation_memory" ; 不含扩展名的路径
+     * @param report   Optional human‑readable note about rebuilds/recoveries ; 可选：重建/恢复说明
+     * @return True on success ; 成功返回 true
+     */
+    bool open(const QString &basePath, QString *report = nullptr);
+
+    /**
+     * Unmap and close both files.
+     * 解除映射并关闭两个文件。
+     */
+    void close();
+
+    bool isOpen();
+
+    /**
+     * Look up the latest value for a key.
+     * 查询键的最新值。
+     */
+    bool get(const QByteArray &key, QByteArray &value);
+
+    /**
+     * Append a value for a key (replaces any previous value).
+     * 为键追加一个值（覆盖旧值）。
+     *
+     * @param metadata Bookkeeping record: stored like any other, but not part of count() ; 簿记记录：与其他记录一样保存，但不计入 count()
+     */
+    bool put(const QByteArray &key, const QByteArray &value, bool metadata = false);
+
+    /**
+     * Append a tombstone for a key.
+     * 为键追加删除标记。
+     */
+    bool remove(const QByteArray &key);
+
+    /**
+     * Rewrite the log with live records only and rebuild the index.
+     * 仅保留有效记录重写日志并重建索引。
+     *
+     * Written to temporary files first, then swapped in, so a crash leaves the old store intact.
+     * 先写入临时文件再替换，崩溃时旧存储保持完整。
+     */
+    bool compact();
+
+    /**
+     * Drop all records and start an empty store.
+     * 删除所有记录，重新开始一个空存储。
+     */
+    bool clear();
+
+    /**
+     * Visit every live record until the visitor returns false.
+     * 遍历所有有效记录，直到访问函数返回 false。
+     *
+     * Records are copied in small batches, so the lock is not held while the visitor runs;
+     * records written during the walk may or may not be visited.
+     * 记录按小批量复制，访问函数运行时不持有锁；遍历期间写入的记录可能被访问也可能不被访问。
+     */
+    void forEach(const std::function<bool(const QByteArray &key, const QByteArray &value)> &visit);
+
+    quint64 count();     ///< Live keys, not counting deleted and metadata ones ; 有效键数，不含已删除键与簿记键
+    quint64 logBytes();  ///< Bytes used by records in the log ; 日志中记录占用的字节数
+    quint64 deadBytes(); ///< Bytes held by overwritten/deleted records ; 被覆盖/删除记录占用的字节
+
+private:
+    // Record flags ; 记录标志
+    static constexpr quint32 FLAG_TOMBSTONE = 1;
+    static constexpr quint32 FLAG_METADATA = 2;
+
+#pragma pack(push, 1)
+    struct LogHeader
+    {
+        char magic[4];      // "XTML"
+        quint32 version;    // FORMAT_VERSION
+        quint32 headerSize; // sizeof(LogHeader)
+        quint32 reserved;
+        qint64 createdAt;   // Identity of this log, mirrored by the index ; 日志身份标识，索引中保存同一值
+        quint64 reserved2;
+    };
+    struct RecordHeader
+    {
+        quint32 keyLen;
+        quint32 valueLen;
+        quint32 flags;
+        quint32 checksum; // FNV‑1a over key + value ; 键与值的 FNV‑1a 校验
+    };
+    struct IndexHeader
+    {
+        char magic[4];          // "XTMI"
+        quint32 version;        // FORMAT_VERSION
+        quint64 capacity;       // Slot count, power of two ; 槽位数，2 的幂
+        quint64 count;          // Used slots ; 已用槽位
+        quint64 coveredLogSize; // Log bytes already indexed ; 已建索引的日志字节数
+        qint64 logCreatedAt;    // Must equal LogHeader::createdAt ; 必须与日志头一致
+        quint64 deadBytes;      // Overwritten record bytes ; 已被覆盖的记录字节
+        quint64 liveCount;      // Keys whose latest record is a plain value ; 最新记录为普通值的键数
+        quint64 reserved;
+    };
+    struct IndexSlot
+    {
+        quint64 hash;
+        quint64 offset; // 0 = empty (offset 0 is always the log header) ; 0 表示空槽（偏移 0 永远是日志头）
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(LogHeader) == 32, "LogHeader layout");
+    static_assert(sizeof(RecordHeader) == 16, "RecordHeader layout");
+    static_assert(sizeof(IndexHeader) == 64, "IndexHeader layout");
+    static_assert(sizeof(IndexSlot) == 16, "IndexSlot layout");
+
+    bool openLocked(const QString &basePath, QString *report);
+    void closeLocked();
+    bool initLog();
+    bool mapLog(quint64 needed);
+    bool openIndex();
+    bool createIndex(const QString &path, quint64 capacity);
+    bool rebuildIndex();
+    bool growIndex();
+    void scanLog(quint64 from);
+    bool appendRecord(const QByteArray &key, const QByteArray &value, quint32 flags);
+    void indexInsert(quint64 hash, quint64 offset, const char *key, quint32 keyLen, quint32 flags);
+    bool readRecord(quint64 offset, RecordHeader &rec, const char *&key, const char *&value);
+    qint64 findSlot(const QByteArray &key, quint64 hash);
+
+    IndexHeader *indexHeader() const { return reinterpret_cast<IndexHeader *>(m_indexMap); }
+    IndexSlot *indexSlots() const { return reinterpret_cast<IndexSlot *>(m_indexMap + sizeof(IndexHeader)); }
+
+    static quint64 hashKey(const char *data, quint32 len);
+    static quint32 checksum(const char *key, quint32 keyLen, const char *value, quint32 valueLen);
+    static quint64 nextPow2(quint64 v);
+    static bool isCounted(quint32 flags) { return (flags & (FLAG_TOMBSTONE | FLAG_METADATA)) == 0; }
+
+    QString m_basePath;
+    QFile m_logFile;
+    QFile m_indexFile;
+    uchar *m_logMap = nullptr;   ///< Mapping of the log ; 日志映射
+    quint64 m_mappedLogSize = 0; ///< Bytes covered by m_logMap (records + reserve) ; m_logMap 覆盖的字节数（记录 + 预留）
+    quint64 m_logSize = 0;       ///< Bytes used by records ; 记录占用的字节数
+    qint64 m_logCreatedAt = 0;
+    uchar *m_indexMap = nullptr; ///< Mapping of the index ; 索引映射
+    std::mutex m_mutex;
+};
@@ -0,0 +1,266 @@
+#include "UpstreamClient.h"
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QMetaObject>
+#include <QTimer>
+#include <algorithm>
+#if QT_CONFIG(ssl)
+#include <QSslConfiguration>
+#endif
+
+/**
+ * One outstanding request (network thread only).
+ * 一个未完成的请求（仅在网络线程访问）。
+ */
+struct UpstreamClient::Call
+{
+    quint64 id = 0;
+    QNetworkRequest request;
+    QByteArray body;
+    int timeoutMs = 0;
+    UpstreamClient::Callback done;
+    UpstreamClient::StreamHandler onData;
+    QByteArray streamed; ///< Body bytes already handed to onData ; 已交给 onData 的响应体
+
+    QPointer<QNetworkReply> reply;
+    int managerIndex = -1;
+    QElapsedTimer elapsed;
+    QElapsedTimer connectTimer;
+    qint64 handshakeMs = -1;
+    qint64 firstByteMs = -1;
+    bool aborted = false;
+    bool timedOut = false;
+    bool stoppedEarly = false;
+};
+
+UpstreamClient::UpstreamClient()
+{
+    m_thread.setObjectName("UpstreamClient");
+    m_context = new QObject();
+    m_context->moveToThread(&m_thread);
+    // Managers are children of the context and go with it when the thread finishes.
+    // 管理器是上下文对象的子对象，线程结束时随其一起释放。
+    QObject::connect(&m_thread, &QThread::finished, m_context, &QObject::deleteLater);
+    m_thread.start();
+}
+
+UpstreamClient::~UpstreamClient()
+{
+    shutdown();
+}
+
+void UpstreamClient::shutdown()
+{
+    if (!m_thread.isRunning())
+        return;
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void UpstreamClient::ensureManagers(int count)
+{
+    if (!m_thread.isRunning())
+        return;
+    QMetaObject::invokeMethod(m_context, [this, count]()
+                              {
+        while (m_managers.size() < count)
+        {
+            m_managers.append(new QNetworkAccessManager(m_context));
+            m_inFlight.append(0);
+        } }, Qt::BlockingQueuedConnection);
+}
+
+void UpstreamClient::prewarm(const QUrl &url, int connections)
+{
+    if (!url.isValid() || url.host().isEmpty())
+        return;
+    QMetaObject::invokeMethod(m_context, [this, url, connections]()
+                              {
+        QNetworkAccessManager *manager = pickManager();
+        const bool https = url.scheme().compare("https", Qt::CaseInsensitive) == 0;
+        for (int i = 0; i < connections; ++i)
+        {
+#if QT_CONFIG(ssl)
+            if (https)
+            {
+                // Offer HTTP/2 like a normal request does, so the connection is reused by it.
+                // 与普通请求一样提供 HTTP/2，使预热的连接能被其复用。
+                QSslConfiguration ssl = QSslConfiguration::defaultConfiguration();
+                ssl.setAllowedNextProtocols({QSslConfiguration::ALPNProtocolHTTP2, QSslConfiguration::NextProtocolHttp1_1});
+                manager->connectToHostEncrypted(url.host(), quint16(url.port(443)), ssl);
+                continue;
+            }
+#endif
+            if (!https)
+                manager->connectToHost(url.host(), quint16(url.port(80)));
+        } }, Qt::QueuedConnection);
+}
+
+/**
+ * Least busy manager, lowest index on ties (network thread only).
+ * 最空闲的管理器，相同时取序号最小者（仅在网络线程调用）。
+ */
+QNetworkAccessManager *UpstreamClient::pickManager()
+{
+    if (m_managers.isEmpty())
+    {
+        m_managers.append(new QNetworkAccessManager(m_context));
+        m_inFlight.append(0);
+    }
+    int best = 0;
+    for (int i = 1; i < m_managers.size(); ++i)
+    {
+        if (m_inFlight[i] < m_inFlight[best])
+            best = i;
+    }
+    return m_managers[best];
+}
+
+quint64 UpstreamClient::postAsync(const QNetworkRequest &request, const QByteArray &body, int timeoutMs, Callback done,
+                                  StreamHandler onData)
+{
+    auto call = std::make_shared<Call>();
+    call->id = m_nextId++;
+    call->request = request;
+    call->body = body;
+    call->timeoutMs = timeoutMs;
+    call->done = std::move(done);
+    call->onData = std::move(onData);
+    call->elapsed.start();
+    QMetaObject::invokeMethod(m_context, [this, call]()
+                              { start(call); }, Qt::QueuedConnection);
+    return call->id;
+}
+
+void UpstreamClient::cancel(quint64 id)
+{
+    // Queued after the matching start(), so the call is either outstanding or already done.
+    // 排在对应的 start() 之后，因此该调用要么仍未完成，要么已经结束。
+    QMetaObject::invokeMethod(m_context, [this, id]()
+                              {
+        auto it = m_calls.constFind(id);
+        if (it != m_calls.constEnd())
+            abortCall(it.value(), false); }, Qt::QueuedConnection);
+}
+
+void UpstreamClient::cancelAll()
+{
+    QMetaObject::invokeMethod(m_context, [this]()
+                              {
+        const QList<std::shared_ptr<Call>> calls = m_calls.values();
+        for (const auto &call : calls)
+            abortCall(call, false); }, Qt::QueuedConnection);
+}
+
+void UpstreamClient::schedule(int delayMs, std::function<void()> fn)
+{
+    QMetaObject::invokeMethod(m_context, [this, delayMs, fn = std::move(fn)]()
+                              { QTimer::singleShot(delayMs, m_context, fn); }, Qt::QueuedConnection);
+}
+
+/**
+ * Abort a call; finished() follows synchronously and runs its callback (network thread only).
+ * 中止一个调用；随后会同步发出 finished() 并执行其回调（仅在网络线程调用）。
+ */
+void UpstreamClient::abortCall(const std::shared_ptr<Call> &call, bool timedOut)
+{
+    if (!call->reply)
+        return;
+    call->timedOut = timedOut;
+    call->aborted = !timedOut;
+    call->reply->abort();
+}
+
+/**
+ * Send a call on its manager and wire up completion (network thread only).
+ * 通过管理器发送请求并连接完成信号（仅在网络线程调用）。
+ */
+void UpstreamClient::start(const std::shared_ptr<Call> &call)
+{
+    QNetworkAccessManager *manager = pickManager();
+    call->managerIndex = m_managers.indexOf(manager);
+    m_inFlight[call->managerIndex]++;
+
+    QNetworkReply *reply = manager->post(call->request, call->body);
+    call->reply = reply;
+    m_calls.insert(call->id, call);
+
+    if (call->timeoutMs > 0)
+        QTimer::singleShot(call->timeoutMs, reply, [this, call]()
+                           { abortCall(call, true); });
+
+    // A socket only starts connecting when no idle connection could be reused.
+    // 只有在没有可复用的空闲连接时，才会开始建立新连接。
+    QObject::connect(reply, &QNetworkReply::socketStartedConnecting, reply, [call]()
+                     { call->connectTimer.start(); });
+    QObject::connect(reply, &QNetworkReply::requestSent, reply, [call]()
+                     {
+        if (call->connectTimer.isValid() && call->handshakeMs < 0)
+            call->handshakeMs = call->connectTimer.elapsed(); });
+
+    if (call->onData)
+    {
+        QObject::connect(reply, &QNetworkReply::readyRead, reply, [call, reply]()
+                         {
+            if (call->stoppedEarly)
+                return;
+            if (call->firstByteMs < 0)
+                call->firstByteMs = call->elapsed.elapsed();
+            QByteArray chunk = reply->readAll();
+            call->streamed += chunk;
+            if (!call->onData(chunk))
+            {
+                // The caller has what it needs; closing the connection stops the generation.
+                // 调用方已获得所需内容；关闭连接即可停止生成。
+                call->stoppedEarly = true;
+                reply->abort();
+            } });
+    }
+
+    QObject::connect(reply, &QNetworkReply::finished, reply, [this, call, reply]()
+                     {
+        m_calls.remove(call->id);
+        m_inFlight[call->managerIndex]--;
+        const bool newConnection = call->connectTimer.isValid();
+        m_requests++;
+        if (newConnection)
+        {
+            m_newConnections++;
+            m_handshakeMsTotal += std::max<qint64>(call->handshakeMs, 0);
+        }
+
+        UpstreamResponse r;
+        r.error = call->stoppedEarly ? QNetworkReply::NoError : reply->error();
+        r.errorString = call->stoppedEarly ? QString() : reply->errorString();
+        r.statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        r.body = call->streamed + reply->readAll();
+        r.retryAfter = reply->rawHeader("Retry-After");
+        r.timedOut = call->timedOut;
+        r.aborted = call->aborted;
+        r.stoppedEarly = call->stoppedEarly;
+        r.firstByteMs = call->firstByteMs;
+        r.newConnection = newConnection;
+        r.handshakeMs = call->handshakeMs;
+        r.elapsedMs = call->elapsed.elapsed();
+        reply->deleteLater();
+
+        Callback done = std::move(call->done);
+        if (done)
+            done(r); });
+}
+
+UpstreamClient::Stats UpstreamClient::stats() const
+{
+    Stats s;
+    s.requests = m_requests;
+    s.newConnections = m_newConnections;
+    s.handshakeMsTotal = m_handshakeMsTotal;
+    return s;
+}
+
+void UpstreamClient::resetStats()
+{
+    m_requests = 0;
+    m_newConnections = 0;
+    m_handshakeMsTotal = 0;
+}
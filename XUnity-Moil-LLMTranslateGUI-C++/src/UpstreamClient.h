@@ -0,0 +1,147 @@
+#pragma once
+#include <QObject>
+#include <QThread>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QByteArray>
+#include <QUrl>
+#include <QList>
+#include <QHash>
+#include <atomic>
+#include <memory>
+#include <functional>
+
+/**
+ * Outcome of one upstream HTTP request.
+ * 一次上游 HTTP 请求的结果。
+ */
+struct UpstreamResponse
+{
+    QNetworkReply::NetworkError error = QNetworkReply::NoError;
+    QString errorString;
+    int statusCode = 0;         ///< HTTP status, 0 if no response ; HTTP 状态码，无响应时为 0
+    QByteArray body;
+    QByteArray retryAfter;      ///< Retry-After header, empty if absent ; Retry-After 响应头，无则为空
+    bool timedOut = false;      ///< Overall deadline passed ; 超过总超时
+    bool aborted = false;       ///< Cancelled by the caller ; 被调用方取消
+    bool stoppedEarly = false;  ///< The stream handler had read enough ; 流处理函数已读取到足够内容
+    qint64 firstByteMs = -1;    ///< Time to the first body bytes ; 收到首批响应体的耗时
+    bool newConnection = false; ///< A new socket was opened for this request ; 为本请求新建了连接
+    qint64 handshakeMs = -1;    ///< Connect + TLS time of the new socket ; 新连接的建连与 TLS 握手耗时
+    qint64 elapsedMs = 0;
+};
+
+/**
+ * Shared, long‑lived upstream HTTP client.
+ * 共享的长生命周期上游 HTTP 客户端。
+ *
+ * A small pool of QNetworkAccessManagers lives on one dedicated network thread, so keep‑alive
+ * (HTTP/1.1) and multiplexed (HTTP/2) connections are reused across translations instead of
+ * paying DNS, TCP and TLS setup on every attempt. Each manager keeps up to six HTTP/1.1
+ * connections per host; requests go to the least busy manager, lowest index first, so idle
+ * traffic stays on the warm connections.
+ * 一个专用网络线程上运行少量 QNetworkAccessManager，长连接（HTTP/1.1）与多路复用连接（HTTP/2）
+ * 在多次翻译之间复用，不必每次尝试都重新进行 DNS、TCP 与 TLS 建连。每个管理器对每个主机最多保持
+ * 六条 HTTP/1.1 连接；请求分配给最空闲的管理器（序号小者优先），使低负载时的流量留在已预热的连接上。
+ *
+ * Requests are asynchronous: postAsync() returns at once and the callback runs on the network
+ * thread when the reply is complete, so thousands of requests can be outstanding without a
+ * waiting thread each. Callbacks must not block. All methods are thread‑safe.
+ * 请求是异步的：postAsync() 立即返回，响应完成后回调在网络线程上执行，因此可以同时挂起数千个请求，
+ * 而无需为每个请求占用一个等待线程。回调不得阻塞。所有方法均线程安全。
+ */
+class UpstreamClient
+{
+public:
+    using Callback = std::function<void(const UpstreamResponse &)>;
+    using StreamHandler = std::function<bool(const QByteArray &chunk)>; ///< Return false to stop reading ; 返回 false 停止读取
+
+    struct Stats
+    {
+        quint64 requests = 0;
+        quint64 newConnections = 0;
+        qint64 handshakeMsTotal = 0;
+    };
+
+    UpstreamClient();
+    ~UpstreamClient();
+
+    /**
+     * Grow the pool to at least this many managers (never shrinks while requests may be in flight).
+     * 将连接池扩大到至少该数量的管理器（不会缩小，以免影响进行中的请求）。
+     */
+    void ensureManagers(int count);
+
+    /**
+     * Open connections to the endpoint ahead of the first request.
+     * 在第一次请求前预先建立到端点的连接。
+     *
+     * @param url         Any URL of the endpoint (only scheme, host and port are used) ; 端点的任意 URL（仅使用协议、主机与端口）
+     * @param connections Connections to open on the first manager ; 在第一个管理器上建立的连接数
+     */
+    void prewarm(const QUrl &url, int connections);
+
+    /**
+     * POST a body; the callback receives the reply on the network thread.
+     * 发送 POST 请求；回调在网络线程上接收响应。
+     *
+     * @param request   Request (headers, transfer timeout) ; 请求（请求头、传输超时）
+     * @param body      Request body ; 请求体
+     * @param timeoutMs Overall deadline, 0 for none ; 总超时，0 表示不限
+     * @param done      Called exactly once, also after cancel() ; 恰好调用一次，cancel() 后也会调用
+     * @param onData    Optional: receives body bytes as they arrive (network thread); returning false
+     *                  closes the request and completes it with stoppedEarly = true and no error
+     *                  可选：在响应体到达时接收数据（网络线程）；返回 false 时关闭请求，并以
+     *                  stoppedEarly = true、无错误的状态完成
+     * @return Call id for cancel() ; 用于 cancel() 的调用编号
+     */
+    quint64 postAsync(const QNetworkRequest &request, const QByteArray &body, int timeoutMs, Callback done,
+                      StreamHandler onData = nullptr);
+
+    /**
+     * Abort a call; its callback runs with aborted = true.
+     * 中止一个调用；其回调以 aborted = true 执行。
+     */
+    void cancel(quint64 id);
+
+    /**
+     * Abort every outstanding call (server stop).
+     * 中止所有未完成的调用（停止服务时）。
+     */
+    void cancelAll();
+
+    /**
+     * Run a function on the network thread after a delay (retry backoff without a sleeping thread).
+     * 延迟后在网络线程上执行函数（重试退避无需休眠线程）。
+     */
+    void schedule(int delayMs, std::function<void()> fn);
+
+    /**
+     * Stop the network thread. Pending callbacks are dropped. Idempotent.
+     * 停止网络线程，未执行的回调会被丢弃。可重复调用。
+     */
+    void shutdown();
+
+    Stats stats() const;
+    void resetStats();
+
+private:
+    struct Call;
+
+    void start(const std::shared_ptr<Call> &call);
+    void abortCall(const std::shared_ptr<Call> &call, bool timedOut);
+    QNetworkAccessManager *pickManager();
+
+    QThread m_thread;
+    QObject *m_context = nullptr;             ///< Lives on m_thread, parent of the managers ; 位于 m_thread，管理器的父对象
+    QList<QNetworkAccessManager *> m_managers; ///< Network thread only ; 仅在网络线程访问
+    QList<int> m_inFlight;                     ///< Per manager, network thread only ; 每个管理器的进行中请求数，仅在网络线程访问
+    QHash<quint64, std::shared_ptr<Call>> m_calls; ///< Outstanding calls, network thread only ; 未完成的调用，仅在网络线程访问
+
+    std::atomic<quint64> m_nextId{1};
+
+    std::atomic<quint64> m_requests{0};
+    std::atomic<quint64> m_newConnections{0};
+    std::atomic<qint64> m_handshakeMsTotal{0};
+};
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDirIterator>
+#include <functional>
+#include "TranslationCache.h"
+
+/**
+ * XUA Translation Importer – warm‑start the translation memory from XUnity's own files.
+ * XUA 译文导入器 – 用 XUnity 自身的译文文件预热翻译记忆。
+ *
+ * XUnity writes every translation it receives into _AutoGeneratedTranslations.txt (next to
+ * the _Substitutions.txt used as glossary). This class streams that file, and the other
+ * translation files in the same Text directory, into TranslationCache so a new server
+ * process does not pay the LLM again for text the game already has.
+ * XUnity 会把收到的每条译文写入 _AutoGeneratedTranslations.txt（与用作术语表的
+ * _Substitutions.txt 同目录）。本类将该文件及同一 Text 目录下的其他译文文件流式导入
+ * TranslationCache，新的服务进程无需再为游戏已有的文本请求大模型。
+ *
+ * XUnity only appends to these files, so the byte offset reached by the last import is
+ * remembered per file and the next import only reads the new tail.
+ * XUnity 只会追加这些文件，因此会记录每个文件上次导入到的字节偏移，下次只读取新增部分。
+ */
+class XuaTranslationImporter
+{
+public:
+    /**
+     * Result of importing one file.
+     * 单个文件的导入结果。
+     */
+    struct Result
+    {
+        qint64 lines = 0;    ///< Lines read ; 读取的行数
+        qint64 imported = 0; ///< New cache entries ; 新增缓存条目
+        qint64 existing = 0; ///< Entries already cached ; 已存在的条目
+        bool skipped = false; ///< File unchanged since the last import ; 自上次导入后未变化
+    };
+
+    /**
+     * List the translation files to import, _AutoGeneratedTranslations.txt first.
+     * 列出需要导入的译文文件，_AutoGeneratedTranslations.txt 排在最前。
+     *
+     * @param glossaryPath Path of the glossary (_Substitutions.txt) ; 术语表路径（_Substitutions.txt）
+     * @return Absolute file paths ; 绝对文件路径
+     */
+    static QStringList findTranslationFiles(const QString &glossaryPath)
+    {
+        QStringList files;
+        if (glossaryPath.isEmpty())
+            return files;
+
+        QDir dir = QFileInfo(glossaryPath).absoluteDir();
+        if (!dir.exists())
+            return files;
+
+        QString autoFile = dir.filePath("_AutoGeneratedTranslations.txt");
+        if (QFile::exists(autoFile))
+            files << QFileInfo(autoFile).absoluteFilePath();
+
+        // Substitution and regex rule files are not translations.
+        // 替换与正则规则文件不是译文。
+        const QStringList excluded = {"_autogeneratedtranslations.txt", "_substitutions.txt",
+                                      "_preprocessors.txt", "_postprocessors.txt"};
+        QDirIterator it(dir.absolutePath(), QStringList() << "*.txt", QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext())
+        {
+            QString path = it.next();
+            if (!excluded.contains(QFileInfo(path).fileName().toLower()))
+                files << QFileInfo(path).absoluteFilePath();
+        }
+        return files;
+    }
+
+    /**
+     * Stream one XUnity translation file into the cache.
+     * 将一个 XUnity 译文文件流式导入缓存。
+     *
+     * Existing cache entries are never overwritten. Comments ("//"), directives ("#set") and
+     * regex entries ("r:" / "sr:") are skipped.
+     * 已有缓存条目不会被覆盖。注释（"//"）、指令（"#set"）和正则条目（"r:" / "sr:"）会被跳过。
+     *
+     * @param path       File to import ; 要导入的文件
+     * @param scope      Cache scope (config fingerprint) to import into ; 导入到的缓存作用域（配置指纹）
+     * @param shouldStop Polled between lines to abort early ; 逐行轮询，用于提前终止
+     * @param progress   Called every few thousand lines ; 每隔数千行调用一次
+     */
+    static Result importFile(const QString &path,
+                             const QString &scope,
+                             const std::function<bool()> &shouldStop,
+                             const std::function<void(const Result &)> &progress)
+    {
+        Result result;
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly))
+            return result;
+
+        TranslationCache &cache = TranslationCache::instance();
+        const QString markerKey = "import:" + scope + ":" + path; // Per scope, see TranslationCache ; 按作用域记录
+        const qint64 fileSize = file.size();
+        qint64 offset = 0;
+        QString marker;
+        if (cache.lookupMarker(markerKey, marker))
+        {
+            qint64 done = marker.toLongLong();
+            if (done == fileSize)
+            {
+                result.skipped = true;
+                return result;
+            }
+            if (done > 0 && done < fileSize)
+                offset = done; // Only the appended tail ; 只读取追加部分
+        }
+        file.seek(offset);
+
+        qint64 resumeAt = offset;
+        while (!file.atEnd())
+        {
+            if (shouldStop && shouldStop())
+                break; // Marker keeps the last complete line, next start resumes ; 标记保留到最后完整行，下次继续
+            QByteArray raw = file.readLine();
+            if (!raw.endsWith('\n') && file.atEnd())
+                break; // Line still being written by the game ; 游戏仍在写入该行
+            resumeAt = file.pos();
+            QString line = QString::fromUtf8(raw).trimmed();
+            result.lines++;
+
+            if (!line.isEmpty() && !line.startsWith("//") && !line.startsWith('#') &&
+                !line.startsWith("r:") && !line.startsWith("sr:"))
+            {
+                int sep = TranslationCache::findSeparator(line);
+                if (sep > 0)
+                {
+                    QString src = toCacheText(TranslationCache::unescapeField(line.left(sep)).trimmed());
+                    QString dst = toCacheText(TranslationCache::unescapeField(line.mid(sep + 1)).trimmed());
+                    if (!src.isEmpty() && !dst.isEmpty() && src != dst)
+                    {
+                        if (cache.importEntry(scope, src, dst))
+                            result.imported++;
+                        else
+                            result.existing++;
+                    }
+                }
+            }
+
+            if (progress && result.lines % 5000 == 0)
+                progress(result);
+        }
+
+        if (resumeAt > offset)
+            cache.storeMarker(markerKey, QString::number(resumeAt));
+        return result;
+    }
+
+private:
+    /**
+     * Match the cache key format of the Custom endpoint, which protects newlines as [LF].
+     * 与 Custom 端点的缓存键格式一致：换行符以 [LF] 保护。
+     */
+    static QString toCacheText(QString text)
+    {
+        text.replace("\r\n", "[LF]");
+        text.replace("\n", "[LF]");
+        return text;
+    }
+};
@@ -0,0 +1,113 @@
+#include <QtTest>
+#include "TinyLfuCache.h"
+
+/**
+ * TinyLfuCache: byte budget, admission against one-off entries, updates and removal.
+ * TinyLfuCache：字节限额、针对一次性条目的准入、更新与删除。
+ */
+class TestTinyLfuCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void putGetAndPeek();
+    void staysWithinBudget();
+    void frequentEntriesSurviveAScan();
+    void oversizedEntryIsRefused();
+    void updateAndRemove();
+};
+
+void TestTinyLfuCache::putGetAndPeek()
+{
+    TinyLfuCache cache(64 * 1024);
+    QString value;
+    QVERIFY(!cache.get("start", value));
+    cache.put("start", "开始");
+    QVERIFY(cache.get("start", value));
+    QCOMPARE(value, QString("开始"));
+    QVERIFY(cache.peek("start") != nullptr);
+    QCOMPARE(*cache.peek("start"), QString("开始"));
+    QVERIFY(cache.peek("quit") == nullptr);
+}
+
+void TestTinyLfuCache::staysWithinBudget()
+{
+    const qint64 budget = 16 * 1024;
+    TinyLfuCache cache(budget);
+    for (int i = 0; i < 1000; ++i)
+    {
+        cache.put(QString("line %1").arg(i), QString("译文 %1").arg(i));
+        QVERIFY(cache.residentBytes() <= budget);
+    }
+    QVERIFY(cache.size() < 1000);
+    QVERIFY(cache.evictionCount() > 0);
+
+    // A smaller budget evicts at once ; 缩小限额会立即淘汰
+    cache.setBudget(4 * 1024);
+    QVERIFY(cache.residentBytes() <= 4 * 1024);
+}
+
+void TestTinyLfuCache::frequentEntriesSurviveAScan()
+{
+    // Room for about a hundred entries ; 大约可容纳一百个条目
+    TinyLfuCache cache(16 * 1024);
+    QString value;
+    for (int i = 0; i < 20; ++i)
+    {
+        const QString key = QString("menu %1").arg(i);
+        cache.get(key, value);
+        cache.put(key, "菜单");
+    }
+    for (int round = 0; round < 4; ++round)
+    {
+        for (int i = 0; i < 20; ++i)
+            QVERIFY(cache.get(QString("menu %1").arg(i), value));
+    }
+
+    // A cutscene: many lines, each looked up and stored once.
+    // 过场动画：大量台词，每行只查询并写入一次。
+    for (int i = 0; i < 2000; ++i)
+    {
+        const QString key = QString("cutscene line %1").arg(i);
+        cache.get(key, value);
+        cache.put(key, "台词");
+    }
+
+    for (int i = 0; i < 20; ++i)
+        QVERIFY(cache.peek(QString("menu %1").arg(i)) != nullptr);
+}
+
+void TestTinyLfuCache::oversizedEntryIsRefused()
+{
+    TinyLfuCache cache(1024);
+    cache.put("huge", QString(4096, QChar('x')));
+    QVERIFY(cache.peek("huge") == nullptr);
+    QCOMPARE(cache.size(), 0);
+    QCOMPARE(cache.residentBytes(), qint64(0));
+    QCOMPARE(cache.evictionCount(), quint64(1));
+}
+
+void TestTinyLfuCache::updateAndRemove()
+{
+    TinyLfuCache cache(64 * 1024);
+    cache.put("start", "开始");
+    const qint64 before = cache.residentBytes();
+    cache.put("start", "开始游戏");
+    QCOMPARE(cache.size(), 1);
+    QCOMPARE(*cache.peek("start"), QString("开始游戏"));
+    QVERIFY(cache.residentBytes() > before);
+
+    QVERIFY(cache.remove("start"));
+    QVERIFY(!cache.remove("start"));
+    QCOMPARE(cache.size(), 0);
+    QCOMPARE(cache.residentBytes(), qint64(0));
+
+    cache.put("a", "1");
+    cache.put("b", "2");
+    cache.clear();
+    QCOMPARE(cache.size(), 0);
+    QCOMPARE(cache.residentBytes(), qint64(0));
+}
+
+QTEST_APPLESS_MAIN(TestTinyLfuCache)
+#include "tst_tinylfucache.moc"
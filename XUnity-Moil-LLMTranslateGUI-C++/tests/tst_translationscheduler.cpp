@@ -0,0 +1,171 @@
+#include <QtTest>
+#include <deque>
+#include "TranslationScheduler.h"
+
+/**
+ * TranslationScheduler: concurrency limit, ordering within a client, weighted sharing across
+ * clients, background work and abandoned jobs.
+ * TranslationScheduler：并发上限、客户端内的顺序、客户端之间的加权分配、后台任务与已放弃的任务。
+ */
+class TestTranslationScheduler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void classify();
+    void respectsConcurrencyLimit();
+    void urgentClassRunsFirst();
+    void clientsShareByWeight();
+    void backgroundWaitsForForeground();
+    void abandonedJobIsDropped();
+
+private:
+    /**
+     * Submit a job that records its ticket when it starts.
+     * 提交一个在启动时记录票据的任务。
+     */
+    void submit(TranslationScheduler &scheduler, PriorityClass priority, const QString &client, int cost = 100,
+                std::function<bool()> abandoned = std::function<bool()>());
+
+    /**
+     * Finish the oldest running job ; 完成最早启动的运行中任务
+     */
+    void finishOldest(TranslationScheduler &scheduler);
+
+    std::deque<TranslationScheduler::Ticket> m_started;
+};
+
+void TestTranslationScheduler::submit(TranslationScheduler &scheduler, PriorityClass priority, const QString &client, int cost,
+                                      std::function<bool()> abandoned)
+{
+    scheduler.submit(
+        priority, client, cost, [this](const TranslationScheduler::Ticket &ticket)
+        { m_started.push_back(ticket); },
+        abandoned);
+}
+
+void TestTranslationScheduler::finishOldest(TranslationScheduler &scheduler)
+{
+    const TranslationScheduler::Ticket ticket = m_started.front();
+    m_started.pop_front();
+    scheduler.finish(ticket);
+}
+
+void TestTranslationScheduler::classify()
+{
+    QCOMPARE(TranslationScheduler::classify(RequestOrigin::Custom, "Start"), PriorityClass::Interactive);
+    QCOMPARE(TranslationScheduler::classify(RequestOrigin::Custom, "A:[LF]Hello"), PriorityClass::Dialogue);
+    QCOMPARE(TranslationScheduler::classify(RequestOrigin::Batch, "Start"), PriorityClass::Dialogue);
+    QCOMPARE(TranslationScheduler::classify(RequestOrigin::Batch, "line one\nline two"), PriorityClass::Bulk);
+    QCOMPARE(TranslationScheduler::classify(RequestOrigin::Background, "Start"), PriorityClass::Background);
+}
+
+void TestTranslationScheduler::respectsConcurrencyLimit()
+{
+    m_started.clear();
+    TranslationScheduler scheduler;
+    scheduler.configure(2, false);
+    for (int i = 0; i < 5; ++i)
+        submit(scheduler, PriorityClass::Dialogue, "game");
+    QCOMPARE(int(m_started.size()), 2);
+    QCOMPARE(scheduler.queued(), 3);
+
+    // Each finished job hands its slot to the next one ; 每个完成的任务把名额交给下一个任务
+    finishOldest(scheduler);
+    QCOMPARE(int(m_started.size()), 2);
+    QCOMPARE(scheduler.queued(), 2);
+
+    // A raised limit takes effect at once ; 提高的名额立即生效
+    scheduler.configure(4, false);
+    QCOMPARE(int(m_started.size()), 4);
+    QCOMPARE(scheduler.queued(), 0);
+}
+
+void TestTranslationScheduler::urgentClassRunsFirst()
+{
+    m_started.clear();
+    TranslationScheduler scheduler;
+    scheduler.configure(1, false);
+    submit(scheduler, PriorityClass::Dialogue, "game");
+    submit(scheduler, PriorityClass::Bulk, "game");
+    submit(scheduler, PriorityClass::Interactive, "game");
+
+    finishOldest(scheduler);
+    QCOMPARE(m_started.front().priority, PriorityClass::Interactive);
+    finishOldest(scheduler);
+    QCOMPARE(m_started.front().priority, PriorityClass::Bulk);
+}
+
+void TestTranslationScheduler::clientsShareByWeight()
+{
+    m_started.clear();
+    TranslationScheduler scheduler;
+    QHash<QString, int> weights;
+    weights.insert("main", 3);
+    scheduler.configure(1, false, weights);
+
+    // Every job costs a full quantum, so a turn buys `weight` jobs.
+    // 每个任务的成本正好是一个额度，因此每轮可以买到 `weight` 个任务。
+    submit(scheduler, PriorityClass::Dialogue, "main", TranslationScheduler::QUANTUM_TOKENS);
+    for (int i = 0; i < 40; ++i)
+    {
+        submit(scheduler, PriorityClass::Dialogue, "main", TranslationScheduler::QUANTUM_TOKENS);
+        submit(scheduler, PriorityClass::Dialogue, "side", TranslationScheduler::QUANTUM_TOKENS);
+    }
+
+    int mainStarts = 0;
+    for (int i = 0; i < 40; ++i)
+    {
+        finishOldest(scheduler);
+        if (m_started.front().client == "main")
+            mainStarts++;
+    }
+    QCOMPARE(mainStarts, 30);
+}
+
+void TestTranslationScheduler::backgroundWaitsForForeground()
+{
+    m_started.clear();
+    TranslationScheduler scheduler;
+    scheduler.configure(1, false);
+    submit(scheduler, PriorityClass::Dialogue, "game");
+    submit(scheduler, PriorityClass::Background, "glossary-refresh");
+    for (int i = 0; i < 3; ++i)
+        submit(scheduler, PriorityClass::Dialogue, "game");
+
+    for (int i = 0; i < 3; ++i)
+    {
+        finishOldest(scheduler);
+        QCOMPARE(m_started.front().client, QString("game"));
+    }
+    finishOldest(scheduler);
+    QCOMPARE(m_started.front().client, QString("glossary-refresh"));
+    QCOMPARE(scheduler.queued(), 0);
+}
+
+void TestTranslationScheduler::abandonedJobIsDropped()
+{
+    m_started.clear();
+    TranslationScheduler scheduler;
+    scheduler.configure(1, false);
+    submit(scheduler, PriorityClass::Dialogue, "game");
+    submit(scheduler, PriorityClass::Dialogue, "game", 100, []()
+           { return true; });
+    submit(scheduler, PriorityClass::Dialogue, "game");
+
+    // The dropped job is reported without taking the slot ; 被丢弃的任务会被告知，但不占用名额
+    finishOldest(scheduler);
+    QCOMPARE(int(m_started.size()), 2);
+    QVERIFY(m_started[0].abandoned);
+    QVERIFY(!m_started[1].abandoned);
+    QCOMPARE(scheduler.queued(), 0);
+
+    // Finishing a dropped ticket is ignored ; 完成已丢弃的票据会被忽略
+    finishOldest(scheduler);
+    submit(scheduler, PriorityClass::Dialogue, "game");
+    QCOMPARE(int(m_started.size()), 1);
+    QCOMPARE(scheduler.queued(), 1);
+}
+
+QTEST_APPLESS_MAIN(TestTranslationScheduler)
+#include "tst_translationscheduler.moc"
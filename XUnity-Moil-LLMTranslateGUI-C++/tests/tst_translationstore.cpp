@@ -0,0 +1,293 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include "TranslationStore.h"
+
+/**
+ * TranslationStore: persistence, recovery on reopen, index growth and compaction.
+ * TranslationStore：持久化、重新打开时的恢复、索引扩容与压缩。
+ */
+class TestTranslationStore : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void valuesSurviveReopen();
+    void countSkipsDeletedAndMetadata();
+    void tornTailIsTruncated();
+    void crashLeftoverReserveIsCut();
+    void foreignIndexIsRebuilt();
+    void indexGrowsAndSurvivesReopen();
+    void compactKeepsLiveRecords();
+    void leftoverCompactFileIsIgnored();
+    void unknownVersionIsMovedAside();
+
+private:
+    QString m_base;
+    QScopedPointer<QTemporaryDir> m_dir;
+};
+
+void TestTranslationStore::init()
+{
+    m_dir.reset(new QTemporaryDir());
+    QVERIFY(m_dir->isValid());
+    m_base = m_dir->filePath("memory");
+}
+
+void TestTranslationStore::valuesSurviveReopen()
+{
+    {
+        TranslationStore store;
+        QVERIFY(store.open(m_base));
+        QVERIFY(store.put("start", "开始"));
+        QVERIFY(store.put("quit", "退出"));
+        QVERIFY(store.put("start", "启动"));
+        QVERIFY(store.remove("quit"));
+    }
+
+    TranslationStore store;
+    QVERIFY(store.open(m_base));
+    QByteArray value;
+    QVERIFY(store.get("start", value));
+    QCOMPARE(value, QByteArray("启动"));
+    QVERIFY(!store.get("quit", value));
+    QVERIFY(store.deadBytes() > 0);
+}
+
+void TestTranslationStore::countSkipsDeletedAndMetadata()
+{
+    TranslationStore store;
+    QVERIFY(store.open(m_base));
+    QVERIFY(store.put("start", "开始"));
+    QVERIFY(store.put("quit", "退出"));
+    QVERIFY(store.put("\x01offset", "42", true));
+    QCOMPARE(store.count(), quint64(2));
+
+    QVERIFY(store.put("start", "启动"));
+    QVERIFY(store.remove("quit"));
+    QCOMPARE(store.count(), quint64(1));
+    QVERIFY(store.put("quit", "退出"));
+    QCOMPARE(store.count(), quint64(2));
+
+    // The count is kept in the index, so it survives a reopen and a rebuild.
+    // 计数保存在索引中，因此重新打开与重建后仍然正确。
+    store.close();
+    QVERIFY(store.open(m_base));
+    QCOMPARE(store.count(), quint64(2));
+    store.close();
+    QVERIFY(QFile::remove(m_base + ".tmidx"));
+    QVERIFY(store.open(m_base));
+    QCOMPARE(store.count(), quint64(2));
+    QByteArray value;
+    QVERIFY(store.get("\x01offset", value));
+    QCOMPARE(value, QByteArray("42"));
+}
+
+void TestTranslationStore::tornTailIsTruncated()
+{
+    quint64 intactSize = 0;
+    {
+        TranslationStore store;
+        QVERIFY(store.open(m_base));
+        QVERIFY(store.put("a", "1"));
+        QVERIFY(store.put("b", "2"));
+        intactSize = store.logBytes();
+    }
+
+    // A crash during append: the record header promises more bytes than were written.
+    // 追加时崩溃：记录头声明的字节数多于实际写入的字节数。
+    QFile log(m_base + ".tmlog");
+    QVERIFY(log.open(QIODevice::Append));
+    const quint32 torn[4] = {5, 100, 0, 0};
+    log.write(reinterpret_cast<const char *>(torn), sizeof(torn));
+    log.write("abc");
+    log.close();
+
+    TranslationStore store;
+    QVERIFY(store.open(m_base));
+    QCOMPARE(store.logBytes(), intactSize);
+    QByteArray value;
+    QVERIFY(store.get("a", value));
+    QCOMPARE(value, QByteArray("1"));
+    QVERIFY(store.get("b", value));
+
+    // Appends continue from the cut, so the next reopen sees them.
+    // 追加从截断处继续，下次重新打开时可以读到。
+    QVERIFY(store.put("c", "3"));
+    const quint64 finalSize = store.logBytes();
+    store.close();
+    QCOMPARE(QFile(m_base + ".tmlog").size(), qint64(finalSize)); // Reserve cut off ; 预留空间已截掉
+    QVERIFY(store.open(m_base));
+    QVERIFY(store.get("c", value));
+    QCOMPARE(value, QByteArray("3"));
+}
+
+void TestTranslationStore::crashLeftoverReserveIsCut()
+{
+    quint64 used = 0;
+    {
+        TranslationStore store;
+        QVERIFY(store.open(m_base));
+        QVERIFY(store.put("a", "1"));
+        used = store.logBytes();
+        QVERIFY(QFile(m_base + ".tmlog").size() > qint64(used)); // Reserve while open ; 打开期间的预留空间
+    }
+
+    // A crash keeps the zero-filled reserve on disk.
+    // 崩溃会在磁盘上留下零填充的预留空间。
+    QFile log(m_base + ".tmlog");
+    QVERIFY(log.open(QIODevice::ReadWrite));
+    QVERIFY(log.resize(qint64(used) + 4096));
+    log.close();
+
+    TranslationStore store;
+    QVERIFY(store.open(m_base));
+    QCOMPARE(store.logBytes(), used);
+    QByteArray value;
+    QVERIFY(store.get("a", value));
+    QVERIFY(store.put("b", "2"));
+    QVERIFY(store.get("b", value));
+    QCOMPARE(value, QByteArray("2"));
+}
+
+void TestTranslationStore::foreignIndexIsRebuilt()
+{
+    {
+        TranslationStore store;
+        QVERIFY(store.open(m_base));
+        QVERIFY(store.put("a", "1"));
+    }
+
+    // Point the index at another log (IndexHeader::logCreatedAt, offset 32).
+    // 让索引指向另一个日志（IndexHeader::logCreatedAt，偏移 32）。
+    QFile index(m_base + ".tmidx");
+    QVERIFY(index.open(QIODevice::ReadWrite));
+    QVERIFY(index.seek(32));
+    const qint64 otherLog = 42;
+    index.write(reinterpret_cast<const char *>(&otherLog), sizeof(otherLog));
+    index.close();
+
+    TranslationStore store;
+    QString report;
+    QVERIFY(store.open(m_base, &report));
+    QCOMPARE(report, QString("index rebuilt from log"));
+    QByteArray value;
+    QVERIFY(store.get("a", value));
+    QCOMPARE(value, QByteArray("1"));
+    QCOMPARE(store.count(), quint64(1));
+}
+
+void TestTranslationStore::indexGrowsAndSurvivesReopen()
+{
+    // Well past the 70% load factor of the smallest index (1024 slots).
+    // 远超最小索引（1024 个槽位）70% 的负载因子。
+    const int entries = 3000;
+    {
+        TranslationStore store;
+        QVERIFY(store.open(m_base));
+        for (int i = 0; i < entries; ++i)
+            QVERIFY(store.put("key" + QByteArray::number(i), "value" + QByteArray::number(i)));
+        QCOMPARE(store.count(), quint64(entries));
+    }
+    QVERIFY(!QFile::exists(m_base + ".tmidx.tmp"));
+    QVERIFY(QFile(m_base + ".tmidx").size() > qint64(4096 * 16)); // 3000 / 0.7 → 8192 slots ; 8192 个槽位
+
+    TranslationStore store;
+    QString report;
+    QVERIFY(store.open(m_base, &report));
+    QVERIFY(report.isEmpty());
+    QCOMPARE(store.count(), quint64(entries));
+    for (int i = 0; i < entries; ++i)
+    {
+        QByteArray value;
+        QVERIFY(store.get("key" + QByteArray::number(i), value));
+        QCOMPARE(value, "value" + QByteArray::number(i));
+    }
+}
+
+void TestTranslationStore::compactKeepsLiveRecords()
+{
+    TranslationStore store;
+    QVERIFY(store.open(m_base));
+    for (int i = 0; i < 100; ++i)
+        QVERIFY(store.put("key" + QByteArray::number(i), "old"));
+    for (int i = 0; i < 50; ++i)
+        QVERIFY(store.put("key" + QByteArray::number(i), "new"));
+    for (int i = 90; i < 100; ++i)
+        QVERIFY(store.remove("key" + QByteArray::number(i)));
+    const quint64 before = store.logBytes();
+    QVERIFY(store.deadBytes() > 0);
+
+    QVERIFY(store.compact());
+    QVERIFY(store.logBytes() < before);
+    QCOMPARE(store.deadBytes(), quint64(0));
+    QCOMPARE(store.count(), quint64(90));
+    QVERIFY(!QFile::exists(m_base + ".tmlog.compact"));
+
+    store.close();
+    QString report;
+    QVERIFY(store.open(m_base, &report));
+    QVERIFY(report.isEmpty());
+    QCOMPARE(store.count(), quint64(90));
+    for (int i = 0; i < 100; ++i)
+    {
+        QByteArray value;
+        const bool found = store.get("key" + QByteArray::number(i), value);
+        QCOMPARE(found, i < 90);
+        if (found)
+            QCOMPARE(value, QByteArray(i < 50 ? "new" : "old"));
+    }
+}
+
+void TestTranslationStore::leftoverCompactFileIsIgnored()
+{
+    {
+        TranslationStore store;
+        QVERIFY(store.open(m_base));
+        QVERIFY(store.put("a", "1"));
+    }
+
+    // A crash during compaction leaves the temporary log behind, the real one untouched.
+    // 压缩期间崩溃会留下临时日志，正式日志保持不变。
+    QFile leftover(m_base + ".tmlog.compact");
+    QVERIFY(leftover.open(QIODevice::WriteOnly));
+    leftover.write("half written");
+    leftover.close();
+
+    TranslationStore store;
+    QVERIFY(store.open(m_base));
+    QByteArray value;
+    QVERIFY(store.get("a", value));
+    QCOMPARE(value, QByteArray("1"));
+
+    QVERIFY(store.compact());
+    QVERIFY(store.get("a", value));
+    QCOMPARE(value, QByteArray("1"));
+    QVERIFY(!QFile::exists(m_base + ".tmlog.compact"));
+}
+
+void TestTranslationStore::unknownVersionIsMovedAside()
+{
+    // LogHeader with the right magic and a future version.
+    // 魔数正确但版本来自未来的 LogHeader。
+    QByteArray header(32, '\0');
+    header.replace(0, 4, "XTML");
+    const quint32 version = 99;
+    header.replace(4, 4, QByteArray(reinterpret_cast<const char *>(&version), 4));
+    QFile log(m_base + ".tmlog");
+    QVERIFY(log.open(QIODevice::WriteOnly));
+    log.write(header);
+    log.close();
+
+    TranslationStore store;
+    QString report;
+    QVERIFY(store.open(m_base, &report));
+    QVERIFY(report.contains("v99"));
+    QVERIFY(QFile::exists(m_base + ".tmlog.v99.bak"));
+    QCOMPARE(store.count(), quint64(0));
+    QVERIFY(store.put("a", "1"));
+}
+
+QTEST_APPLESS_MAIN(TestTranslationStore)
+#include "tst_translationstore.moc"